@@ -11,6 +11,22 @@ function! libclang#version()
     return libcall(g:libclang#lib_path, 'vim_clang_version', '')
 endfunction
 
+function! libclang#set_option(name, value)
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_set_option', a:name . '=' . a:value))
+endfunction
+
+function! libclang#stats()
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_stats', ''))
+endfunction
+
+function! libclang#reset_stats()
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_reset_stats', ''))
+endfunction
+
+function! libclang#translation_unit_usage()
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_get_translation_unit_usage', ''))
+endfunction
+
 function! s:get_extra_string(extra)
     if len(a:extra) == 1
         if type(a:extra[0]) == s:LIST_TYPE
@@ -0,0 +1,15 @@
+function! libclang#calls#incoming_at(filename, line, col, ...)
+    return libclang#call_at('vim_clang_get_incoming_calls', a:filename, a:line, a:col, a:000)
+endfunction
+
+function! libclang#calls#outgoing_at(filename, line, col, ...)
+    return libclang#call_at('vim_clang_get_outgoing_calls', a:filename, a:line, a:col, a:000)
+endfunction
+
+function! libclang#calls#incoming(usr)
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_get_incoming_calls', a:usr))
+endfunction
+
+function! libclang#calls#outgoing(usr)
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_get_outgoing_calls', a:usr))
+endfunction
@@ -10,6 +10,9 @@ endfunction
 function! libclang#deduction#type_at(filename, line, col, ...)
     return libclang#call_at('vim_clang_get_type_with_deduction_at', a:filename, a:line, a:col, a:000)
 endfunction
+function! libclang#deduction#inlay_hints(filename, first, last, ...)
+    return libclang#call_at('vim_clang_get_inlay_hints', a:filename, a:first, a:last, a:000)
+endfunction
 function! libclang#deduction#current_function_at(filename, line, col, ...)
     return libclang#call_at('vim_clang_get_current_function_at', a:filename, a:line, a:col, a:000)
 endfunction
@@ -22,6 +25,9 @@ endfunction
 function! libclang#deduction#comment_at(filename, line, col, ...)
     return libclang#call_at('vim_clang_get_comment_at', a:filename, a:line, a:col, a:000)
 endfunction
+function! libclang#deduction#hover_at(filename, line, col, ...)
+    return libclang#call_at('vim_clang_get_hover_at', a:filename, a:line, a:col, a:000)
+endfunction
 function! libclang#deduction#declaration_at(filename, line, col, ...)
     return libclang#call_at('vim_clang_get_deduced_declaration_at', a:filename, a:line, a:col, a:000)
 endfunction
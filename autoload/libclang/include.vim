@@ -0,0 +1,11 @@
+function! libclang#include#inclusions(filename)
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_get_inclusions', a:filename))
+endfunction
+
+function! libclang#include#includers(filename)
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_get_includers', a:filename))
+endfunction
+
+function! libclang#include#invalidate(filename)
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_invalidate_dependents', a:filename))
+endfunction
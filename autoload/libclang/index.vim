@@ -0,0 +1,34 @@
+function! libclang#index#start(file_names, ...)
+    let compiler_args = a:0 == 0 ? '' : type(a:1) == type([]) ? join(a:1, ' ') : a:1
+    let request = join(map(copy(a:file_names), 'v:val . ":" . compiler_args'), "\n")
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_start_indexing', request))
+endfunction
+
+function! libclang#index#start_compile_commands(directory)
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_start_indexing', '@' . a:directory))
+endfunction
+
+function! libclang#index#poll()
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_poll_indexing', ''))
+endfunction
+
+function! libclang#index#cancel()
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_cancel_indexing', ''))
+endfunction
+
+function! libclang#index#definitions_at(filename, line, col, ...)
+    return libclang#call_at('vim_clang_get_indexed_definitions_at', a:filename, a:line, a:col, a:000)
+endfunction
+
+function! libclang#index#declarations_at(filename, line, col, ...)
+    return libclang#call_at('vim_clang_get_indexed_declarations_at', a:filename, a:line, a:col, a:000)
+endfunction
+
+function! libclang#index#references_at(filename, line, col, ...)
+    return libclang#call_at('vim_clang_get_indexed_references_at', a:filename, a:line, a:col, a:000)
+endfunction
+
+function! libclang#index#symbols(query, ...)
+    let limit = a:0 == 0 ? 50 : a:1
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_search_workspace_symbols', limit . ':' . a:query))
+endfunction
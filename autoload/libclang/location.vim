@@ -28,6 +28,9 @@ endfunction
 function! libclang#location#all_extents(filename, line, col, ...)
     return libclang#call_at('vim_clang_get_all_extents_at', a:filename, a:line, a:col, a:000)
 endfunction
+function! libclang#location#references_in_file_at(filename, line, col, ...)
+    return libclang#call_at('vim_clang_get_references_in_file_at', a:filename, a:line, a:col, a:000)
+endfunction
 function! libclang#location#definition_at(filename, line, col, ...)
     return libclang#call_at('vim_clang_get_definition_at', a:filename, a:line, a:col, a:000)
 endfunction
@@ -0,0 +1,13 @@
+function! libclang#pch#build(file_names, ...)
+    let compiler_args = a:0 == 0 ? '' : type(a:1) == type([]) ? join(a:1, ' ') : a:1
+    let request = join(map(copy(a:file_names), 'v:val . ":" . compiler_args'), "\n")
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_build_shared_pch', request))
+endfunction
+
+function! libclang#pch#build_compile_commands(directory)
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_build_shared_pch', '@' . a:directory))
+endfunction
+
+function! libclang#pch#clear()
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_clear_shared_pch', ''))
+endfunction
@@ -0,0 +1,7 @@
+function! libclang#record#start(filename)
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_start_recording', a:filename))
+endfunction
+
+function! libclang#record#stop()
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_stop_recording', ''))
+endfunction
@@ -0,0 +1,17 @@
+function! libclang#references#start(usr, spelling, file_names, ...)
+    let compiler_args = a:0 == 0 ? '' : type(a:1) == type([]) ? join(a:1, ' ') : a:1
+    let request = join([a:usr, a:spelling] + map(copy(a:file_names), 'v:val . ":" . compiler_args'), "\n")
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_start_reference_search', request))
+endfunction
+
+function! libclang#references#start_compile_commands(usr, spelling, directory)
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_start_reference_search', join([a:usr, a:spelling, '@' . a:directory], "\n")))
+endfunction
+
+function! libclang#references#poll()
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_poll_reference_search', ''))
+endfunction
+
+function! libclang#references#cancel()
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_cancel_reference_search', ''))
+endfunction
@@ -0,0 +1,17 @@
+function! libclang#sweep#start(file_names, ...)
+    let compiler_args = a:0 == 0 ? '' : type(a:1) == type([]) ? join(a:1, ' ') : a:1
+    let request = join(map(copy(a:file_names), 'v:val . ":" . compiler_args'), "\n")
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_start_diagnostics_sweep', request))
+endfunction
+
+function! libclang#sweep#start_compile_commands(directory)
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_start_diagnostics_sweep', '@' . a:directory))
+endfunction
+
+function! libclang#sweep#poll()
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_poll_diagnostics_sweep', ''))
+endfunction
+
+function! libclang#sweep#cancel()
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_cancel_diagnostics_sweep', ''))
+endfunction
@@ -0,0 +1,7 @@
+function! libclang#trace#start(filename)
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_start_tracing', a:filename))
+endfunction
+
+function! libclang#trace#stop()
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_stop_tracing', ''))
+endfunction
@@ -0,0 +1,23 @@
+function! libclang#types#bases_at(filename, line, col, ...)
+    return libclang#call_at('vim_clang_get_base_classes', a:filename, a:line, a:col, a:000)
+endfunction
+
+function! libclang#types#derived_at(filename, line, col, ...)
+    return libclang#call_at('vim_clang_get_derived_classes', a:filename, a:line, a:col, a:000)
+endfunction
+
+function! libclang#types#implementations_at(filename, line, col, ...)
+    return libclang#call_at('vim_clang_get_implementations', a:filename, a:line, a:col, a:000)
+endfunction
+
+function! libclang#types#bases(usr)
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_get_base_classes', a:usr))
+endfunction
+
+function! libclang#types#derived(usr)
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_get_derived_classes', a:usr))
+endfunction
+
+function! libclang#types#implementations(usr)
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_get_implementations', a:usr))
+endfunction
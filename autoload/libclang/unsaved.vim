@@ -0,0 +1,15 @@
+function! s:join_lines(lines)
+    return empty(a:lines) ? '' : join(a:lines, "\n") . "\n"
+endfunction
+
+function! libclang#unsaved#set(file_name, version, lines)
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_update_unsaved_file', printf("%s:%d\n%s", a:file_name, a:version, s:join_lines(a:lines))))
+endfunction
+
+function! libclang#unsaved#update(file_name, version, first, last, lines)
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_update_unsaved_file', printf("%s:%d:%d:%d\n%s", a:file_name, a:version, a:first, a:last, s:join_lines(a:lines))))
+endfunction
+
+function! libclang#unsaved#discard(file_name)
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_discard_unsaved_file', a:file_name))
+endfunction
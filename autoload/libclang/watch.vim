@@ -0,0 +1,11 @@
+function! libclang#watch#start()
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_start_watching', ''))
+endfunction
+
+function! libclang#watch#poll()
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_poll_watching', ''))
+endfunction
+
+function! libclang#watch#stop()
+    return eval(libcall(g:libclang#lib_path, 'vim_clang_stop_watching', ''))
+endfunction
@@ -1,5 +1,9 @@
 #include "AST_extracter.hpp"
 
+#include "result_cache.hpp"
+#include "stats.hpp"
+#include "translation_unit_cache.hpp"
+
 namespace {
 
 enum { result = 0, visit_policy, predicate };
@@ -46,32 +50,28 @@ CXChildVisitResult AST_extracter(CXCursor cursor, CXCursor parent,
 }
 
 const char* libclang_vim::extract_AST_nodes(
-    char const* arguments, extraction_policy const policy,
+    const char* kind, char const* arguments, extraction_policy const policy,
     const std::function<bool(const CXCursor&)>& predicate) {
-    static std::string vimson;
-    vimson = "";
-
     auto const parsed = parse_default_args(arguments);
-    auto const args_ptrs = get_args_ptrs(parsed.args);
-
-    callback_data_type callback_data{vimson, policy, predicate};
 
-    cxindex_ptr index =
-        clang_createIndex(/*excludeDeclsFromPCH*/ 1, /*displayDiagnostics*/ 0);
-    std::vector<CXUnsavedFile> unsaved_files = create_unsaved_files(parsed);
-    cxtranslation_unit_ptr translation_unit(clang_parseTranslationUnit(
-        index, parsed.file.c_str(), args_ptrs.data(), args_ptrs.size(),
-        unsaved_files.data(), unsaved_files.size(),
-        CXTranslationUnit_Incomplete));
-    if (!translation_unit)
-        return "{}";
+    return get_result_cache().get(kind, parsed, [&] {
+        std::string vimson;
+        callback_data_type callback_data{vimson, policy, predicate};
 
-    CXCursor cursor = clang_getTranslationUnitCursor(translation_unit);
-    clang_visitChildren(cursor, AST_extracter, &callback_data);
+        scoped_timer parse_timer("extract_AST_nodes.parse");
+        cached_translation_unit_ptr translation_unit =
+            parse_translation_unit(parsed, CXTranslationUnit_Incomplete);
+        if (!translation_unit)
+            return std::string("{}");
+        parse_timer.stop();
 
-    vimson = "{'root':[" + vimson + "]}";
+        // Stringizing happens while visiting.
+        scoped_timer traverse_timer("extract_AST_nodes.traverse");
+        CXCursor cursor = clang_getTranslationUnitCursor(translation_unit);
+        clang_visitChildren(cursor, AST_extracter, &callback_data);
 
-    return vimson.c_str();
+        return "{'root':[" + vimson + "]}";
+    });
 }
 
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
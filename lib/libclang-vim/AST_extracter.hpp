@@ -17,8 +17,11 @@ enum struct extraction_policy {
     current_file,
 };
 
+/// Extracts the nodes matching predicate. kind identifies the request in the
+/// result cache, so it has to be unique for each policy and predicate.
 const char*
-extract_AST_nodes(char const* arguments, extraction_policy policy,
+extract_AST_nodes(const char* kind, char const* arguments,
+                  extraction_policy policy,
                   const std::function<bool(const CXCursor&)>& predicate);
 
 } // namespace libclang_vim
@@ -0,0 +1,103 @@
+#include "call_hierarchy.hpp"
+
+#include <map>
+#include <vector>
+
+#include "deduction.hpp"
+#include "symbol_index.hpp"
+#include "translation_unit_cache.hpp"
+
+namespace {
+
+/// Finds the USR of the function called at location_info, or else of the
+/// function enclosing it.
+std::string
+get_function_usr_at(const libclang_vim::location_tuple& location_info) {
+    if (location_info.file.empty())
+        return std::string();
+
+    libclang_vim::cached_translation_unit_ptr translation_unit =
+        libclang_vim::parse_translation_unit_at(location_info,
+                                                CXTranslationUnit_Incomplete);
+    if (!translation_unit)
+        return std::string();
+
+    CXFile file = clang_getFile(translation_unit, location_info.file.c_str());
+    CXSourceLocation location = clang_getLocation(
+        translation_unit, file, location_info.line, location_info.col);
+    CXCursor cursor =
+        clang_getCursorReferenced(clang_getCursor(translation_unit, location));
+    if (clang_Cursor_isNull(cursor) ||
+        !libclang_vim::is_function_decl_kind(clang_getCursorKind(cursor)))
+        cursor = libclang_vim::get_function_cursor_at(translation_unit,
+                                                      location_info);
+    if (clang_getCursorKind(cursor) == CXCursor_TranslationUnit)
+        return std::string();
+
+    libclang_vim::cxstring_ptr usr = clang_getCursorUSR(cursor);
+    return clang_getCString(usr);
+}
+
+std::string
+stringize_location(const libclang_vim::symbol_occurrence& occurrence) {
+    return "'line':" + std::to_string(occurrence.line) +
+           ",'column':" + std::to_string(occurrence.column) +
+           ",'offset':" + std::to_string(occurrence.offset) + ",'file':'" +
+           occurrence.file + "'";
+}
+
+/// Describes each function of calls, with the locations of its calls.
+std::string stringize_calls(
+    const std::map<std::string,
+                   std::vector<libclang_vim::symbol_occurrence>>& calls) {
+    std::string vimson = "[";
+    for (const auto& function : calls) {
+        vimson += "{" + libclang_vim::stringize_indexed_symbol(function.first) +
+                  ",'calls':[";
+        for (const auto& call : function.second)
+            vimson += "{" + stringize_location(call) + "},";
+        vimson += "]},";
+    }
+    vimson += "]";
+    return vimson;
+}
+}
+
+const char* libclang_vim::get_incoming_calls(const std::string& request) {
+    static std::string vimson;
+
+    const std::string usr =
+        libclang_vim::get_usr_of_request(request, get_function_usr_at);
+    if (usr.empty())
+        return "[]";
+
+    // Group the calls by caller.
+    std::map<std::string, std::vector<symbol_occurrence>> calls;
+    for (const auto& occurrence :
+         get_symbol_index().find(usr, symbol_reference)) {
+        if (!occurrence.caller.empty())
+            calls[occurrence.caller].push_back(occurrence);
+    }
+
+    vimson = stringize_calls(calls);
+    return vimson.c_str();
+}
+
+const char* libclang_vim::get_outgoing_calls(const std::string& request) {
+    static std::string vimson;
+
+    const std::string usr =
+        libclang_vim::get_usr_of_request(request, get_function_usr_at);
+    if (usr.empty())
+        return "[]";
+
+    // Group the calls by callee.
+    std::map<std::string, std::vector<symbol_occurrence>> calls;
+    for (const auto& occurrence : get_symbol_index().find_calls_from(usr))
+        calls[occurrence.usr].push_back(occurrence);
+
+    vimson = stringize_calls(calls);
+    return vimson.c_str();
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,22 @@
+#if !defined LIBCLANG_VIM_CALL_HIERARCHY_HPP_INCLUDED
+#define LIBCLANG_VIM_CALL_HIERARCHY_HPP_INCLUDED
+
+#include <string>
+
+namespace libclang_vim {
+
+/// Lists the functions calling a function, with the location of each call,
+/// from the calls recorded by the symbol index. The function is given by its
+/// USR or as "file:args:line:col" of a call or of a location inside it. Only
+/// one level is returned: the client expands a caller by passing its USR.
+const char* get_incoming_calls(const std::string& request);
+
+/// Lists the functions called by a function, the same way as
+/// get_incoming_calls().
+const char* get_outgoing_calls(const std::string& request);
+
+} // namespace libclang_vim
+
+#endif // LIBCLANG_VIM_CALL_HIERARCHY_HPP_INCLUDED
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
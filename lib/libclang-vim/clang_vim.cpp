@@ -1,3 +1,4 @@
+#include <fcntl.h>
 #include <unistd.h>
 #include <tuple>
 
@@ -6,23 +7,47 @@
 #include "helpers.hpp"
 #include "tokenizer.hpp"
 #include "AST_extracter.hpp"
+#include "call_hierarchy.hpp"
 #include "location.hpp"
+#include "options.hpp"
 #include "deduction.hpp"
-
-/// Ensures that writes to stderr are ignored.
+#include "diagnostics_sweep.hpp"
+#include "file_watcher.hpp"
+#include "include_graph.hpp"
+#include "reference_search.hpp"
+#include "result_cache.hpp"
+#include "session_recorder.hpp"
+#include "shared_pch.hpp"
+#include "stats.hpp"
+#include "symbol_index.hpp"
+#include "symbol_search.hpp"
+#include "trace.hpp"
+#include "translation_unit_cache.hpp"
+#include "type_hierarchy.hpp"
+#include "unsaved_files.hpp"
+
+/// Ensures that writes to stderr are ignored. File descriptor 2 is pointed at
+/// /dev/null instead of being closed, so that files opened by pool tasks in the
+/// meantime can't take its place.
 class stderr_guard {
     int m_stderr;
 
   public:
     stderr_guard() : m_stderr(dup(STDERR_FILENO)) {
-        // Close stderr.
-        close(STDERR_FILENO);
+        // Silence stderr.
+        int null = open("/dev/null", O_WRONLY);
+        if (null >= 0) {
+            dup2(null, STDERR_FILENO);
+            close(null);
+        }
     }
 
     ~stderr_guard() {
         // Restore stderr.
-        dup(m_stderr);
-        close(m_stderr);
+        if (m_stderr >= 0) {
+            dup2(m_stderr, STDERR_FILENO);
+            close(m_stderr);
+        }
     }
 };
 
@@ -32,122 +57,191 @@ char const* vim_clang_version() {
     return clang_getCString(clang_getClangVersion());
 }
 
+char const* vim_clang_set_option(char const* option) {
+    libclang_vim::record_call(__func__, option);
+    return libclang_vim::set_option(option);
+}
+
+char const* vim_clang_stats(char const*) { return libclang_vim::get_stats(); }
+
+char const* vim_clang_reset_stats(char const*) {
+    return libclang_vim::reset_stats();
+}
+
+char const* vim_clang_start_tracing(char const* file) {
+    return libclang_vim::start_tracing(file);
+}
+
+char const* vim_clang_stop_tracing(char const*) {
+    return libclang_vim::stop_tracing();
+}
+
+char const* vim_clang_start_recording(char const* file) {
+    return libclang_vim::start_recording(file);
+}
+
+char const* vim_clang_stop_recording(char const*) {
+    return libclang_vim::stop_recording();
+}
+
 char const* vim_clang_tokens(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     auto const parsed = libclang_vim::parse_default_args(arguments);
-    libclang_vim::tokenizer tokenizer{};
-    static auto const vimson = tokenizer.tokenize_as_vimson(parsed);
-    return vimson.c_str();
+    return libclang_vim::get_result_cache().get("tokens", parsed, [&parsed] {
+        libclang_vim::tokenizer tokenizer{};
+        return tokenizer.tokenize_as_vimson(parsed);
+    });
 }
 
 // API to extract AST nodes {{{
 // API to extract all {{{
 char const* vim_clang_extract_all(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::all,
+        __func__, arguments, libclang_vim::extraction_policy::all,
         [](CXCursor const&) { return true; });
 }
 
 char const* vim_clang_extract_declarations(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::all, [](CXCursor const& c) {
+        __func__, arguments, libclang_vim::extraction_policy::all,
+        [](CXCursor const& c) {
             return clang_isDeclaration(clang_getCursorKind(c));
         });
 }
 
 char const* vim_clang_extract_attributes(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::all, [](CXCursor const& c) {
+        __func__, arguments, libclang_vim::extraction_policy::all,
+        [](CXCursor const& c) {
             return clang_isAttribute(clang_getCursorKind(c));
         });
 }
 
 char const* vim_clang_extract_expressions(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::all, [](CXCursor const& c) {
+        __func__, arguments, libclang_vim::extraction_policy::all,
+        [](CXCursor const& c) {
             return clang_isExpression(clang_getCursorKind(c));
         });
 }
 
 char const* vim_clang_extract_preprocessings(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::all, [](CXCursor const& c) {
+        __func__, arguments, libclang_vim::extraction_policy::all,
+        [](CXCursor const& c) {
             return clang_isPreprocessing(clang_getCursorKind(c));
         });
 }
 
 char const* vim_clang_extract_references(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::all, [](CXCursor const& c) {
+        __func__, arguments, libclang_vim::extraction_policy::all,
+        [](CXCursor const& c) {
             return clang_isReference(clang_getCursorKind(c));
         });
 }
 
 char const* vim_clang_extract_statements(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::all, [](CXCursor const& c) {
+        __func__, arguments, libclang_vim::extraction_policy::all,
+        [](CXCursor const& c) {
             return clang_isStatement(clang_getCursorKind(c));
         });
 }
 
 char const* vim_clang_extract_translation_units(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::all, [](CXCursor const& c) {
+        __func__, arguments, libclang_vim::extraction_policy::all,
+        [](CXCursor const& c) {
             return clang_isTranslationUnit(clang_getCursorKind(c));
         });
 }
 
 char const* vim_clang_extract_definitions(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::all,
+        __func__, arguments, libclang_vim::extraction_policy::all,
         [](CXCursor const& c) { return clang_isCursorDefinition(c); });
 }
 
 char const* vim_clang_extract_virtual_member_functions(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::all,
+        __func__, arguments, libclang_vim::extraction_policy::all,
         [](CXCursor const& c) { return clang_CXXMethod_isVirtual(c); });
 }
 
 char const*
 vim_clang_extract_pure_virtual_member_functions(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::all,
+        __func__, arguments, libclang_vim::extraction_policy::all,
         [](CXCursor const& c) { return clang_CXXMethod_isPureVirtual(c); });
 }
 
 char const* vim_clang_extract_static_member_functions(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::all,
+        __func__, arguments, libclang_vim::extraction_policy::all,
         [](CXCursor const& c) { return clang_CXXMethod_isStatic(c); });
 }
 // }}}
 
 // API to extract current file only {{{
 char const* vim_clang_extract_all_current_file(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::current_file,
+        __func__, arguments, libclang_vim::extraction_policy::current_file,
         [](CXCursor const&) -> bool { return true; });
 }
 
 char const* vim_clang_extract_declarations_current_file(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::current_file,
+        __func__, arguments, libclang_vim::extraction_policy::current_file,
         [](CXCursor const& c) {
             return clang_isDeclaration(clang_getCursorKind(c));
         });
 }
 
 char const* vim_clang_extract_attributes_current_file(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::current_file,
+        __func__, arguments, libclang_vim::extraction_policy::current_file,
         [](CXCursor const& c) {
             return clang_isAttribute(clang_getCursorKind(c));
         });
 }
 
 char const* vim_clang_extract_expressions_current_file(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::current_file,
+        __func__, arguments, libclang_vim::extraction_policy::current_file,
         [](CXCursor const& c) {
             return clang_isExpression(clang_getCursorKind(c));
         });
@@ -155,24 +249,30 @@ char const* vim_clang_extract_expressions_current_file(char const* arguments) {
 
 char const*
 vim_clang_extract_preprocessings_current_file(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::current_file,
+        __func__, arguments, libclang_vim::extraction_policy::current_file,
         [](CXCursor const& c) {
             return clang_isPreprocessing(clang_getCursorKind(c));
         });
 }
 
 char const* vim_clang_extract_references_current_file(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::current_file,
+        __func__, arguments, libclang_vim::extraction_policy::current_file,
         [](CXCursor const& c) {
             return clang_isReference(clang_getCursorKind(c));
         });
 }
 
 char const* vim_clang_extract_statements_current_file(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::current_file,
+        __func__, arguments, libclang_vim::extraction_policy::current_file,
         [](CXCursor const& c) {
             return clang_isStatement(clang_getCursorKind(c));
         });
@@ -180,52 +280,68 @@ char const* vim_clang_extract_statements_current_file(char const* arguments) {
 
 char const*
 vim_clang_extract_translation_units_current_file(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::current_file,
+        __func__, arguments, libclang_vim::extraction_policy::current_file,
         [](CXCursor const& c) {
             return clang_isTranslationUnit(clang_getCursorKind(c));
         });
 }
 
 char const* vim_clang_extract_definitions_current_file(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::current_file,
+        __func__, arguments, libclang_vim::extraction_policy::current_file,
         clang_isCursorDefinition);
 }
 
 char const*
 vim_clang_extract_virtual_member_functions_current_file(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::current_file,
+        __func__, arguments, libclang_vim::extraction_policy::current_file,
         clang_CXXMethod_isVirtual);
 }
 
 char const* vim_clang_extract_pure_virtual_member_functions_current_file(
     char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::current_file,
+        __func__, arguments, libclang_vim::extraction_policy::current_file,
         clang_CXXMethod_isPureVirtual);
 }
 
 char const*
 vim_clang_extract_static_member_functions_current_file(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::current_file,
+        __func__, arguments, libclang_vim::extraction_policy::current_file,
         clang_CXXMethod_isStatic);
 }
 // }}}
 
 // API to extract current file only {{{
 char const* vim_clang_extract_all_non_system_headers(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::non_system_headers,
+        __func__, arguments,
+        libclang_vim::extraction_policy::non_system_headers,
         [](CXCursor const&) -> bool { return true; });
 }
 
 char const*
 vim_clang_extract_declarations_non_system_headers(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::non_system_headers,
+        __func__, arguments,
+        libclang_vim::extraction_policy::non_system_headers,
         [](CXCursor const& c) {
             return clang_isDeclaration(clang_getCursorKind(c));
         });
@@ -233,8 +349,11 @@ vim_clang_extract_declarations_non_system_headers(char const* arguments) {
 
 char const*
 vim_clang_extract_attributes_non_system_headers(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::non_system_headers,
+        __func__, arguments,
+        libclang_vim::extraction_policy::non_system_headers,
         [](CXCursor const& c) {
             return clang_isAttribute(clang_getCursorKind(c));
         });
@@ -242,8 +361,11 @@ vim_clang_extract_attributes_non_system_headers(char const* arguments) {
 
 char const*
 vim_clang_extract_expressions_non_system_headers(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::non_system_headers,
+        __func__, arguments,
+        libclang_vim::extraction_policy::non_system_headers,
         [](CXCursor const& c) {
             return clang_isExpression(clang_getCursorKind(c));
         });
@@ -251,8 +373,11 @@ vim_clang_extract_expressions_non_system_headers(char const* arguments) {
 
 char const*
 vim_clang_extract_preprocessings_non_system_headers(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::non_system_headers,
+        __func__, arguments,
+        libclang_vim::extraction_policy::non_system_headers,
         [](CXCursor const& c) {
             return clang_isPreprocessing(clang_getCursorKind(c));
         });
@@ -260,8 +385,11 @@ vim_clang_extract_preprocessings_non_system_headers(char const* arguments) {
 
 char const*
 vim_clang_extract_references_non_system_headers(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::non_system_headers,
+        __func__, arguments,
+        libclang_vim::extraction_policy::non_system_headers,
         [](CXCursor const& c) {
             return clang_isReference(clang_getCursorKind(c));
         });
@@ -269,8 +397,11 @@ vim_clang_extract_references_non_system_headers(char const* arguments) {
 
 char const*
 vim_clang_extract_statements_non_system_headers(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::non_system_headers,
+        __func__, arguments,
+        libclang_vim::extraction_policy::non_system_headers,
         [](CXCursor const& c) {
             return clang_isStatement(clang_getCursorKind(c));
         });
@@ -278,8 +409,11 @@ vim_clang_extract_statements_non_system_headers(char const* arguments) {
 
 char const*
 vim_clang_extract_translation_units_non_system_headers(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::non_system_headers,
+        __func__, arguments,
+        libclang_vim::extraction_policy::non_system_headers,
         [](CXCursor const& c) {
             return clang_isTranslationUnit(clang_getCursorKind(c));
         });
@@ -287,29 +421,41 @@ vim_clang_extract_translation_units_non_system_headers(char const* arguments) {
 
 char const*
 vim_clang_extract_definitions_non_system_headers(char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::non_system_headers,
+        __func__, arguments,
+        libclang_vim::extraction_policy::non_system_headers,
         clang_isCursorDefinition);
 }
 
 char const* vim_clang_extract_virtual_member_functions_non_system_headers(
     char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::non_system_headers,
+        __func__, arguments,
+        libclang_vim::extraction_policy::non_system_headers,
         clang_CXXMethod_isVirtual);
 }
 
 char const* vim_clang_extract_pure_virtual_member_functions_non_system_headers(
     char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::non_system_headers,
+        __func__, arguments,
+        libclang_vim::extraction_policy::non_system_headers,
         clang_CXXMethod_isPureVirtual);
 }
 
 char const* vim_clang_extract_static_member_functions_non_system_headers(
     char const* arguments) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, arguments);
     return libclang_vim::extract_AST_nodes(
-        arguments, libclang_vim::extraction_policy::non_system_headers,
+        __func__, arguments,
+        libclang_vim::extraction_policy::non_system_headers,
         clang_CXXMethod_isStatic);
 }
 // }}}
@@ -317,19 +463,14 @@ char const* vim_clang_extract_static_member_functions_non_system_headers(
 
 // API to get information of specific location {{{
 char const* vim_clang_get_location_information(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     auto const location_info =
         libclang_vim::parse_args_with_location(location_string);
     char const* file_name = location_info.file.c_str();
-    auto const args_ptrs = libclang_vim::get_args_ptrs(location_info.args);
-    libclang_vim::cxindex_ptr index =
-        clang_createIndex(/*excludeDeclsFromPCH*/ 1, /*displayDiagnostics*/ 0);
-    std::vector<CXUnsavedFile> unsaved_files =
-        create_unsaved_files(location_info);
-    libclang_vim::cxtranslation_unit_ptr translation_unit(
-        clang_parseTranslationUnit(index, file_name, args_ptrs.data(),
-                                   args_ptrs.size(), unsaved_files.data(),
-                                   unsaved_files.size(),
-                                   CXTranslationUnit_Incomplete));
+    libclang_vim::cached_translation_unit_ptr translation_unit =
+        libclang_vim::parse_translation_unit_at(
+            location_info, CXTranslationUnit_Incomplete);
     if (!translation_unit)
         return "{}";
 
@@ -349,19 +490,14 @@ char const* vim_clang_get_location_information(char const* location_string) {
 // API to get extent of identifier at specific location {{{
 char const*
 vim_clang_get_extent_of_node_at_specific_location(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     auto location_info =
         libclang_vim::parse_args_with_location(location_string);
     char const* file_name = location_info.file.c_str();
-    auto const args_ptrs = libclang_vim::get_args_ptrs(location_info.args);
-    libclang_vim::cxindex_ptr index =
-        clang_createIndex(/*excludeDeclsFromPCH*/ 1, /*displayDiagnostics*/ 0);
-    std::vector<CXUnsavedFile> unsaved_files =
-        create_unsaved_files(location_info);
-    libclang_vim::cxtranslation_unit_ptr translation_unit(
-        clang_parseTranslationUnit(index, file_name, args_ptrs.data(),
-                                   args_ptrs.size(), unsaved_files.data(),
-                                   unsaved_files.size(),
-                                   CXTranslationUnit_Incomplete));
+    libclang_vim::cached_translation_unit_ptr translation_unit =
+        libclang_vim::parse_translation_unit_at(
+            location_info, CXTranslationUnit_Incomplete);
     if (!translation_unit)
         return "{}";
 
@@ -377,6 +513,8 @@ vim_clang_get_extent_of_node_at_specific_location(char const* location_string) {
 
 char const* vim_clang_get_inner_definition_extent_at_specific_location(
     char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     auto const parsed_location =
         libclang_vim::parse_args_with_location(location_string);
     return libclang_vim::get_extent(parsed_location, clang_isCursorDefinition);
@@ -384,6 +522,8 @@ char const* vim_clang_get_inner_definition_extent_at_specific_location(
 
 char const* vim_clang_get_expression_extent_at_specific_location(
     char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     auto const parsed_location =
         libclang_vim::parse_args_with_location(location_string);
     return libclang_vim::get_extent(parsed_location, [](CXCursor const& c) {
@@ -393,6 +533,8 @@ char const* vim_clang_get_expression_extent_at_specific_location(
 
 char const* vim_clang_get_statement_extent_at_specific_location(
     char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     auto const parsed_location =
         libclang_vim::parse_args_with_location(location_string);
     return libclang_vim::get_extent(parsed_location, [](CXCursor const& c) {
@@ -402,6 +544,8 @@ char const* vim_clang_get_statement_extent_at_specific_location(
 
 char const*
 vim_clang_get_class_extent_at_specific_location(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     auto const parsed_location =
         libclang_vim::parse_args_with_location(location_string);
     return libclang_vim::get_extent(parsed_location,
@@ -410,6 +554,8 @@ vim_clang_get_class_extent_at_specific_location(char const* location_string) {
 
 char const* vim_clang_get_function_extent_at_specific_location(
     char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     auto const parsed_location =
         libclang_vim::parse_args_with_location(location_string);
     return libclang_vim::get_extent(parsed_location,
@@ -418,6 +564,8 @@ char const* vim_clang_get_function_extent_at_specific_location(
 
 char const* vim_clang_get_parameter_extent_at_specific_location(
     char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     auto const parsed_location =
         libclang_vim::parse_args_with_location(location_string);
     return libclang_vim::get_extent(parsed_location,
@@ -426,6 +574,8 @@ char const* vim_clang_get_parameter_extent_at_specific_location(
 
 char const* vim_clang_get_namespace_extent_at_specific_location(
     char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     auto const parsed_location =
         libclang_vim::parse_args_with_location(location_string);
     return libclang_vim::get_extent(parsed_location, [](CXCursor const& c) {
@@ -435,6 +585,8 @@ char const* vim_clang_get_namespace_extent_at_specific_location(
 // }}}
 
 char const* vim_clang_get_definition_at(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     auto const parsed_location =
         libclang_vim::parse_args_with_location(location_string);
     return libclang_vim::get_related_node_of(parsed_location,
@@ -442,6 +594,8 @@ char const* vim_clang_get_definition_at(char const* location_string) {
 }
 
 char const* vim_clang_get_referenced_at(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     auto const parsed_location =
         libclang_vim::parse_args_with_location(location_string);
     return libclang_vim::get_related_node_of(parsed_location,
@@ -449,6 +603,8 @@ char const* vim_clang_get_referenced_at(char const* location_string) {
 }
 
 char const* vim_clang_get_declaration_at(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     stderr_guard g;
     auto const parsed_location =
         libclang_vim::parse_args_with_location(location_string);
@@ -457,6 +613,8 @@ char const* vim_clang_get_declaration_at(char const* location_string) {
 }
 
 char const* vim_clang_get_pointee_type_at(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     auto const parsed_location =
         libclang_vim::parse_args_with_location(location_string);
     return libclang_vim::get_type_related_to(parsed_location,
@@ -464,6 +622,8 @@ char const* vim_clang_get_pointee_type_at(char const* location_string) {
 }
 
 char const* vim_clang_get_canonical_type_at(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     auto const parsed_location =
         libclang_vim::parse_args_with_location(location_string);
     return libclang_vim::get_type_related_to(parsed_location,
@@ -471,6 +631,8 @@ char const* vim_clang_get_canonical_type_at(char const* location_string) {
 }
 
 char const* vim_clang_get_result_type_at(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     auto const parsed_location =
         libclang_vim::parse_args_with_location(location_string);
     return libclang_vim::get_type_related_to(parsed_location,
@@ -479,6 +641,8 @@ char const* vim_clang_get_result_type_at(char const* location_string) {
 
 char const*
 vim_clang_get_class_type_of_member_pointer_at(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     auto const parsed_location =
         libclang_vim::parse_args_with_location(location_string);
     return libclang_vim::get_type_related_to(parsed_location,
@@ -486,26 +650,43 @@ vim_clang_get_class_type_of_member_pointer_at(char const* location_string) {
 }
 
 char const* vim_clang_get_all_extents_at(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     return libclang_vim::get_all_extents(
         libclang_vim::parse_args_with_location(location_string));
 }
 
+char const* vim_clang_get_references_in_file_at(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
+    return libclang_vim::get_references_in_file_at(
+        libclang_vim::parse_args_with_location(location_string));
+}
+
 char const* vim_clang_deduce_var_decl_at(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     return libclang_vim::deduce_var_decl_type(
         libclang_vim::parse_args_with_location(location_string));
 }
 
 char const* vim_clang_deduce_func_decl_at(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     return libclang_vim::deduce_func_return_type(
         libclang_vim::parse_args_with_location(location_string));
 }
 
 char const* vim_clang_deduce_func_or_var_decl_at(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     return libclang_vim::deduce_func_or_var_decl(
         libclang_vim::parse_args_with_location(location_string));
 }
 
 char const* vim_clang_get_type_with_deduction_at(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     stderr_guard g;
 
     const char* ret = libclang_vim::deduce_type_at(
@@ -513,7 +694,20 @@ char const* vim_clang_get_type_with_deduction_at(char const* location_string) {
     return ret;
 }
 
+char const* vim_clang_get_inlay_hints(char const* range_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, range_string);
+    stderr_guard g;
+
+    // "file:args:first line:last line", same syntax as a location.
+    const char* ret = libclang_vim::get_inlay_hints(
+        libclang_vim::parse_args_with_location(range_string));
+    return ret;
+}
+
 char const* vim_clang_get_current_function_at(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     stderr_guard g;
 
     const char* ret = libclang_vim::get_current_function_at(
@@ -522,6 +716,8 @@ char const* vim_clang_get_current_function_at(char const* location_string) {
 }
 
 char const* vim_clang_get_full_name_at(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     stderr_guard g;
 
     const char* ret = libclang_vim::get_full_name_at(
@@ -530,6 +726,8 @@ char const* vim_clang_get_full_name_at(char const* location_string) {
 }
 
 char const* vim_clang_get_completion_at(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     stderr_guard g;
 
     const char* ret = libclang_vim::get_completion_at(
@@ -537,7 +735,19 @@ char const* vim_clang_get_completion_at(char const* location_string) {
     return ret;
 }
 
+char const* vim_clang_get_hover_at(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
+    stderr_guard g;
+
+    const char* ret = libclang_vim::get_hover_at(
+        libclang_vim::parse_args_with_location(location_string));
+    return ret;
+}
+
 char const* vim_clang_get_comment_at(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     stderr_guard g;
 
     const char* ret = libclang_vim::get_comment_at(
@@ -546,6 +756,8 @@ char const* vim_clang_get_comment_at(char const* location_string) {
 }
 
 char const* vim_clang_get_deduced_declaration_at(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     stderr_guard g;
 
     const char* ret = libclang_vim::get_deduced_declaration_at(
@@ -554,6 +766,8 @@ char const* vim_clang_get_deduced_declaration_at(char const* location_string) {
 }
 
 char const* vim_clang_get_include_at(const char* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
     stderr_guard g;
 
     const char* ret = libclang_vim::get_include_at(
@@ -561,7 +775,63 @@ char const* vim_clang_get_include_at(const char* location_string) {
     return ret;
 }
 
+char const* vim_clang_get_inclusions(char const* file) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, file);
+    return libclang_vim::get_inclusions(file);
+}
+
+char const* vim_clang_get_includers(char const* file) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, file);
+    return libclang_vim::get_includers(file);
+}
+
+char const* vim_clang_invalidate_dependents(char const* file) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, file);
+    return libclang_vim::invalidate_dependents(file);
+}
+
+char const* vim_clang_start_watching(char const*) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, "");
+    return libclang_vim::start_watching();
+}
+
+char const* vim_clang_poll_watching(char const*) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, "");
+    return libclang_vim::poll_watching();
+}
+
+char const* vim_clang_stop_watching(char const*) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, "");
+    return libclang_vim::stop_watching();
+}
+
+char const* vim_clang_build_shared_pch(char const* request) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, request);
+    return libclang_vim::build_shared_pch(request);
+}
+
+char const* vim_clang_clear_shared_pch(char const*) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, "");
+    return libclang_vim::clear_shared_pch();
+}
+
+char const* vim_clang_get_translation_unit_usage(char const*) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, "");
+    return libclang_vim::get_translation_unit_usage();
+}
+
 char const* vim_clang_get_compile_commands(char const* file) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, file);
     stderr_guard g;
 
     const char* ret = libclang_vim::get_compile_commands(
@@ -570,13 +840,144 @@ char const* vim_clang_get_compile_commands(char const* file) {
 }
 
 char const* vim_clang_get_diagnostics(const char* file_and_args) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, file_and_args);
     stderr_guard g;
 
-    const char* ret = libclang_vim::get_diagnostics(
-        libclang_vim::parse_default_args(file_and_args));
+    auto const parsed = libclang_vim::parse_default_args(file_and_args);
+    const char* ret = libclang_vim::get_result_cache().get(
+        "diagnostics", parsed,
+        [&parsed] { return libclang_vim::get_diagnostics(parsed); });
     return ret;
 }
 
+char const* vim_clang_start_diagnostics_sweep(char const* request) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, request);
+    return libclang_vim::start_diagnostics_sweep(request);
+}
+
+char const* vim_clang_poll_diagnostics_sweep(char const*) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, "");
+    return libclang_vim::poll_diagnostics_sweep();
+}
+
+char const* vim_clang_cancel_diagnostics_sweep(char const*) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, "");
+    return libclang_vim::cancel_diagnostics_sweep();
+}
+
+char const* vim_clang_start_indexing(char const* request) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, request);
+    return libclang_vim::start_indexing(request);
+}
+
+char const* vim_clang_poll_indexing(char const*) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, "");
+    return libclang_vim::poll_indexing();
+}
+
+char const* vim_clang_cancel_indexing(char const*) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, "");
+    return libclang_vim::cancel_indexing();
+}
+
+char const* vim_clang_start_reference_search(char const* request) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, request);
+    return libclang_vim::start_reference_search(request);
+}
+
+char const* vim_clang_poll_reference_search(char const*) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, "");
+    return libclang_vim::poll_reference_search();
+}
+
+char const* vim_clang_cancel_reference_search(char const*) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, "");
+    return libclang_vim::cancel_reference_search();
+}
+
+char const* vim_clang_get_indexed_definitions_at(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
+    return libclang_vim::get_indexed_occurrences_at(
+        libclang_vim::parse_args_with_location(location_string),
+        libclang_vim::symbol_definition);
+}
+
+char const*
+vim_clang_get_indexed_declarations_at(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
+    return libclang_vim::get_indexed_occurrences_at(
+        libclang_vim::parse_args_with_location(location_string),
+        libclang_vim::symbol_declaration | libclang_vim::symbol_definition);
+}
+
+char const* vim_clang_get_indexed_references_at(char const* location_string) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, location_string);
+    return libclang_vim::get_indexed_occurrences_at(
+        libclang_vim::parse_args_with_location(location_string),
+        libclang_vim::symbol_reference);
+}
+
+char const* vim_clang_search_workspace_symbols(char const* request) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, request);
+    return libclang_vim::search_workspace_symbols(request);
+}
+
+char const* vim_clang_get_incoming_calls(char const* request) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, request);
+    return libclang_vim::get_incoming_calls(request);
+}
+
+char const* vim_clang_get_outgoing_calls(char const* request) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, request);
+    return libclang_vim::get_outgoing_calls(request);
+}
+
+char const* vim_clang_get_base_classes(char const* request) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, request);
+    return libclang_vim::get_base_classes(request);
+}
+
+char const* vim_clang_get_derived_classes(char const* request) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, request);
+    return libclang_vim::get_derived_classes(request);
+}
+
+char const* vim_clang_get_implementations(char const* request) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, request);
+    return libclang_vim::get_implementations(request);
+}
+
+char const* vim_clang_update_unsaved_file(char const* update) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, update);
+    return libclang_vim::update_unsaved_file(update);
+}
+
+char const* vim_clang_discard_unsaved_file(char const* file) {
+    libclang_vim::scoped_timer timer(__func__);
+    libclang_vim::record_call(__func__, file);
+    return libclang_vim::discard_unsaved_file(file);
+}
+
 } // extern "C"
 
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -1,12 +1,131 @@
 #include "deduction.hpp"
 
+#include <cstring>
+
 #include <clang-c/CXCompilationDatabase.h>
 
+#include "include_graph.hpp"
+#include "stats.hpp"
+#include "translation_unit_cache.hpp"
+
 namespace {
 
+std::string get_directory(const std::string& file) {
+    const auto slash = file.rfind('/');
+    if (slash == std::string::npos)
+        return ".";
+    if (slash == 0)
+        return "/";
+    return file.substr(0, slash);
+}
+
+/// File name without its directory and its last extension.
+std::string get_stem(const std::string& file) {
+    const auto slash = file.rfind('/');
+    const std::string name =
+        slash == std::string::npos ? file : file.substr(slash + 1);
+    return name.substr(0, name.rfind('.'));
+}
+
+/// Last extension of file, including the dot.
+std::string get_extension(const std::string& file) {
+    const auto dot = file.rfind('.');
+    if (dot == std::string::npos || file.find('/', dot) != std::string::npos)
+        return std::string();
+    return file.substr(dot);
+}
+
+/// Absolute name of the file compiled by command.
+std::string get_command_file(CXCompileCommand command) {
+    libclang_vim::cxstring_ptr file = clang_CompileCommand_getFilename(command);
+    std::string name = clang_getCString(file);
+    if (!name.empty() && name[0] != '/') {
+        libclang_vim::cxstring_ptr directory =
+            clang_CompileCommand_getDirectory(command);
+        name = std::string(clang_getCString(directory)) + "/" + name;
+    }
+    return name;
+}
+
+/// Appends the arguments of the first command for file in database to args,
+/// except the name of the compiled file. Returns false if there is none.
+bool add_command_args(CXCompilationDatabase database, const std::string& file,
+                      libclang_vim::args_type& args) {
+    CXCompileCommands commands =
+        clang_CompilationDatabase_getCompileCommands(database, file.c_str());
+    unsigned commandsSize = clang_CompileCommands_getSize(commands);
+    if (commandsSize >= 1) {
+        CXCompileCommand command =
+            clang_CompileCommands_getCommand(commands, 0);
+        libclang_vim::cxstring_ptr command_file =
+            clang_CompileCommand_getFilename(command);
+        unsigned num_args = clang_CompileCommand_getNumArgs(command);
+        for (unsigned i = 0; i < num_args; ++i) {
+            libclang_vim::cxstring_ptr arg =
+                clang_CompileCommand_getArg(command, i);
+            if (file != clang_getCString(arg) &&
+                std::strcmp(clang_getCString(command_file),
+                            clang_getCString(arg)) != 0)
+                args.emplace_back(clang_getCString(arg));
+        }
+    }
+    clang_CompileCommands_dispose(commands);
+    return commandsSize >= 1;
+}
+
+/// Finds a unit in database known to include the header file, preferably one
+/// with the same stem.
+std::string find_including_owner(CXCompilationDatabase database,
+                                 const std::string& file) {
+    const std::string stem = get_stem(file);
+    const std::set<std::string> units =
+        libclang_vim::get_include_graph().get_dependent_units(
+            libclang_vim::get_real_path(file));
+    std::string owner;
+    for (const auto& unit : units) {
+        CXCompileCommands commands =
+            clang_CompilationDatabase_getCompileCommands(database,
+                                                         unit.c_str());
+        const bool known = clang_CompileCommands_getSize(commands) >= 1;
+        clang_CompileCommands_dispose(commands);
+        if (known && (owner.empty() ||
+                      (get_stem(unit) == stem && get_stem(owner) != stem)))
+            owner = unit;
+    }
+    return owner;
+}
+
+/// Finds a source file in database with the same stem as the header file,
+/// preferably in the same directory.
+std::string find_namesake_owner(CXCompilationDatabase database,
+                                const std::string& file) {
+    const std::string stem = get_stem(file);
+    const std::string directory =
+        get_directory(libclang_vim::get_real_path(file));
+    std::string owner;
+    CXCompileCommands commands =
+        clang_CompilationDatabase_getAllCompileCommands(database);
+    unsigned size = clang_CompileCommands_getSize(commands);
+    for (unsigned i = 0; i < size; ++i) {
+        const std::string name =
+            get_command_file(clang_CompileCommands_getCommand(commands, i));
+        if (libclang_vim::is_header_file(name) || get_stem(name) != stem)
+            continue;
+        if (owner.empty() || (get_directory(name) == directory &&
+                              get_directory(owner) != directory))
+            owner = name;
+    }
+    clang_CompileCommands_dispose(commands);
+    return owner;
+}
+
 /// Look up compilation arguments for a file from a database in one of its
-/// parent directories.
-libclang_vim::args_type parse_compilation_database(const std::string& file) {
+/// parent directories. A header without commands of its own borrows the ones
+/// of a source file including it, or of the source file with the same stem:
+/// that one is set as owner then.
+libclang_vim::args_type parse_compilation_database(const std::string& file,
+                                                   std::string& owner) {
+    libclang_vim::scoped_timer timer("compilation_database");
     libclang_vim::args_type ret;
 
     std::size_t found = file.find_last_of("/\\");
@@ -36,22 +155,26 @@ libclang_vim::args_type parse_compilation_database(const std::string& file) {
     CXCompilationDatabase database =
         clang_CompilationDatabase_fromDirectory(directory.c_str(), &error);
     if (error == CXCompilationDatabase_NoError) {
-        CXCompileCommands commands =
-            clang_CompilationDatabase_getCompileCommands(database,
-                                                         file.c_str());
-        unsigned commandsSize = clang_CompileCommands_getSize(commands);
-        if (commandsSize >= 1) {
-            CXCompileCommand command =
-                clang_CompileCommands_getCommand(commands, 0);
-            unsigned args = clang_CompileCommand_getNumArgs(command);
-            for (unsigned i = 0; i < args; ++i) {
-                libclang_vim::cxstring_ptr arg =
-                    clang_CompileCommand_getArg(command, i);
-                if (file != clang_getCString(arg))
-                    ret.emplace_back(clang_getCString(arg));
+        const bool header = libclang_vim::is_header_file(file);
+        // A unit really including the header beats the guess newer libclang
+        // versions make for files missing from the database.
+        if (header)
+            owner = find_including_owner(database, file);
+        if (owner.empty() || !add_command_args(database, owner, ret)) {
+            owner.clear();
+            if (!add_command_args(database, file, ret) && header) {
+                owner = find_namesake_owner(database, file);
+                if (!owner.empty())
+                    add_command_args(database, owner, ret);
             }
         }
-        clang_CompileCommands_dispose(commands);
+
+        // The arguments of a C++ source would parse a .h file as C.
+        if (!owner.empty() && get_extension(file) == ".h" &&
+            get_extension(owner) != ".c") {
+            ret.emplace_back("-x");
+            ret.emplace_back("c++-header");
+        }
     }
     clang_CompilationDatabase_dispose(database);
 
@@ -155,6 +278,103 @@ CXType deduce_type_at_cursor(const CXCursor& cursor) {
     }
     return type;
 }
+
+/// Type of cursor, or of its first child having one, with auto deduced.
+CXType deduce_cursor_type(const CXCursor& cursor) {
+    CXCursor valid_cursor = cursor;
+    if (is_invalid_type_cursor(valid_cursor)) {
+        clang_visitChildren(cursor, valid_type_cursor_getter, &valid_cursor);
+    }
+    if (is_invalid_type_cursor(valid_cursor)) {
+        return clang_getCursorType(valid_cursor);
+    }
+
+    CXCursorKind const kind = clang_getCursorKind(valid_cursor);
+    return kind == CXCursor_VarDecl
+               ? deduce_type_at_cursor(valid_cursor)
+               : libclang_vim::is_function_decl_kind(kind)
+                     ? deduce_func_decl_type_at_cursor(valid_cursor)
+                     : clang_getCursorType(valid_cursor);
+}
+
+/// Name of cursor with the enclosing namespaces and classes.
+std::string get_full_name(CXCursor cursor) {
+    std::string name;
+    while (clang_getCursorKind(cursor) != CXCursor_TranslationUnit) {
+        libclang_vim::cxstring_ptr spelling = clang_getCursorSpelling(cursor);
+        name = std::string(clang_getCString(spelling)) +
+               (name.empty() ? "" : "::") + name;
+
+        cursor = clang_getCursorSemanticParent(cursor);
+        if (clang_Cursor_isNull(cursor) ||
+            clang_isInvalid(clang_getCursorKind(cursor)))
+            break;
+    }
+    return name;
+}
+
+/// Dictionary items with the location of the declaration canonical_cursor.
+std::string stringize_declaration(CXCursor canonical_cursor) {
+    CXSourceLocation declaration_location =
+        clang_getCursorLocation(canonical_cursor);
+    CXFile declaration_file;
+    unsigned declaration_line;
+    unsigned declaration_col;
+    clang_getExpansionLocation(declaration_location, &declaration_file,
+                               &declaration_line, &declaration_col, nullptr);
+    libclang_vim::cxstring_ptr declaration_file_name =
+        clang_getFileName(declaration_file);
+    std::stringstream ss;
+    ss << "'file':'" << clang_getCString(declaration_file_name) << "',";
+    ss << "'line':'" << declaration_line << "',";
+    ss << "'col':'" << declaration_col << "',";
+    return ss.str();
+}
+
+/// Offset of the start of line in contents, or size if there are less lines.
+std::size_t get_line_offset(const char* contents, std::size_t size,
+                            std::size_t line) {
+    std::size_t offset = 0;
+    for (; line > 1 && offset < size; --line) {
+        const void* end = std::memchr(contents + offset, '\n', size - offset);
+        if (!end)
+            return size;
+        offset = static_cast<const char*>(end) - contents + 1;
+    }
+    return offset;
+}
+
+/// Describes the deduced type of the declaration at cursor, spelled with
+/// auto, or returns an empty string if it's not deducible, e.g. a parameter
+/// of a generic lambda.
+std::string stringize_inlay_hint(CXCursor cursor) {
+    const CXCursorKind kind = clang_getCursorKind(cursor);
+    const char* hint_kind = nullptr;
+    CXType type{};
+    type.kind = CXType_Invalid;
+    if (kind == CXCursor_VarDecl) {
+        hint_kind = "variable";
+        type = deduce_type_at_cursor(cursor);
+    } else if (libclang_vim::is_function_decl_kind(kind)) {
+        hint_kind = "return";
+        type = deduce_func_decl_type_at_cursor(cursor);
+    } else if (kind == CXCursor_UnexposedDecl) {
+        // Structured bindings are not exposed.
+        hint_kind = "binding";
+        type = deduce_type_at_cursor(cursor);
+    }
+    if (!hint_kind || type.kind == CXType_Invalid)
+        return std::string();
+    libclang_vim::cxstring_ptr type_name = clang_getTypeSpelling(type);
+    if (is_auto_type(to_c_str(type_name)))
+        return std::string();
+
+    libclang_vim::cxstring_ptr name = clang_getCursorSpelling(cursor);
+    return "'kind':'" + std::string(hint_kind) + "','name':'" +
+           to_c_str(name) + "'," + libclang_vim::stringize_type(type) +
+           "'canonical':{" +
+           libclang_vim::stringize_type(clang_getCanonicalType(type)) + "},";
+}
 }
 
 const char*
@@ -241,22 +461,7 @@ libclang_vim::deduce_func_return_type(const location_tuple& location_info) {
 const char* libclang_vim::deduce_type_at(const location_tuple& location_info) {
     return at_specific_location(
         location_info, [](CXCursor const& cursor) -> std::string {
-            CXCursor valid_cursor = cursor;
-            if (is_invalid_type_cursor(valid_cursor)) {
-                clang_visitChildren(cursor, valid_type_cursor_getter,
-                                    &valid_cursor);
-            }
-            if (is_invalid_type_cursor(valid_cursor)) {
-                return "{}";
-            }
-
-            CXCursorKind const kind = clang_getCursorKind(valid_cursor);
-            CXType const result_type =
-                kind == CXCursor_VarDecl
-                    ? deduce_type_at_cursor(valid_cursor)
-                    : is_function_decl_kind(kind)
-                          ? deduce_func_decl_type_at_cursor(valid_cursor)
-                          : clang_getCursorType(valid_cursor);
+            CXType const result_type = deduce_cursor_type(cursor);
             if (result_type.kind == CXType_Invalid) {
                 return "{}";
             }
@@ -270,6 +475,79 @@ const char* libclang_vim::deduce_type_at(const location_tuple& location_info) {
         });
 }
 
+const char* libclang_vim::get_inlay_hints(const location_tuple& location_info) {
+    static std::string vimson;
+
+    scoped_timer parse_timer("inlay_hints.parse");
+    cached_translation_unit_ptr translation_unit = parse_translation_unit_at(
+        location_info, CXTranslationUnit_Incomplete);
+    if (!translation_unit)
+        return "[]";
+    parse_timer.stop();
+
+    CXFile file = clang_getFile(translation_unit, location_info.file.c_str());
+    std::size_t size = 0;
+    const char* contents =
+        file ? clang_getFileContents(translation_unit, file, &size) : nullptr;
+    if (!contents)
+        return "[]";
+
+    const std::size_t begin =
+        get_line_offset(contents, size, location_info.line);
+    const std::size_t end =
+        get_line_offset(contents, size, location_info.col + 1);
+    if (begin >= end)
+        return "[]";
+
+    // Annotating all tokens of the range at once maps each one to the
+    // innermost declaration around it in a single walk.
+    scoped_timer annotate_timer("inlay_hints.annotate");
+    CXSourceRange range = clang_getRange(
+        clang_getLocationForOffset(translation_unit, file, begin),
+        clang_getLocationForOffset(translation_unit, file, end));
+    CXToken* tokens = nullptr;
+    unsigned token_count = 0;
+    clang_tokenize(translation_unit, range, &tokens, &token_count);
+    std::vector<CXCursor> cursors(token_count);
+    clang_annotateTokens(translation_unit, tokens, token_count,
+                         cursors.data());
+    annotate_timer.stop();
+
+    std::stringstream ss;
+    ss << "[";
+    CXCursor previous = clang_getNullCursor();
+    for (unsigned i = 0; i < token_count; ++i) {
+        if (clang_getTokenKind(tokens[i]) != CXToken_Keyword)
+            continue;
+        cxstring_ptr spelling =
+            clang_getTokenSpelling(translation_unit, tokens[i]);
+        if (std::strcmp(clang_getCString(spelling), "auto") != 0 ||
+            clang_equalCursors(cursors[i], previous))
+            continue;
+        previous = cursors[i];
+
+        // The token at the end of the range is included.
+        unsigned line, column;
+        clang_getSpellingLocation(
+            clang_getTokenLocation(translation_unit, tokens[i]), nullptr,
+            &line, &column, nullptr);
+        if (line > location_info.col)
+            continue;
+
+        const std::string hint = stringize_inlay_hint(cursors[i]);
+        if (hint.empty())
+            continue;
+
+        ss << "{'line':" << line << ",'column':" << column << "," << hint
+           << "},";
+    }
+    ss << "]";
+    clang_disposeTokens(translation_unit, tokens, token_count);
+
+    vimson = ss.str();
+    return vimson.c_str();
+}
+
 const char* libclang_vim::get_compile_commands(const std::string& file) {
     static std::string vimson;
 
@@ -277,43 +555,27 @@ const char* libclang_vim::get_compile_commands(const std::string& file) {
     std::stringstream ss;
     ss << "{'commands':'";
 
-    args_type args = parse_compilation_database(file);
+    std::string owner;
+    args_type args = parse_compilation_database(file, owner);
     for (std::size_t i = 0; i < args.size(); ++i) {
         if (i)
             ss << " ";
         ss << args[i];
     }
+    ss << "'";
+    if (!owner.empty())
+        ss << ",'owner':'" << owner << "'";
 
     // Write the footer.
-    ss << "'}";
+    ss << "}";
     vimson = ss.str();
     return vimson.c_str();
 }
 
-const char*
-libclang_vim::get_current_function_at(const location_tuple& location_info) {
-    static std::string vimson;
-
-    // Write the header.
-    std::stringstream ss;
-    ss << "{'name':'";
-
-    // Write the actual name.
-    cxindex_ptr index = clang_createIndex(/*excludeDeclarationsFromPCH=*/1,
-                                          /*displayDiagnostics=*/0);
-
-    std::string file_name = location_info.file;
-    std::vector<const char*> args_ptrs = get_args_ptrs(location_info.args);
-    std::vector<CXUnsavedFile> unsaved_files =
-        create_unsaved_files(location_info);
-    unsigned options = CXTranslationUnit_Incomplete;
-    cxtranslation_unit_ptr translation_unit(clang_parseTranslationUnit(
-        index, file_name.c_str(), args_ptrs.data(), args_ptrs.size(),
-        unsaved_files.data(), unsaved_files.size(), options));
-    if (!translation_unit)
-        return "{}";
-
-    CXFile file = clang_getFile(translation_unit, file_name.c_str());
+CXCursor
+libclang_vim::get_function_cursor_at(CXTranslationUnit translation_unit,
+                                     const location_tuple& location_info) {
+    CXFile file = clang_getFile(translation_unit, location_info.file.c_str());
     unsigned line = location_info.line;
     unsigned column = location_info.col;
 
@@ -340,8 +602,26 @@ libclang_vim::get_current_function_at(const location_tuple& location_info) {
         cursor = clang_getCursorSemanticParent(cursor);
         kind = clang_getCursorKind(cursor);
     }
+    return cursor;
+}
+
+const char*
+libclang_vim::get_current_function_at(const location_tuple& location_info) {
+    static std::string vimson;
+
+    // Write the header.
+    std::stringstream ss;
+    ss << "{'name':'";
 
-    if (kind != CXCursor_TranslationUnit) {
+    // Write the actual name.
+    unsigned options = CXTranslationUnit_Incomplete;
+    cached_translation_unit_ptr translation_unit =
+        parse_translation_unit_at(location_info, options);
+    if (!translation_unit)
+        return "{}";
+
+    CXCursor cursor = get_function_cursor_at(translation_unit, location_info);
+    if (clang_getCursorKind(cursor) != CXCursor_TranslationUnit) {
         std::stack<std::string> stack;
         while (true) {
             cxstring_ptr aString = clang_getCursorSpelling(cursor);
@@ -380,17 +660,10 @@ libclang_vim::get_full_name_at(const location_tuple& location_info) {
     ss << "{'name':'";
 
     // Write the actual name.
-    cxindex_ptr index = clang_createIndex(/*excludeDeclarationsFromPCH=*/1,
-                                          /*displayDiagnostics=*/0);
-
     std::string file_name = location_info.file;
-    std::vector<const char*> args_ptrs = get_args_ptrs(location_info.args);
-    std::vector<CXUnsavedFile> unsaved_files =
-        create_unsaved_files(location_info);
     unsigned options = CXTranslationUnit_Incomplete;
-    cxtranslation_unit_ptr translation_unit(clang_parseTranslationUnit(
-        index, file_name.c_str(), args_ptrs.data(), args_ptrs.size(),
-        unsaved_files.data(), unsaved_files.size(), options));
+    cached_translation_unit_ptr translation_unit =
+        parse_translation_unit_at(location_info, options);
     if (!translation_unit)
         return "{}";
 
@@ -410,28 +683,7 @@ libclang_vim::get_full_name_at(const location_tuple& location_info) {
         clang_isInvalid(clang_getCursorKind(cursor)))
         return "{}";
 
-    CXCursorKind kind = clang_getCursorKind(cursor);
-    if (kind != CXCursor_TranslationUnit) {
-        std::stack<std::string> stack;
-        while (true) {
-            cxstring_ptr spelling = clang_getCursorSpelling(cursor);
-            stack.push(clang_getCString(spelling));
-
-            cursor = clang_getCursorSemanticParent(cursor);
-            if (clang_getCursorKind(cursor) == CXCursor_TranslationUnit)
-                break;
-        }
-
-        bool first = true;
-        while (!stack.empty()) {
-            if (first)
-                first = false;
-            else
-                ss << "::";
-            ss << stack.top();
-            stack.pop();
-        }
-    }
+    ss << get_full_name(cursor);
 
     // Write the footer.
     ss << "'}";
@@ -447,17 +699,10 @@ const char* libclang_vim::get_comment_at(const location_tuple& location_info) {
     ss << "{'brief':'";
 
     // Write the actual comment.
-    cxindex_ptr index = clang_createIndex(/*excludeDeclarationsFromPCH=*/1,
-                                          /*displayDiagnostics=*/0);
-
     std::string file_name = location_info.file;
-    std::vector<const char*> args_ptrs = get_args_ptrs(location_info.args);
-    std::vector<CXUnsavedFile> unsaved_files =
-        create_unsaved_files(location_info);
     unsigned options = CXTranslationUnit_Incomplete;
-    cxtranslation_unit_ptr translation_unit(clang_parseTranslationUnit(
-        index, file_name.c_str(), args_ptrs.data(), args_ptrs.size(),
-        unsaved_files.data(), unsaved_files.size(), options));
+    cached_translation_unit_ptr translation_unit =
+        parse_translation_unit_at(location_info, options);
     if (!translation_unit)
         return "{}";
 
@@ -500,17 +745,10 @@ libclang_vim::get_deduced_declaration_at(const location_tuple& location_info) {
     ss << "{";
 
     // Write the actual comment.
-    cxindex_ptr index = clang_createIndex(/*excludeDeclarationsFromPCH=*/1,
-                                          /*displayDiagnostics=*/0);
-
     std::string file_name = location_info.file;
-    std::vector<const char*> args_ptrs = get_args_ptrs(location_info.args);
-    std::vector<CXUnsavedFile> unsaved_files =
-        create_unsaved_files(location_info);
     CXTranslationUnit_Flags flags = CXTranslationUnit_Incomplete;
-    cxtranslation_unit_ptr translation_unit(clang_parseTranslationUnit(
-        index, file_name.c_str(), args_ptrs.data(), args_ptrs.size(),
-        unsaved_files.data(), unsaved_files.size(), flags));
+    cached_translation_unit_ptr translation_unit =
+        parse_translation_unit_at(location_info, flags);
     if (!translation_unit)
         return "{}";
 
@@ -534,17 +772,7 @@ libclang_vim::get_deduced_declaration_at(const location_tuple& location_info) {
         clang_isInvalid(clang_getCursorKind(canonical_cursor)))
         return "{}";
 
-    CXSourceLocation declaration_location =
-        clang_getCursorLocation(canonical_cursor);
-    CXFile declaration_file;
-    unsigned declaration_line;
-    unsigned declaration_col;
-    clang_getExpansionLocation(declaration_location, &declaration_file,
-                               &declaration_line, &declaration_col, nullptr);
-    cxstring_ptr declaration_file_name = clang_getFileName(declaration_file);
-    ss << "'file':'" << clang_getCString(declaration_file_name) << "',";
-    ss << "'line':'" << declaration_line << "',";
-    ss << "'col':'" << declaration_col << "',";
+    ss << stringize_declaration(canonical_cursor);
 
     // Write the footer.
     ss << "}";
@@ -552,6 +780,75 @@ libclang_vim::get_deduced_declaration_at(const location_tuple& location_info) {
     return vimson.c_str();
 }
 
+const char* libclang_vim::get_hover_at(const location_tuple& location_info) {
+    static std::string vimson;
+
+    cached_translation_unit_ptr translation_unit = parse_translation_unit_at(
+        location_info, CXTranslationUnit_Incomplete);
+    if (!translation_unit)
+        return "{}";
+
+    CXFile file = clang_getFile(translation_unit, location_info.file.c_str());
+    CXSourceLocation source_location = clang_getLocation(
+        translation_unit, file, location_info.line, location_info.col);
+    CXCursor cursor = clang_getCursor(translation_unit, source_location);
+    if (clang_Cursor_isNull(cursor) ||
+        clang_isInvalid(clang_getCursorKind(cursor)))
+        return "{}";
+
+    CXCursor referenced_cursor = clang_getCursorReferenced(cursor);
+    const bool referenced =
+        !clang_Cursor_isNull(referenced_cursor) &&
+        !clang_isInvalid(clang_getCursorKind(referenced_cursor));
+
+    std::stringstream ss;
+    ss << "{";
+    CXType type = deduce_cursor_type(cursor);
+    // E.g. a member function in a call has a placeholder type.
+    if (referenced && clang_isExpression(clang_getCursorKind(cursor)) &&
+        (type.kind == CXType_Invalid || type.kind == CXType_Unexposed))
+        type = deduce_cursor_type(referenced_cursor);
+    if (type.kind != CXType_Invalid) {
+        ss << stringize_type(type) << "'canonical':{"
+           << stringize_type(clang_getCanonicalType(type)) << "},";
+    }
+
+    // The rest is about the declaration of what is referenced.
+    if (referenced) {
+        ss << "'name':'" << get_full_name(referenced_cursor) << "',";
+
+        CXCursor canonical_cursor = clang_getCanonicalCursor(referenced_cursor);
+        cxstring_ptr brief = clang_Cursor_getBriefCommentText(canonical_cursor);
+        if (clang_getCString(brief))
+            ss << "'brief':" << stringize_string(clang_getCString(brief))
+               << ",";
+        cxstring_ptr comment = clang_Cursor_getRawCommentText(canonical_cursor);
+        if (clang_getCString(comment))
+            ss << "'comment':" << stringize_string(clang_getCString(comment))
+               << ",";
+        ss << "'declaration':{" << stringize_declaration(canonical_cursor)
+           << "},";
+
+        const int argument_count =
+            clang_Cursor_getNumArguments(referenced_cursor);
+        if (argument_count >= 0) {
+            ss << "'parameters':[";
+            for (int i = 0; i < argument_count; ++i) {
+                CXCursor argument =
+                    clang_Cursor_getArgument(referenced_cursor, i);
+                cxstring_ptr name = clang_getCursorSpelling(argument);
+                ss << "{'name':'" << clang_getCString(name) << "',"
+                   << stringize_type(clang_getCursorType(argument)) << "},";
+            }
+            ss << "],";
+        }
+    }
+    ss << "}";
+
+    vimson = ss.str();
+    return vimson.c_str();
+}
+
 const char* libclang_vim::get_include_at(const location_tuple& location_info) {
     static std::string vimson;
 
@@ -560,18 +857,11 @@ const char* libclang_vim::get_include_at(const location_tuple& location_info) {
     ss << "{'file':'";
 
     // Write the actual comment.
-    cxindex_ptr index = clang_createIndex(/*excludeDeclarationsFromPCH=*/1,
-                                          /*displayDiagnostics=*/0);
-
     std::string file_name = location_info.file;
-    std::vector<const char*> args_ptrs = get_args_ptrs(location_info.args);
     unsigned options = CXTranslationUnit_Incomplete |
                        CXTranslationUnit_DetailedPreprocessingRecord;
-    std::vector<CXUnsavedFile> unsaved_files =
-        create_unsaved_files(location_info);
-    cxtranslation_unit_ptr translation_unit(clang_parseTranslationUnit(
-        index, file_name.c_str(), args_ptrs.data(), args_ptrs.size(),
-        unsaved_files.data(), unsaved_files.size(), options));
+    cached_translation_unit_ptr translation_unit =
+        parse_translation_unit_at(location_info, options);
     if (!translation_unit)
         return "{}";
 
@@ -603,25 +893,27 @@ libclang_vim::get_completion_at(const location_tuple& location_info) {
     ss << "['";
 
     // Write the completion list.
-    libclang_vim::cxindex_ptr index = clang_createIndex(
-        /*excludeDeclarationsFromPCH=*/1, /*displayDiagnostics=*/0);
-
     std::string file_name = location_info.file;
-    std::vector<const char*> args_ptrs = get_args_ptrs(location_info.args);
     std::vector<CXUnsavedFile> unsaved_files =
         create_unsaved_files(location_info);
     unsigned options = CXTranslationUnit_Incomplete;
-    cxtranslation_unit_ptr translation_unit(clang_parseTranslationUnit(
-        index, file_name.c_str(), args_ptrs.data(), args_ptrs.size(),
-        unsaved_files.data(), unsaved_files.size(), options));
+    scoped_timer parse_timer("get_completion_at.parse");
+    cached_translation_unit_ptr translation_unit =
+        parse_translation_unit(location_info, options,
+                               /*allow_snapshot*/ false);
     if (!translation_unit)
         return "[]";
+    parse_timer.stop();
 
     unsigned line = location_info.line;
     unsigned column = location_info.col;
+    scoped_timer complete_timer("get_completion_at.complete");
     CXCodeCompleteResults* results = clang_codeCompleteAt(
         translation_unit, file_name.c_str(), line, column, unsaved_files.data(),
         unsaved_files.size(), clang_defaultCodeCompleteOptions());
+    complete_timer.stop();
+
+    scoped_timer stringize_timer("get_completion_at.stringize");
     std::set<std::string> matches;
     if (results) {
         for (unsigned i = 0; i < results->NumResults; ++i) {
@@ -662,56 +954,18 @@ const char* libclang_vim::get_diagnostics(const location_tuple& location_info) {
     ss << "[";
 
     // Write the diagnostic list.
-    libclang_vim::cxindex_ptr index = clang_createIndex(
-        /*excludeDeclarationsFromPCH=*/1, /*displayDiagnostics=*/0);
-
-    std::string file_name = location_info.file;
-    std::vector<const char*> args_ptrs = get_args_ptrs(location_info.args);
-    std::vector<CXUnsavedFile> unsaved_files =
-        create_unsaved_files(location_info);
     unsigned options = CXTranslationUnit_Incomplete;
-    cxtranslation_unit_ptr translation_unit(clang_parseTranslationUnit(
-        index, file_name.c_str(), args_ptrs.data(), args_ptrs.size(),
-        unsaved_files.data(), unsaved_files.size(), options));
+    cached_translation_unit_ptr translation_unit =
+        parse_translation_unit(location_info, options);
     if (!translation_unit)
         return "[]";
 
-    unsigned num_diagnostics = clang_getNumDiagnostics(translation_unit);
-    for (unsigned i = 0; i < num_diagnostics; ++i) {
-        CXDiagnostic diagnostic = clang_getDiagnostic(translation_unit, i);
-        if (diagnostic) {
-            std::string severity;
-            switch (clang_getDiagnosticSeverity(diagnostic)) {
-            case CXDiagnostic_Ignored:
-                severity = "ignored";
-                break;
-            case CXDiagnostic_Note:
-                severity = "note";
-                break;
-            case CXDiagnostic_Warning:
-                severity = "warning";
-                break;
-            case CXDiagnostic_Error:
-                severity = "error";
-                break;
-            case CXDiagnostic_Fatal:
-                severity = "fatal";
-                break;
-            }
-            ss << "{'severity': '" << severity << "', ";
-
-            CXSourceLocation location = clang_getDiagnosticLocation(diagnostic);
-            CXFile location_file;
-            unsigned location_line;
-            unsigned location_column;
-            clang_getExpansionLocation(location, &location_file, &location_line,
-                                       &location_column, nullptr);
-            libclang_vim::cxstring_ptr location_file_name =
-                clang_getFileName(location_file);
-            ss << libclang_vim::stringize_location(location) << "}, ";
-        }
-        clang_disposeDiagnostic(diagnostic);
-    }
+    const std::string* snapshot_diagnostics =
+        translation_unit.get_snapshot_diagnostics();
+    if (snapshot_diagnostics)
+        ss << *snapshot_diagnostics;
+    else
+        ss << stringize_diagnostics(translation_unit);
 
     // Write the footer.
     ss << "]";
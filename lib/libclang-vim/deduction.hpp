@@ -19,6 +19,16 @@ const char* deduce_func_or_var_decl(const location_tuple& location_info);
 /// Get type at specific location with auto-deduction described above.
 const char* deduce_type_at(const location_tuple& location_info);
 
+/// Deduced types of the auto variables, return types and structured bindings
+/// declared from line location_info.line to line location_info.col, from
+/// one pass over their tokens.
+const char* get_inlay_hints(const location_tuple& location_info);
+
+/// Returns the function enclosing location_info, or the translation unit
+/// cursor if there is none.
+CXCursor get_function_cursor_at(CXTranslationUnit translation_unit,
+                                const location_tuple& location_info);
+
 /// Wrapper around clang_getCursorSpelling() for the current function.
 const char* get_current_function_at(const location_tuple& location_info);
 
@@ -32,6 +42,11 @@ const char* get_comment_at(const location_tuple& location_info);
 /// Get location of declaration referenced by location_info.
 const char* get_deduced_declaration_at(const location_tuple& location_info);
 
+/// Everything to show when hovering location_info, from one cursor lookup:
+/// the full name, the deduced type, the comments, the declaration and the
+/// parameters.
+const char* get_hover_at(const location_tuple& location_info);
+
 /// Wrapper around clang_getIncludedFile().
 const char* get_include_at(const location_tuple& location_info);
 
@@ -0,0 +1,128 @@
+#include "diagnostics_sweep.hpp"
+
+#include "include_graph.hpp"
+#include "shared_pch.hpp"
+#include "stringizers.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+
+/// Parses info from scratch, without touching the translation unit cache.
+std::string get_diagnostics_list(const libclang_vim::location_tuple& info) {
+    // Each worker has its own index, so parses don't contend on it.
+    thread_local libclang_vim::cxindex_ptr index(
+        clang_createIndex(/*excludeDeclsFromPCH*/ 1, /*displayDiagnostics*/ 0));
+    libclang_vim::args_type args = info.args;
+    const libclang_vim::args_type pch_args =
+        libclang_vim::get_shared_pch_store().get_args(info);
+    args.insert(args.end(), pch_args.begin(), pch_args.end());
+    auto const args_ptrs = libclang_vim::get_args_ptrs(args);
+    std::vector<CXUnsavedFile> unsaved_files =
+        libclang_vim::create_unsaved_files(info);
+    libclang_vim::cxtranslation_unit_ptr translation_unit(
+        clang_parseTranslationUnit(index, info.file.c_str(), args_ptrs.data(),
+                                   args_ptrs.size(), unsaved_files.data(),
+                                   unsaved_files.size(),
+                                   CXTranslationUnit_Incomplete));
+    if (!translation_unit)
+        return std::string();
+
+    libclang_vim::get_include_graph().update(
+        libclang_vim::get_real_path(info.file), translation_unit);
+    return libclang_vim::stringize_diagnostics(translation_unit);
+}
+}
+
+bool libclang_vim::diagnostics_sweep::is_current(std::uint64_t generation) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return generation == m_generation;
+}
+
+void libclang_vim::diagnostics_sweep::finish(std::uint64_t generation,
+                                             std::string result) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (generation != m_generation)
+        return;
+
+    m_results.push_back(std::move(result));
+    ++m_done;
+}
+
+bool libclang_vim::diagnostics_sweep::start(
+    const std::vector<location_tuple>& files) {
+    std::uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_done < m_total)
+            return false;
+
+        generation = ++m_generation;
+        m_results.clear();
+        m_total = files.size();
+        m_done = 0;
+    }
+
+    thread_pool& pool = get_thread_pool();
+    for (const auto& file : files) {
+        pool.post(
+            [this, generation, file] {
+                if (!is_current(generation))
+                    return;
+
+                finish(generation, "{'file':'" + file.file +
+                                       "','diagnostics':[" +
+                                       get_diagnostics_list(file) + "]}");
+            },
+            task_priority::visible);
+    }
+    return true;
+}
+
+void libclang_vim::diagnostics_sweep::cancel() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_generation;
+    m_results.clear();
+    m_total = m_done;
+}
+
+std::string libclang_vim::diagnostics_sweep::poll() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::string vimson = "{'done':" + std::to_string(m_done) +
+                         ",'total':" + std::to_string(m_total) +
+                         ",'results':[";
+    for (const auto& result : m_results)
+        vimson += result + ",";
+    vimson += "]}";
+    m_results.clear();
+    return vimson;
+}
+
+libclang_vim::diagnostics_sweep& libclang_vim::get_diagnostics_sweep() {
+    // Deliberately leaked, see get_thread_pool().
+    static diagnostics_sweep& sweep = *new diagnostics_sweep;
+    return sweep;
+}
+
+const char* libclang_vim::start_diagnostics_sweep(const std::string& request) {
+    static std::string vimson;
+
+    std::vector<location_tuple> files = parse_file_list(request);
+    if (!get_diagnostics_sweep().start(files))
+        return "{}";
+
+    vimson = "{'total':" + std::to_string(files.size()) + "}";
+    return vimson.c_str();
+}
+
+const char* libclang_vim::poll_diagnostics_sweep() {
+    static std::string vimson;
+    vimson = get_diagnostics_sweep().poll();
+    return vimson.c_str();
+}
+
+const char* libclang_vim::cancel_diagnostics_sweep() {
+    get_diagnostics_sweep().cancel();
+    return "{}";
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,52 @@
+#if !defined LIBCLANG_VIM_DIAGNOSTICS_SWEEP_HPP_INCLUDED
+#define LIBCLANG_VIM_DIAGNOSTICS_SWEEP_HPP_INCLUDED
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "helpers.hpp"
+
+namespace libclang_vim {
+
+/// Collects the diagnostics of many files on the thread pool, so that they
+/// can be polled as they finish.
+class diagnostics_sweep {
+    /// Results finished since the last poll().
+    std::vector<std::string> m_results;
+    std::size_t m_total = 0;
+    std::size_t m_done = 0;
+    /// Incremented on each start() and cancel(), so that tasks of an earlier
+    /// sweep know that they are obsolete.
+    std::uint64_t m_generation = 0;
+    std::mutex m_mutex;
+
+    bool is_current(std::uint64_t generation);
+
+    void finish(std::uint64_t generation, std::string result);
+
+  public:
+    /// Fails if the previous sweep is still running.
+    bool start(const std::vector<location_tuple>& files);
+
+    void cancel();
+
+    /// Returns the progress and the results finished since the last poll.
+    std::string poll();
+};
+
+diagnostics_sweep& get_diagnostics_sweep();
+
+/// Parse a file list (see parse_file_list()) and start a sweep.
+const char* start_diagnostics_sweep(const std::string& request);
+
+const char* poll_diagnostics_sweep();
+
+const char* cancel_diagnostics_sweep();
+
+} // namespace libclang_vim
+
+#endif // LIBCLANG_VIM_DIAGNOSTICS_SWEEP_HPP_INCLUDED
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
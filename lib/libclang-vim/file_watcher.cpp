@@ -0,0 +1,321 @@
+#include "file_watcher.hpp"
+
+#include <cerrno>
+#include <unistd.h>
+#if defined __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+#include "helpers.hpp"
+#include "include_graph.hpp"
+#include "index_shard.hpp"
+#include "result_cache.hpp"
+#include "translation_unit_cache.hpp"
+
+namespace {
+
+/// A change is handled once no other one arrived for this long.
+const int debounce_milliseconds = 200;
+
+/// How often the watched directories follow the include graph when idle.
+const int idle_milliseconds = 1000;
+
+const char compilation_database_name[] = "compile_commands.json";
+
+std::string get_directory(const std::string& file) {
+    const auto slash = file.rfind('/');
+    if (slash == std::string::npos)
+        return ".";
+    if (slash == 0)
+        return "/";
+    return file.substr(0, slash);
+}
+}
+
+libclang_vim::file_watcher::file_watcher() : m_stopping(false) {
+    m_wakeup[0] = m_wakeup[1] = -1;
+    pin_library();
+}
+
+libclang_vim::file_watcher::~file_watcher() { stop(); }
+
+bool libclang_vim::file_watcher::watch(const std::string& directory) {
+#if defined __linux__
+    if (!m_watched.insert(directory).second)
+        return true;
+
+    const int descriptor = inotify_add_watch(
+        m_inotify, directory.c_str(),
+        IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+            IN_ONLYDIR);
+    if (descriptor < 0) {
+        // Tried again when the include graph is walked the next time.
+        m_watched.erase(directory);
+        return false;
+    }
+
+    m_directories[descriptor] = directory;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_watched_directories = m_directories.size();
+    return true;
+#else
+    (void)directory;
+    return false;
+#endif
+}
+
+void libclang_vim::file_watcher::update_watches() {
+    const include_graph& graph = get_include_graph();
+    const std::uint64_t generation = graph.get_generation();
+    if (generation != m_graph_generation) {
+        bool watched = true;
+        for (const auto& file : graph.get_files())
+            watched = watch(get_directory(file)) && watched;
+        if (watched) {
+            m_graph_generation = generation;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_watched_generation = generation;
+        }
+    }
+
+    std::set<std::string> databases;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        databases = m_databases;
+    }
+    for (const auto& directory : databases)
+        watch(directory);
+}
+
+void libclang_vim::file_watcher::flush(const std::set<std::string>& changed) {
+    std::set<std::string> units;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& file : changed) {
+            const std::string directory = get_directory(file);
+            if (file.substr(file.rfind('/') + 1) == compilation_database_name &&
+                m_databases.count(directory))
+                m_changed_databases.insert(directory);
+        }
+    }
+
+    const include_graph& graph = get_include_graph();
+    for (const auto& file : changed) {
+        const std::set<std::string> dependents =
+            graph.get_dependent_units(file);
+        units.insert(dependents.begin(), dependents.end());
+        units.insert(file);
+    }
+    const std::size_t invalidated =
+        get_translation_unit_cache().invalidate(units);
+    get_result_cache().invalidate(units);
+
+    if (invalidated > 0)
+        // The reparses are background tasks, so they yield to requests from
+        // Vim, which reparse what they need themselves.
+        get_translation_unit_cache().refresh_stale([this] {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_reparsed;
+        });
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_changes += changed.size();
+    m_invalidated += invalidated;
+}
+
+void libclang_vim::file_watcher::run() {
+#if defined __linux__
+    alignas(inotify_event) char buffer[4096];
+    std::set<std::string> changed;
+    while (!m_stopping) {
+        update_watches();
+
+        pollfd descriptors[2] = {{m_inotify, POLLIN, 0},
+                                 {m_wakeup[0], POLLIN, 0}};
+        const int ready = ::poll(descriptors, 2,
+                                 changed.empty() ? idle_milliseconds
+                                                 : debounce_milliseconds);
+        if (ready < 0 && errno != EINTR)
+            break;
+        if (descriptors[1].revents)
+            break;
+
+        if (ready == 0 && !changed.empty()) {
+            flush(changed);
+            changed.clear();
+            continue;
+        }
+        if (!(descriptors[0].revents & POLLIN))
+            continue;
+
+        const ssize_t size = read(m_inotify, buffer, sizeof(buffer));
+        for (ssize_t offset = 0; offset < size;) {
+            const auto* event =
+                reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Events were lost, assume everything changed.
+                const std::set<std::string> files =
+                    get_include_graph().get_files();
+                changed.insert(files.begin(), files.end());
+                continue;
+            }
+
+            auto it = m_directories.find(event->wd);
+            if (it == m_directories.end())
+                continue;
+            if (event->mask & IN_IGNORED) {
+                // The directory is gone, watch it again if it's recreated.
+                m_watched.erase(it->second);
+                m_directories.erase(it);
+                m_graph_generation = 0;
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_watched_directories = m_directories.size();
+                m_watched_generation = 0;
+                continue;
+            }
+            if (event->len > 0)
+                changed.insert(it->second + "/" + event->name);
+        }
+    }
+#endif
+}
+
+bool libclang_vim::file_watcher::start() {
+#if defined __linux__
+    if (m_thread.joinable())
+        return false;
+
+    m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify < 0)
+        return false;
+    if (pipe(m_wakeup) != 0) {
+        close(m_inotify);
+        m_inotify = -1;
+        return false;
+    }
+
+    m_stopping = false;
+    m_graph_generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_run = ++m_runs;
+        m_watched_generation = 0;
+    }
+    // Files known by now are watched once start() returns.
+    update_watches();
+    m_thread = std::thread([this] { run(); });
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool libclang_vim::file_watcher::stop() {
+    if (!m_thread.joinable())
+        return false;
+
+    {
+        // Changes are not noticed from now on.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_run = 0;
+        m_watched_generation = 0;
+    }
+    m_stopping = true;
+    const char wakeup = 0;
+    if (write(m_wakeup[1], &wakeup, 1) != 1) {
+        // The thread notices m_stopping after its poll timeout.
+    }
+    m_thread.join();
+
+    close(m_wakeup[0]);
+    close(m_wakeup[1]);
+    m_wakeup[0] = m_wakeup[1] = -1;
+    close(m_inotify);
+    m_inotify = -1;
+    m_directories.clear();
+    m_watched.clear();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_watched_directories = 0;
+    return true;
+}
+
+void libclang_vim::file_watcher::add_compilation_database(
+    const std::string& directory) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_databases.insert(get_real_path(directory));
+}
+
+std::string libclang_vim::file_watcher::poll() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::string vimson =
+        "{'running':" + std::to_string(m_thread.joinable() ? 1 : 0) +
+        ",'directories':" + std::to_string(m_watched_directories) +
+        ",'changes':" + std::to_string(m_changes) +
+        ",'invalidated':" + std::to_string(m_invalidated) +
+        ",'reparsed':" + std::to_string(m_reparsed) +
+        ",'compilation_databases':[";
+    for (const auto& directory : m_changed_databases)
+        vimson += "'" + directory + "',";
+    vimson += "]}";
+    m_changed_databases.clear();
+    return vimson;
+}
+
+std::uint64_t
+libclang_vim::file_watcher::get_run(std::uint64_t graph_generation) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_watched_generation < graph_generation)
+        return 0;
+    return m_run;
+}
+
+libclang_vim::file_watcher& libclang_vim::get_file_watcher() {
+    // Deliberately leaked, see get_thread_pool().
+    static file_watcher& watcher = *new file_watcher;
+    return watcher;
+}
+
+void libclang_vim::dependency_state::record(std::vector<std::string> files,
+                                            const location_tuple& info) {
+    m_files = std::move(files);
+    m_hash = hash_dependencies(m_files, info);
+    m_graph_generation = get_include_graph().get_generation();
+    m_watcher_run = 0;
+}
+
+bool libclang_vim::dependency_state::is_current(const location_tuple& info) {
+    const std::uint64_t run = get_file_watcher().get_run(m_graph_generation);
+    if (run && run == m_watcher_run)
+        return true;
+
+    // The files were not watched all the time since the last check.
+    if (hash_dependencies(m_files, info) != m_hash)
+        return false;
+    m_watcher_run = run;
+    return true;
+}
+
+const char* libclang_vim::start_watching() {
+    if (!get_file_watcher().start())
+        return "{}";
+
+    return "{'ok':1}";
+}
+
+const char* libclang_vim::poll_watching() {
+    static std::string vimson;
+    vimson = get_file_watcher().poll();
+    return vimson.c_str();
+}
+
+const char* libclang_vim::stop_watching() {
+    if (!get_file_watcher().stop())
+        return "{}";
+
+    return "{'ok':1}";
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,108 @@
+#if !defined LIBCLANG_VIM_FILE_WATCHER_HPP_INCLUDED
+#define LIBCLANG_VIM_FILE_WATCHER_HPP_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "helpers.hpp"
+
+namespace libclang_vim {
+
+/// Background thread noticing changes of the files the cached translation
+/// units depend on, and of compilation databases, using Linux inotify. A burst
+/// of changes (e.g. a git checkout) is handled once it settled: the dependent
+/// units are invalidated, then reparsed.
+class file_watcher {
+    std::thread m_thread;
+    std::atomic<bool> m_stopping;
+    int m_inotify = -1;
+    /// Written to wake the thread up for stopping.
+    int m_wakeup[2];
+
+    // Only used by the thread.
+    std::map<int, std::string> m_directories;
+    std::set<std::string> m_watched;
+    std::uint64_t m_graph_generation = 0;
+
+    /// Directories of the compilation databases seen so far.
+    std::set<std::string> m_databases;
+    /// The ones which changed since the last poll().
+    std::set<std::string> m_changed_databases;
+    std::size_t m_watched_directories = 0;
+    std::size_t m_changes = 0;
+    std::size_t m_invalidated = 0;
+    std::size_t m_reparsed = 0;
+    /// Number of start() calls so far, and the current run, 0 if stopped.
+    std::uint64_t m_runs = 0;
+    std::uint64_t m_run = 0;
+    /// Generation of the include graph whose files are all watched.
+    std::uint64_t m_watched_generation = 0;
+    std::mutex m_mutex;
+
+    void run();
+    /// Returns false if directory can't be watched.
+    bool watch(const std::string& directory);
+    void update_watches();
+    /// Invalidates the units depending on changed, then reparses them.
+    void flush(const std::set<std::string>& changed);
+
+  public:
+    file_watcher();
+    file_watcher(const file_watcher&) = delete;
+    file_watcher& operator=(const file_watcher&) = delete;
+    ~file_watcher();
+
+    /// Fails if already running or inotify is not available.
+    bool start();
+
+    bool stop();
+
+    /// Watch directory/compile_commands.json, too.
+    void add_compilation_database(const std::string& directory);
+
+    /// Returns the counters and the changed compilation databases.
+    std::string poll();
+
+    /// Returns the current run if it watches all files in the include graph
+    /// as of graph_generation, or else 0.
+    std::uint64_t get_run(std::uint64_t graph_generation);
+};
+
+file_watcher& get_file_watcher();
+
+/// The files a cached unit or result was computed from, and their state.
+class dependency_state {
+    std::vector<std::string> m_files;
+    /// hash_dependencies() of m_files when recorded.
+    std::uint64_t m_hash = 0;
+    /// Generation of the include graph knowing about m_files.
+    std::uint64_t m_graph_generation = 0;
+    /// Run of the file watcher which watched m_files at the last check.
+    std::uint64_t m_watcher_run = 0;
+
+  public:
+    void record(std::vector<std::string> files, const location_tuple& info);
+
+    /// Whether the files are unchanged since record(). Once the file watcher
+    /// watches them, it invalidates the dependents of changed files, so they
+    /// are only hashed at the first check of each run of the watcher.
+    bool is_current(const location_tuple& info);
+};
+
+const char* start_watching();
+
+const char* poll_watching();
+
+const char* stop_watching();
+
+} // namespace libclang_vim
+
+#endif // LIBCLANG_VIM_FILE_WATCHER_HPP_INCLUDED
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -1,7 +1,78 @@
 #include "helpers.hpp"
 
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <clang-c/CXCompilationDatabase.h>
+
+#include "file_watcher.hpp"
+#include "stats.hpp"
+#include "translation_unit_cache.hpp"
+#include "unsaved_files.hpp"
+
 namespace {
 
+/// Adds all files of the compilation database in directory to files.
+void add_compilation_database(
+    const std::string& directory,
+    std::vector<libclang_vim::location_tuple>& files) {
+    libclang_vim::scoped_timer timer("compilation_database");
+    CXCompilationDatabase_Error error;
+    CXCompilationDatabase database =
+        clang_CompilationDatabase_fromDirectory(directory.c_str(), &error);
+    if (error == CXCompilationDatabase_NoError) {
+        CXCompileCommands commands =
+            clang_CompilationDatabase_getAllCompileCommands(database);
+        unsigned size = clang_CompileCommands_getSize(commands);
+        for (unsigned i = 0; i < size; ++i) {
+            CXCompileCommand command =
+                clang_CompileCommands_getCommand(commands, i);
+            libclang_vim::cxstring_ptr file =
+                clang_CompileCommand_getFilename(command);
+            libclang_vim::cxstring_ptr working_directory =
+                clang_CompileCommand_getDirectory(command);
+
+            libclang_vim::location_tuple info;
+            info.file = clang_getCString(file);
+            if (info.file.empty())
+                continue;
+            if (info.file[0] != '/')
+                info.file =
+                    std::string(clang_getCString(working_directory)) + "/" +
+                    info.file;
+
+            // Relative paths in the arguments are relative to the directory
+            // of the command, not to ours.
+            info.args.emplace_back("-working-directory");
+            info.args.emplace_back(clang_getCString(working_directory));
+            // Skip the compiler and the file itself.
+            unsigned args = clang_CompileCommand_getNumArgs(command);
+            for (unsigned j = 1; j < args; ++j) {
+                libclang_vim::cxstring_ptr arg =
+                    clang_CompileCommand_getArg(command, j);
+                if (std::strcmp(clang_getCString(file),
+                                clang_getCString(arg)) != 0)
+                    info.args.emplace_back(clang_getCString(arg));
+            }
+            libclang_vim::extract_unsaved_file(info);
+            files.push_back(info);
+        }
+        clang_CompileCommands_dispose(commands);
+        libclang_vim::get_file_watcher().add_compilation_database(directory);
+    }
+    clang_CompilationDatabase_dispose(database);
+}
+
+
+/// Prefix of the temp file name that denotes a shared memory object.
+const char shared_memory_prefix[] = "shm=";
+
 using DataType =
     std::pair<CXCursor, const std::function<bool(const CXCursorKind&)>&>;
 
@@ -17,6 +88,22 @@ CXChildVisitResult search_kind_visitor(CXCursor cursor, CXCursor /*unused*/,
     return CXChildVisit_Continue;
 }
 
+/// Maps the whole of fd read-only, or returns an empty buffer on failure.
+std::shared_ptr<const char> map_fd(int fd, std::size_t& size) {
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+        return nullptr;
+
+    void* address = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED)
+        return nullptr;
+
+    size = st.st_size;
+    return std::shared_ptr<const char>(
+        static_cast<const char*>(address),
+        [size](const char* p) { munmap(const_cast<char*>(p), size); });
+}
+
 libclang_vim::args_type parse_compiler_args(const std::string& s) {
     using iterator = std::istream_iterator<std::string>;
     libclang_vim::args_type result;
@@ -31,6 +118,84 @@ size_t libclang_vim::get_file_size(const char* filename) {
     return input.seekg(0, std::ios::end).tellg();
 }
 
+void libclang_vim::pin_library() {
+    Dl_info info;
+    if (dladdr(reinterpret_cast<void*>(&pin_library), &info) && info.dli_fname)
+        // Deliberately leaked, RTLD_NODELETE makes the library resident.
+        dlopen(info.dli_fname, RTLD_NOW | RTLD_NODELETE);
+}
+
+std::uint64_t libclang_vim::hash_bytes(const char* data, size_t size,
+                                       std::uint64_t seed) {
+    // FNV-1a, but mixing 8 bytes at a time.
+    const std::uint64_t prime = 1099511628211ULL;
+    std::uint64_t hash = seed ^ size;
+    size_t i = 0;
+    for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t)) {
+        std::uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 32;
+    }
+    for (; i < size; ++i)
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * prime;
+    return hash;
+}
+
+std::uint64_t libclang_vim::get_file_stamp(const std::string& file) {
+    struct stat st {};
+    if (stat(file.c_str(), &st) != 0)
+        return 0;
+
+#if defined __APPLE__
+    const std::uint64_t nanoseconds = st.st_mtimespec.tv_nsec;
+#else
+    const std::uint64_t nanoseconds = st.st_mtim.tv_nsec;
+#endif
+    const std::uint64_t stamp[] = {static_cast<std::uint64_t>(st.st_mtime),
+                                   nanoseconds,
+                                   static_cast<std::uint64_t>(st.st_size)};
+    return hash_bytes(reinterpret_cast<const char*>(stamp), sizeof(stamp));
+}
+
+std::string libclang_vim::get_current_directory() {
+    char buffer[PATH_MAX];
+    if (!getcwd(buffer, sizeof(buffer)))
+        return std::string();
+    return buffer;
+}
+
+bool libclang_vim::make_directories(const std::string& directory) {
+    for (std::size_t pos = directory.find('/', 1); true;
+         pos = directory.find('/', pos + 1)) {
+        const std::string parent = directory.substr(0, pos);
+        if (mkdir(parent.c_str(), 0755) != 0 && errno != EEXIST)
+            return false;
+
+        if (pos == std::string::npos)
+            return true;
+    }
+}
+
+std::string libclang_vim::get_real_path(const std::string& file) {
+    char buffer[PATH_MAX];
+    if (realpath(file.c_str(), buffer))
+        return buffer;
+    if (!file.empty() && file[0] == '/')
+        return file;
+    return get_current_directory() + "/" + file;
+}
+
+bool libclang_vim::is_header_file(const std::string& file) {
+    static const char* const extensions[] = {".h",   ".hh",  ".hpp", ".hxx",
+                                             ".h++", ".inl", ".ipp", ".tcc"};
+    const auto dot = file.rfind('.');
+    if (dot == std::string::npos || file.find('/', dot) != std::string::npos)
+        return false;
+    return std::find(std::begin(extensions), std::end(extensions),
+                     file.substr(dot)) != std::end(extensions);
+}
+
 bool libclang_vim::is_null_location(const CXSourceLocation& location) {
     return clang_equalLocations(location, clang_getNullLocation());
 }
@@ -142,8 +307,66 @@ bool libclang_vim::is_parameter(const CXCursor& cursor) {
     return is_parameter_kind(clang_getCursorKind(cursor));
 }
 
+libclang_vim::unsaved_buffer::unsaved_buffer() = default;
+
+libclang_vim::unsaved_buffer
+libclang_vim::unsaved_buffer::map_file(const std::string& path) {
+    unsaved_buffer buffer;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return buffer;
+
+    buffer.m_data = map_fd(fd, buffer.m_size);
+    close(fd);
+    buffer.m_mapped = buffer.m_data != nullptr;
+    if (buffer.m_mapped)
+        return buffer;
+
+    // Not a regular file (e.g. a pipe), read it instead.
+    std::ifstream stream(path, std::ios::in | std::ios::binary);
+    return from_string(std::make_shared<std::string>(
+        (std::istreambuf_iterator<char>(stream)),
+        std::istreambuf_iterator<char>()));
+}
+
+libclang_vim::unsaved_buffer
+libclang_vim::unsaved_buffer::map_shared_memory(const std::string& name) {
+    unsaved_buffer buffer;
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return buffer;
+
+    buffer.m_data = map_fd(fd, buffer.m_size);
+    close(fd);
+    buffer.m_mapped = buffer.m_data != nullptr;
+    return buffer;
+}
+
+libclang_vim::unsaved_buffer libclang_vim::unsaved_buffer::from_string(
+    const std::shared_ptr<const std::string>& contents) {
+    unsaved_buffer buffer;
+    buffer.m_size = contents->size();
+    buffer.m_data = std::shared_ptr<const char>(contents, contents->data());
+    return buffer;
+}
+
+libclang_vim::unsaved_buffer
+libclang_vim::unsaved_buffer::private_copy() const {
+    if (!m_mapped)
+        return *this;
+
+    return from_string(std::make_shared<std::string>(m_data.get(), m_size));
+}
+
+const char* libclang_vim::unsaved_buffer::data() const { return m_data.get(); }
+
+size_t libclang_vim::unsaved_buffer::size() const { return m_size; }
+
+bool libclang_vim::unsaved_buffer::empty() const { return m_size == 0; }
+
 libclang_vim::location_tuple
 libclang_vim::parse_default_args(const std::string& args_string) {
+    scoped_timer timer("parse_args");
     location_tuple info;
     const auto end = std::end(args_string);
     const auto path_end = std::find(std::begin(args_string), end, ':');
@@ -171,9 +394,30 @@ libclang_vim::create_unsaved_files(const location_tuple& location_info) {
         unsaved_file.Length = location_info.unsaved_file.size();
         unsaved_files.push_back(unsaved_file);
     }
+    for (const auto& other : location_info.other_unsaved_files) {
+        CXUnsavedFile unsaved_file{};
+        unsaved_file.Filename = other.first.c_str();
+        unsaved_file.Contents = other.second.data();
+        unsaved_file.Length = other.second.size();
+        unsaved_files.push_back(unsaved_file);
+    }
     return unsaved_files;
 }
 
+std::uint64_t libclang_vim::hash_unsaved_files(
+    const std::vector<CXUnsavedFile>& unsaved_files) {
+    // Summed up, so that the same files listed for an other main file give
+    // the same hash.
+    std::uint64_t hash = hash_bytes(nullptr, 0);
+    for (const auto& unsaved_file : unsaved_files) {
+        const std::uint64_t name_hash = hash_bytes(
+            unsaved_file.Filename, std::strlen(unsaved_file.Filename));
+        hash += hash_bytes(unsaved_file.Contents, unsaved_file.Length,
+                           name_hash);
+    }
+    return hash;
+}
+
 void libclang_vim::extract_unsaved_file(libclang_vim::location_tuple& info) {
     // Recognize "real filename#temp file" syntax, in which case assume the
     // later is the unsaved version of the previous.
@@ -181,12 +425,29 @@ void libclang_vim::extract_unsaved_file(libclang_vim::location_tuple& info) {
     if (pos != std::string::npos) {
         std::string unsaved_path = info.file.substr(pos + 1);
         info.file = info.file.substr(0, pos);
-        std::ifstream unsaved_stream(unsaved_path,
-                                     std::ios::in | std::ios::binary);
-        info.unsaved_file =
-            std::vector<char>((std::istreambuf_iterator<char>(unsaved_stream)),
-                              std::istreambuf_iterator<char>());
-    }
+        const std::size_t prefix_size = sizeof(shared_memory_prefix) - 1;
+        if (unsaved_path.compare(0, prefix_size, shared_memory_prefix) == 0)
+            info.unsaved_file = unsaved_buffer::map_shared_memory(
+                unsaved_path.substr(prefix_size));
+        else
+            info.unsaved_file = unsaved_buffer::map_file(unsaved_path);
+    } else
+        info.unsaved_file = get_unsaved_file_store().get(info.file);
+
+    info.other_unsaved_files = get_unsaved_file_store().get_all();
+    info.other_unsaved_files.erase(
+        std::remove_if(info.other_unsaved_files.begin(),
+                       info.other_unsaved_files.end(),
+                       [&info](const std::pair<std::string, unsaved_buffer>&
+                                   other) { return other.first == info.file; }),
+        info.other_unsaved_files.end());
+}
+
+void libclang_vim::make_unsaved_files_private(
+    libclang_vim::location_tuple& info) {
+    info.unsaved_file = info.unsaved_file.private_copy();
+    for (auto& other : info.other_unsaved_files)
+        other.second = other.second.private_copy();
 }
 
 libclang_vim::location_tuple
@@ -202,7 +463,7 @@ libclang_vim::parse_args_with_location(const std::string& args_string) {
         return location_tuple();
     }
 
-    auto const default_args =
+    auto default_args =
         parse_default_args({std::begin(args_string), second_colon});
     if (default_args.file.empty()) {
         return location_tuple();
@@ -215,10 +476,7 @@ libclang_vim::parse_args_with_location(const std::string& args_string) {
         return location_tuple();
     }
 
-    location_tuple ret;
-    ret.file = default_args.file;
-    ret.unsaved_file = default_args.unsaved_file;
-    ret.args = default_args.args;
+    location_tuple ret = default_args;
     ret.line = line;
     ret.col = col;
     return ret;
@@ -236,24 +494,23 @@ const char* libclang_vim::at_specific_location(
     const std::function<std::string(CXCursor const&)>& predicate) {
     static std::string vimson;
     char const* file_name = location_tuple.file.c_str();
-    auto const args_ptrs = get_args_ptrs(location_tuple.args);
-
-    cxindex_ptr index =
-        clang_createIndex(/*excludeDeclsFromPCH*/ 1, /*displayDiagnostics*/ 0);
-    std::vector<CXUnsavedFile> unsaved_files =
-        create_unsaved_files(location_tuple);
-    cxtranslation_unit_ptr translation_unit(clang_parseTranslationUnit(
-        index, file_name, args_ptrs.data(), args_ptrs.size(),
-        unsaved_files.data(), unsaved_files.size(),
-        CXTranslationUnit_Incomplete));
+
+    scoped_timer parse_timer("at_specific_location.parse");
+    cached_translation_unit_ptr translation_unit =
+        parse_translation_unit_at(location_tuple,
+                                  CXTranslationUnit_Incomplete);
     if (!translation_unit)
         return "{}";
+    parse_timer.stop();
 
+    scoped_timer cursor_timer("at_specific_location.cursor");
     CXFile file = clang_getFile(translation_unit, file_name);
     auto const location = clang_getLocation(
         translation_unit, file, location_tuple.line, location_tuple.col);
     CXCursor const cursor = clang_getCursor(translation_unit, location);
+    cursor_timer.stop();
 
+    scoped_timer stringize_timer("at_specific_location.stringize");
     vimson = predicate(cursor);
 
     return vimson.c_str();
@@ -272,4 +529,23 @@ CXCursor libclang_vim::search_kind(
     return kind_visitor_data.first;
 }
 
+std::vector<libclang_vim::location_tuple>
+libclang_vim::parse_file_list(const std::string& request) {
+    std::vector<location_tuple> files;
+    std::stringstream stream(request);
+    std::string line;
+    while (std::getline(stream, line)) {
+        if (line.empty())
+            continue;
+
+        if (line[0] == '@')
+            add_compilation_database(line.substr(1), files);
+        else
+            files.push_back(parse_default_args(line));
+    }
+    for (auto& file : files)
+        make_unsaved_files_private(file);
+    return files;
+}
+
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
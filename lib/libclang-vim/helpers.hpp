@@ -3,6 +3,7 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <fstream>
 #include <functional>
@@ -21,6 +22,28 @@ using std::size_t;
 
 size_t get_file_size(const char* filename);
 
+/// Makes sure the library stays loaded after dlclose(): Vim's libcall()
+/// unloads it after every call, which would throw away all cached state.
+void pin_library();
+
+/// Fast non-cryptographic hash of size bytes at data.
+std::uint64_t hash_bytes(const char* data, size_t size,
+                         std::uint64_t seed = 14695981039346656037ULL);
+
+/// Identifies the on-disk version of file, or 0 if it does not exist.
+std::uint64_t get_file_stamp(const std::string& file);
+
+std::string get_current_directory();
+
+/// Creates directory and its missing parents.
+bool make_directories(const std::string& directory);
+
+/// Canonical absolute name of file, or its absolute name if it does not exist.
+std::string get_real_path(const std::string& file);
+
+/// Whether the extension of file is one of a C or C++ header.
+bool is_header_file(const std::string& file);
+
 bool is_null_location(const CXSourceLocation& location);
 
 /// Class to avoid the need to call clang_disposeIndex() manually.
@@ -83,12 +106,50 @@ bool is_parameter(const CXCursor& cursor);
 
 using args_type = std::vector<std::string>;
 
+/// Read-only contents of an unsaved buffer. The bytes are mmap()-ed where
+/// possible, so they can be handed to CXUnsavedFile without copying. Copies of
+/// the object share the same mapping.
+///
+/// The editor may truncate a mapped file any time, and reading past its new
+/// end raises SIGBUS, so a buffer which outlives the call that mapped it (one
+/// that is queued, stored or cached) must be a private() copy.
+class unsaved_buffer {
+    std::shared_ptr<const char> m_data;
+    size_t m_size = 0;
+    bool m_mapped = false;
+
+  public:
+    unsaved_buffer();
+
+    /// Maps the file at path, falls back to reading it if it can't be mapped.
+    static unsaved_buffer map_file(const std::string& path);
+
+    /// Maps the POSIX shared memory object name, see shm_open().
+    static unsaved_buffer map_shared_memory(const std::string& name);
+
+    /// Shares contents without copying it.
+    static unsaved_buffer
+    from_string(const std::shared_ptr<const std::string>& contents);
+
+    /// Returns a copy of the contents if they are mapped, this buffer
+    /// otherwise.
+    unsaved_buffer private_copy() const;
+
+    const char* data() const;
+
+    size_t size() const;
+
+    bool empty() const;
+};
+
 /// Stores compiler arguments with location.
 class location_tuple {
   public:
     std::string file;
     /// Contents of the unsaved buffer of file.
-    std::vector<char> unsaved_file;
+    unsaved_buffer unsaved_file;
+    /// Other files with unsaved contents, e.g. modified headers.
+    std::vector<std::pair<std::string, unsaved_buffer>> other_unsaved_files;
     args_type args;
     size_t line = 0;
     size_t col = 0;
@@ -103,9 +164,26 @@ location_tuple parse_default_args(const std::string& args_string);
 std::vector<CXUnsavedFile>
 create_unsaved_files(const location_tuple& location_info);
 
-/// Set info.unsaved_file if info.file is in "real filename#temp file" syntax.
+/// Hashes the names and contents of unsaved_files, in any order.
+std::uint64_t
+hash_unsaved_files(const std::vector<CXUnsavedFile>& unsaved_files);
+
+/// Set info.unsaved_file if info.file is in "real filename#temp file" or
+/// "real filename#shm=segment name" syntax, or if its contents were sent
+/// with update_unsaved_file(). All other files sent with
+/// update_unsaved_file() go to info.other_unsaved_files.
 void extract_unsaved_file(libclang_vim::location_tuple& info);
 
+/// Replaces the mapped unsaved buffers of info by private copies, for an info
+/// which outlives the call, see unsaved_buffer.
+void make_unsaved_files_private(libclang_vim::location_tuple& info);
+
+/// Parse a list of "file:args" lines, or "@directory" lines, which stand for
+/// all files in directory/compile_commands.json with their own arguments.
+/// The files are meant for background work, so their unsaved buffers are
+/// private.
+std::vector<location_tuple> parse_file_list(const std::string& request);
+
 /// Parse "file:args:line:col".
 location_tuple parse_args_with_location(const std::string& args_string);
 
@@ -0,0 +1,215 @@
+#include "include_graph.hpp"
+
+#include "helpers.hpp"
+#include "result_cache.hpp"
+#include "translation_unit_cache.hpp"
+
+namespace {
+
+/// State of a clang_getInclusions() walk.
+class inclusion_collector {
+    std::map<CXFile, std::string> m_names;
+
+  public:
+    std::vector<libclang_vim::include_graph::inclusion> inclusions;
+
+    const std::string& get_name(CXFile file) {
+        std::string& name = m_names[file];
+        if (name.empty()) {
+            libclang_vim::cxstring_ptr file_name = clang_getFileName(file);
+            name = libclang_vim::get_real_path(
+                libclang_vim::to_c_str(file_name));
+        }
+        return name;
+    }
+};
+
+void add_inclusion(CXFile included_file, CXSourceLocation* inclusion_stack,
+                   unsigned include_len, CXClientData client_data) {
+    // The main file itself has an empty stack.
+    if (include_len == 0)
+        return;
+
+    auto& collector = *static_cast<inclusion_collector*>(client_data);
+    CXFile file;
+    unsigned line;
+    clang_getExpansionLocation(inclusion_stack[0], &file, &line, nullptr,
+                               nullptr);
+    if (!file)
+        return;
+
+    collector.inclusions.emplace_back(collector.get_name(included_file),
+                                      collector.get_name(file), line);
+}
+
+std::string stringize_file_list(const std::set<std::string>& files) {
+    std::string list = "[";
+    for (const auto& file : files)
+        list += "'" + file + "',";
+    return list + "]";
+}
+}
+
+libclang_vim::include_graph::inclusion::inclusion(std::string file,
+                                                  std::string included_from,
+                                                  unsigned line)
+    : file(std::move(file)), included_from(std::move(included_from)),
+      line(line) {}
+
+libclang_vim::include_graph::include_graph() { pin_library(); }
+
+void libclang_vim::include_graph::remove(const std::string& unit) {
+    auto it = m_inclusions.find(unit);
+    if (it == m_inclusions.end())
+        return;
+
+    for (const auto& inclusion : it->second) {
+        auto units = m_units.find(inclusion.file);
+        if (units != m_units.end()) {
+            units->second.erase(unit);
+            if (units->second.empty())
+                m_units.erase(units);
+        }
+
+        // Other units may include the header from the same file.
+        auto includers = m_includers.find(inclusion.file);
+        if (includers == m_includers.end())
+            continue;
+        auto includer = includers->second.find(inclusion.included_from);
+        if (includer != includers->second.end() && --includer->second == 0)
+            includers->second.erase(includer);
+        if (includers->second.empty())
+            m_includers.erase(includers);
+    }
+    m_inclusions.erase(it);
+}
+
+void libclang_vim::include_graph::update(
+    const std::string& unit, CXTranslationUnit translation_unit,
+    const std::vector<std::string>& precompiled) {
+    inclusion_collector collector;
+    clang_getInclusions(translation_unit, add_inclusion, &collector);
+    for (const auto& file : precompiled)
+        collector.inclusions.emplace_back(get_real_path(file), unit, 0);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    remove(unit);
+    for (const auto& inclusion : collector.inclusions) {
+        m_units[inclusion.file].insert(unit);
+        ++m_includers[inclusion.file][inclusion.included_from];
+    }
+    m_inclusions[unit] = std::move(collector.inclusions);
+    ++m_generation;
+}
+
+std::vector<libclang_vim::include_graph::inclusion>
+libclang_vim::include_graph::get_inclusions(const std::string& unit) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_inclusions.find(unit);
+    if (it == m_inclusions.end())
+        return std::vector<inclusion>();
+    return it->second;
+}
+
+std::vector<std::string>
+libclang_vim::include_graph::get_dependencies(const std::string& unit) const {
+    std::vector<std::string> dependencies(1, unit);
+    std::set<std::string> seen(dependencies.begin(), dependencies.end());
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_inclusions.find(unit);
+    if (it == m_inclusions.end())
+        return dependencies;
+
+    for (const auto& inclusion : it->second) {
+        if (seen.insert(inclusion.file).second)
+            dependencies.push_back(inclusion.file);
+    }
+    return dependencies;
+}
+
+std::set<std::string> libclang_vim::include_graph::get_dependent_units(
+    const std::string& file) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_units.find(file);
+    if (it == m_units.end())
+        return std::set<std::string>();
+    return it->second;
+}
+
+std::set<std::string>
+libclang_vim::include_graph::get_includers(const std::string& file) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::set<std::string> includers;
+    auto it = m_includers.find(file);
+    if (it != m_includers.end()) {
+        for (const auto& includer : it->second)
+            includers.insert(includer.first);
+    }
+    return includers;
+}
+
+std::set<std::string> libclang_vim::include_graph::get_files() const {
+    std::set<std::string> files;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& unit : m_inclusions)
+        files.insert(unit.first);
+    for (const auto& header : m_units)
+        files.insert(header.first);
+    return files;
+}
+
+std::uint64_t libclang_vim::include_graph::get_generation() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_generation;
+}
+
+libclang_vim::include_graph& libclang_vim::get_include_graph() {
+    // Deliberately leaked, see get_thread_pool().
+    static include_graph& graph = *new include_graph;
+    return graph;
+}
+
+const char* libclang_vim::get_inclusions(const std::string& file) {
+    static std::string vimson;
+
+    const auto inclusions =
+        get_include_graph().get_inclusions(get_real_path(file));
+    vimson = "[";
+    for (const auto& inclusion : inclusions) {
+        vimson += "{'file':'" + inclusion.file + "','included_from':'" +
+                  inclusion.included_from +
+                  "','line':" + std::to_string(inclusion.line) + "},";
+    }
+    vimson += "]";
+    return vimson.c_str();
+}
+
+const char* libclang_vim::get_includers(const std::string& file) {
+    static std::string vimson;
+
+    const std::string real_path = get_real_path(file);
+    const include_graph& graph = get_include_graph();
+    vimson = "{'files':" + stringize_file_list(graph.get_includers(real_path)) +
+             ",'units':" +
+             stringize_file_list(graph.get_dependent_units(real_path)) + "}";
+    return vimson.c_str();
+}
+
+const char* libclang_vim::invalidate_dependents(const std::string& file) {
+    static std::string vimson;
+
+    const std::string real_path = get_real_path(file);
+    std::set<std::string> units =
+        get_include_graph().get_dependent_units(real_path);
+    // A unit depends on its main file, too.
+    units.insert(real_path);
+
+    const std::size_t translation_units =
+        get_translation_unit_cache().invalidate(units);
+    const std::size_t results = get_result_cache().invalidate(units);
+    vimson = "{'translation_units':" + std::to_string(translation_units) +
+             ",'results':" + std::to_string(results) + "}";
+    return vimson.c_str();
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
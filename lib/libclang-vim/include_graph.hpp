@@ -0,0 +1,86 @@
+#if !defined LIBCLANG_VIM_INCLUDE_GRAPH_HPP_INCLUDED
+#define LIBCLANG_VIM_INCLUDE_GRAPH_HPP_INCLUDED
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <clang-c/Index.h>
+
+namespace libclang_vim {
+
+/// Files included by the translation units parsed so far, and for each file
+/// the units which depend on it. All file names are canonical.
+class include_graph {
+  public:
+    /// One #include directive, as seen while parsing a unit.
+    struct inclusion {
+        std::string file;
+        std::string included_from;
+        unsigned line;
+
+        inclusion(std::string file, std::string included_from, unsigned line);
+    };
+
+  private:
+    std::map<std::string, std::vector<inclusion>> m_inclusions;
+    /// Header -> units including it, directly or not.
+    std::map<std::string, std::set<std::string>> m_units;
+    /// Header -> files including it directly -> number of such inclusions
+    /// over all units.
+    std::map<std::string, std::map<std::string, unsigned>> m_includers;
+    /// Incremented by each update().
+    std::uint64_t m_generation = 0;
+    mutable std::mutex m_mutex;
+
+    void remove(const std::string& unit);
+
+  public:
+    include_graph();
+
+    /// Replaces what is known about the inclusions of unit by the ones of the
+    /// just parsed translation_unit, and the files in precompiled, which are
+    /// not visible in it, e.g. because they are in a precompiled header.
+    void update(const std::string& unit, CXTranslationUnit translation_unit,
+                const std::vector<std::string>& precompiled =
+                    std::vector<std::string>());
+
+    /// Returns the #include directives seen while parsing unit.
+    std::vector<inclusion> get_inclusions(const std::string& unit) const;
+
+    /// Returns unit and the files it included at its last parse, each once.
+    std::vector<std::string> get_dependencies(const std::string& unit) const;
+
+    /// Returns the units which include file, directly or not.
+    std::set<std::string> get_dependent_units(const std::string& file) const;
+
+    /// Returns the files which include file directly.
+    std::set<std::string> get_includers(const std::string& file) const;
+
+    /// Returns all recorded units and the files included by them.
+    std::set<std::string> get_files() const;
+
+    /// Returns a number which changes with each update().
+    std::uint64_t get_generation() const;
+};
+
+include_graph& get_include_graph();
+
+/// List the #include directives of the last parse of file.
+const char* get_inclusions(const std::string& file);
+
+/// Describe the files and units including file.
+const char* get_includers(const std::string& file);
+
+/// Make the cached units and results depending on file out of date, e.g.
+/// because it was written.
+const char* invalidate_dependents(const std::string& file);
+
+} // namespace libclang_vim
+
+#endif // LIBCLANG_VIM_INCLUDE_GRAPH_HPP_INCLUDED
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
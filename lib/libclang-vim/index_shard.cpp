@@ -0,0 +1,321 @@
+#include "index_shard.hpp"
+
+#include <cstdio>
+#include <unistd.h>
+
+namespace {
+
+/// The layout of a shard is a header, then the arrays of symbols,
+/// occurrences, dependencies, bases and overrides, then a table of
+/// null-terminated strings.
+/// Strings are referred to by their offset in the table. Numbers are in
+/// native byte order, the shards are not meant to be portable.
+/// Loading a shard maps it, but copies its contents into an indexed_unit, as
+/// the symbol index merges the units and stores the headers they share once.
+const char shard_magic[8] = {'L', 'C', 'V', 'I', 'D', 'X', '\0', '\0'};
+
+struct shard_header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t symbol_count;
+    std::uint32_t occurrence_count;
+    std::uint32_t dependency_count;
+    std::uint32_t base_count;
+    std::uint32_t override_count;
+    std::uint64_t source_hash;
+    std::uint64_t args_hash;
+    std::uint32_t unit;
+    std::uint32_t string_table_size;
+};
+
+struct shard_symbol {
+    std::uint32_t usr;
+    std::uint32_t name;
+    std::uint32_t qualified_name;
+    std::uint32_t kind;
+};
+
+struct shard_occurrence {
+    std::uint32_t symbol;
+    std::uint32_t file;
+    std::uint32_t line;
+    std::uint32_t column;
+    std::uint32_t offset;
+    std::uint32_t role;
+    std::uint32_t caller;
+};
+
+/// An edge between two USRs, e.g. from a derived class to its base.
+struct shard_relation {
+    std::uint32_t from;
+    std::uint32_t to;
+};
+
+/// Builds the string table of a shard, storing each string once.
+class string_table {
+    std::map<std::string, std::uint32_t> m_offsets;
+
+  public:
+    std::string contents;
+
+    std::uint32_t add(const std::string& string) {
+        auto it = m_offsets.find(string);
+        if (it != m_offsets.end())
+            return it->second;
+
+        const auto offset = static_cast<std::uint32_t>(contents.size());
+        contents.append(string.c_str(), string.size() + 1);
+        m_offsets.emplace(string, offset);
+        return offset;
+    }
+};
+
+std::string get_absolute_path(const std::string& file) {
+    if (!file.empty() && file[0] == '/')
+        return file;
+
+    return libclang_vim::get_current_directory() + "/" + file;
+}
+
+std::string get_shard_path(const std::string& directory,
+                           const libclang_vim::location_tuple& info) {
+    const std::string unit = get_absolute_path(info.file);
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.idx",
+                  static_cast<unsigned long long>(
+                      libclang_vim::hash_bytes(unit.data(), unit.size())));
+    return directory + "/" + name;
+}
+
+std::uint64_t hash_args(const libclang_vim::args_type& args) {
+    std::uint64_t hash = libclang_vim::hash_bytes(nullptr, 0);
+    for (const auto& arg : args)
+        hash = libclang_vim::hash_bytes(arg.c_str(), arg.size() + 1, hash);
+    return hash;
+}
+
+void add_dependency(CXFile included_file, CXSourceLocation*, unsigned,
+                    CXClientData client_data) {
+    auto& dependencies = *static_cast<std::vector<std::string>*>(client_data);
+    libclang_vim::cxstring_ptr name = clang_getFileName(included_file);
+    dependencies.push_back(libclang_vim::to_c_str(name));
+}
+
+template <typename T>
+void append(std::string& buffer, const T& value) {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void append_relations(
+    std::string& buffer, string_table& strings,
+    const std::set<std::pair<std::string, std::string>>& relations) {
+    for (const auto& relation : relations) {
+        shard_relation stored{strings.add(relation.first),
+                              strings.add(relation.second)};
+        append(buffer, stored);
+    }
+}
+}
+
+std::uint64_t
+libclang_vim::hash_dependencies(const std::vector<std::string>& dependencies,
+                                const location_tuple& info) {
+    std::uint64_t hash = hash_bytes(nullptr, 0);
+    for (const auto& dependency : dependencies) {
+        hash = hash_bytes(dependency.c_str(), dependency.size() + 1, hash);
+
+        const unsaved_buffer* unsaved = nullptr;
+        if (dependency == info.file && !info.unsaved_file.empty())
+            unsaved = &info.unsaved_file;
+        for (const auto& other : info.other_unsaved_files) {
+            if (other.first == dependency)
+                unsaved = &other.second;
+        }
+
+        if (unsaved)
+            hash = hash_bytes(unsaved->data(), unsaved->size(), hash);
+        else {
+            const std::uint64_t stamp = get_file_stamp(dependency);
+            hash = hash_bytes(reinterpret_cast<const char*>(&stamp),
+                              sizeof(stamp), hash);
+        }
+    }
+    return hash;
+}
+
+std::vector<std::string>
+libclang_vim::get_dependencies(CXTranslationUnit unit) {
+    std::vector<std::string> dependencies;
+    clang_getInclusions(unit, add_dependency, &dependencies);
+    return dependencies;
+}
+
+bool libclang_vim::save_index_shard(const std::string& directory,
+                                    const location_tuple& info,
+                                    const indexed_unit& data) {
+    if (!make_directories(directory))
+        return false;
+
+    string_table strings;
+    shard_header header{};
+    std::memcpy(header.magic, shard_magic, sizeof(header.magic));
+    header.version = index_shard_version;
+    header.symbol_count = data.symbols.size();
+    header.occurrence_count = data.occurrences.size();
+    header.dependency_count = data.dependencies.size();
+    header.base_count = data.bases.size();
+    header.override_count = data.overrides.size();
+    header.source_hash = hash_dependencies(data.dependencies, info);
+    header.args_hash = hash_args(info.args);
+    header.unit = strings.add(get_absolute_path(info.file));
+
+    std::string body;
+    std::map<std::string, std::uint32_t> symbol_indexes;
+    for (const auto& symbol : data.symbols) {
+        symbol_indexes.emplace(symbol.first, symbol_indexes.size());
+        shard_symbol stored{strings.add(symbol.first),
+                            strings.add(symbol.second.name),
+                            strings.add(symbol.second.qualified_name),
+                            static_cast<std::uint32_t>(symbol.second.kind)};
+        append(body, stored);
+    }
+    for (const auto& occurrence : data.occurrences) {
+        auto symbol = symbol_indexes.find(occurrence.usr);
+        if (symbol == symbol_indexes.end())
+            return false;
+
+        shard_occurrence stored{symbol->second,
+                                strings.add(occurrence.file),
+                                occurrence.line,
+                                occurrence.column,
+                                occurrence.offset,
+                                static_cast<std::uint32_t>(occurrence.role),
+                                strings.add(occurrence.caller)};
+        append(body, stored);
+    }
+    for (const auto& dependency : data.dependencies)
+        append(body, strings.add(dependency));
+    append_relations(body, strings, data.bases);
+    append_relations(body, strings, data.overrides);
+    header.string_table_size = strings.contents.size();
+
+    // Write to a temporary file first, so that concurrent readers never see
+    // a partial shard.
+    const std::string path = get_shard_path(directory, info);
+    const std::string temporary_path =
+        path + "." + std::to_string(getpid()) + ".tmp";
+    std::FILE* stream = std::fopen(temporary_path.c_str(), "wb");
+    if (!stream)
+        return false;
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, stream) == 1 &&
+              std::fwrite(body.data(), 1, body.size(), stream) == body.size() &&
+              std::fwrite(strings.contents.data(), 1, strings.contents.size(),
+                          stream) == strings.contents.size();
+    ok = std::fclose(stream) == 0 && ok;
+    if (!ok || std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+        std::remove(temporary_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool libclang_vim::load_index_shard(const std::string& directory,
+                                    const location_tuple& info,
+                                    indexed_unit& data) {
+    unsaved_buffer shard =
+        unsaved_buffer::map_file(get_shard_path(directory, info));
+    if (shard.size() < sizeof(shard_header))
+        return false;
+
+    shard_header header;
+    std::memcpy(&header, shard.data(), sizeof(header));
+    if (std::memcmp(header.magic, shard_magic, sizeof(header.magic)) != 0 ||
+        header.version != index_shard_version ||
+        header.args_hash != hash_args(info.args))
+        return false;
+
+    const std::size_t strings_offset =
+        sizeof(shard_header) + header.symbol_count * sizeof(shard_symbol) +
+        header.occurrence_count * sizeof(shard_occurrence) +
+        header.dependency_count * sizeof(std::uint32_t) +
+        (header.base_count + header.override_count) * sizeof(shard_relation);
+    if (strings_offset + header.string_table_size != shard.size() ||
+        header.string_table_size == 0 ||
+        shard.data()[shard.size() - 1] != '\0')
+        return false;
+
+    const char* strings = shard.data() + strings_offset;
+    bool strings_valid = true;
+    auto get_string = [&](std::uint32_t offset) {
+        if (offset >= header.string_table_size) {
+            strings_valid = false;
+            return std::string();
+        }
+        return std::string(strings + offset);
+    };
+
+    // Different file, just with the same hash.
+    if (get_string(header.unit) != get_absolute_path(info.file))
+        return false;
+
+    const char* position = shard.data() + sizeof(shard_header);
+    std::vector<std::string> usrs;
+    indexed_unit loaded;
+    for (std::uint32_t i = 0; i < header.symbol_count; ++i) {
+        shard_symbol stored;
+        std::memcpy(&stored, position, sizeof(stored));
+        position += sizeof(stored);
+
+        usrs.push_back(get_string(stored.usr));
+        symbol_info& symbol = loaded.symbols[usrs.back()];
+        symbol.name = get_string(stored.name);
+        symbol.qualified_name = get_string(stored.qualified_name);
+        symbol.kind = static_cast<CXIdxEntityKind>(stored.kind);
+    }
+    for (std::uint32_t i = 0; i < header.occurrence_count; ++i) {
+        shard_occurrence stored;
+        std::memcpy(&stored, position, sizeof(stored));
+        position += sizeof(stored);
+        if (stored.symbol >= usrs.size())
+            return false;
+
+        symbol_occurrence occurrence;
+        occurrence.usr = usrs[stored.symbol];
+        occurrence.file = get_string(stored.file);
+        occurrence.line = stored.line;
+        occurrence.column = stored.column;
+        occurrence.offset = stored.offset;
+        occurrence.role = static_cast<symbol_role>(stored.role);
+        occurrence.caller = get_string(stored.caller);
+        loaded.occurrences.push_back(std::move(occurrence));
+    }
+    for (std::uint32_t i = 0; i < header.dependency_count; ++i) {
+        std::uint32_t stored;
+        std::memcpy(&stored, position, sizeof(stored));
+        position += sizeof(stored);
+        loaded.dependencies.push_back(get_string(stored));
+    }
+    auto load_relations =
+        [&](std::uint32_t count,
+            std::set<std::pair<std::string, std::string>>& relations) {
+            for (std::uint32_t i = 0; i < count; ++i) {
+                shard_relation stored;
+                std::memcpy(&stored, position, sizeof(stored));
+                position += sizeof(stored);
+                relations.emplace(get_string(stored.from),
+                                  get_string(stored.to));
+            }
+        };
+    load_relations(header.base_count, loaded.bases);
+    load_relations(header.override_count, loaded.overrides);
+
+    if (!strings_valid ||
+        hash_dependencies(loaded.dependencies, info) != header.source_hash)
+        return false;
+
+    data = std::move(loaded);
+    return true;
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,36 @@
+#if !defined LIBCLANG_VIM_INDEX_SHARD_HPP_INCLUDED
+#define LIBCLANG_VIM_INDEX_SHARD_HPP_INCLUDED
+
+#include <cstdint>
+#include <string>
+
+#include "helpers.hpp"
+#include "symbol_index.hpp"
+
+namespace libclang_vim {
+
+/// Bump this when the layout of index shards changes.
+const std::uint32_t index_shard_version = 4;
+
+/// Hashes the current state of dependencies: the contents of their unsaved
+/// buffers in info, or their on-disk stamps.
+std::uint64_t hash_dependencies(const std::vector<std::string>& dependencies,
+                                const location_tuple& info);
+
+/// Returns the files unit was parsed from, the main file first.
+std::vector<std::string> get_dependencies(CXTranslationUnit unit);
+
+/// Writes data, the result of indexing info, to its shard in directory.
+bool save_index_shard(const std::string& directory, const location_tuple& info,
+                      const indexed_unit& data);
+
+/// Reads the shard of info from directory into data, but only if it was
+/// written with the same arguments and none of the dependencies changed since.
+bool load_index_shard(const std::string& directory, const location_tuple& info,
+                      indexed_unit& data);
+
+} // namespace libclang_vim
+
+#endif // LIBCLANG_VIM_INDEX_SHARD_HPP_INCLUDED
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
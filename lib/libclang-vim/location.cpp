@@ -1,5 +1,7 @@
 #include "location.hpp"
 
+#include "translation_unit_cache.hpp"
+
 namespace {
 
 CXCursor search_AST_upward(CXCursor cursor,
@@ -12,6 +14,17 @@ CXCursor search_AST_upward(CXCursor cursor,
     }
     return clang_getNullCursor();
 }
+
+CXVisitorResult add_reference_extent(void* context, CXCursor /*cursor*/,
+                                     CXSourceRange range) {
+    auto& vimson = *static_cast<std::string*>(context);
+    vimson += "{'start':{" +
+              libclang_vim::stringize_location(clang_getRangeStart(range)) +
+              "},'end':{" +
+              libclang_vim::stringize_location(clang_getRangeEnd(range)) +
+              "}},";
+    return CXVisit_Continue;
+}
 }
 
 const char*
@@ -61,15 +74,9 @@ const char* libclang_vim::get_all_extents(
     vimson = "";
     char const* file_name = location_info.file.c_str();
 
-    cxindex_ptr index =
-        clang_createIndex(/*excludeDeclsFromPCH*/ 1, /*displayDiagnostics*/ 0);
-    auto const args_ptrs = get_args_ptrs(location_info.args);
-    std::vector<CXUnsavedFile> unsaved_files =
-        create_unsaved_files(location_info);
     unsigned options = CXTranslationUnit_Incomplete;
-    cxtranslation_unit_ptr translation_unit(clang_parseTranslationUnit(
-        index, file_name, args_ptrs.data(), args_ptrs.size(),
-        unsaved_files.data(), unsaved_files.size(), options));
+    cached_translation_unit_ptr translation_unit =
+        parse_translation_unit_at(location_info, options);
     if (!translation_unit)
         return "[]";
 
@@ -97,4 +104,33 @@ const char* libclang_vim::get_all_extents(
     return vimson.c_str();
 }
 
+const char* libclang_vim::get_references_in_file_at(
+    const libclang_vim::location_tuple& location_info) {
+    static std::string vimson;
+    vimson = "";
+    char const* file_name = location_info.file.c_str();
+
+    unsigned options = CXTranslationUnit_Incomplete;
+    cached_translation_unit_ptr translation_unit =
+        parse_translation_unit_at(location_info, options);
+    if (!translation_unit)
+        return "[]";
+
+    CXFile file = clang_getFile(translation_unit, file_name);
+    auto const location = clang_getLocation(
+        translation_unit, file, location_info.line, location_info.col);
+    CXCursor cursor = clang_getCursor(translation_unit, location);
+    if (clang_Cursor_isNull(cursor) ||
+        clang_isInvalid(clang_getCursorKind(cursor)))
+        return "[]";
+
+    CXCursorAndRangeVisitor visitor{&vimson, add_reference_extent};
+    if (clang_findReferencesInFile(cursor, file, visitor) == CXResult_Invalid)
+        return "[]";
+
+    vimson = "[" + vimson + "]";
+
+    return vimson.c_str();
+}
+
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
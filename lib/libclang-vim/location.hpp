@@ -24,6 +24,10 @@ const char* get_type_related_to(const location_tuple& location_info,
 
 const char* get_all_extents(const location_tuple& location_info);
 
+/// Extents of all references in location_info.file to the symbol at
+/// location_info, using clang_findReferencesInFile().
+const char* get_references_in_file_at(const location_tuple& location_info);
+
 } // namespace libclang_vim
 
 #endif // LIBCLANG_VIM_LOCATION_HPP_INCLUDED
@@ -0,0 +1,62 @@
+#include "options.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+#include "helpers.hpp"
+
+namespace {
+
+const char* const known_options[] = {
+    "background_workers",
+    "cache_directory",
+    "header_owners",
+    "memory_budget",
+    "snapshot_size_limit",
+    "visible_workers",
+};
+}
+
+libclang_vim::option_store::option_store() { pin_library(); }
+
+bool libclang_vim::option_store::set(const std::string& name,
+                                     const std::string& value) {
+    if (std::find(std::begin(known_options), std::end(known_options), name) ==
+        std::end(known_options))
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_values[name] = value;
+    return true;
+}
+
+std::string libclang_vim::option_store::get(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_values.find(name);
+    if (it == m_values.end())
+        return std::string();
+
+    return it->second;
+}
+
+libclang_vim::option_store& libclang_vim::get_option_store() {
+    // Deliberately leaked, see get_thread_pool().
+    static option_store& store = *new option_store;
+    return store;
+}
+
+std::string libclang_vim::get_option(const std::string& name) {
+    return get_option_store().get(name);
+}
+
+const char* libclang_vim::set_option(const std::string& option) {
+    const auto name_end = option.find('=');
+    if (name_end == std::string::npos ||
+        !get_option_store().set(option.substr(0, name_end),
+                                option.substr(name_end + 1)))
+        return "{}";
+
+    return "{'ok':1}";
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
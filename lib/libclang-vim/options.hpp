@@ -0,0 +1,47 @@
+#if !defined LIBCLANG_VIM_OPTIONS_HPP_INCLUDED
+#define LIBCLANG_VIM_OPTIONS_HPP_INCLUDED
+
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace libclang_vim {
+
+/// Runtime settings of the library, see set_option() for the known names.
+class option_store {
+    std::map<std::string, std::string> m_values;
+    mutable std::mutex m_mutex;
+
+  public:
+    option_store();
+
+    /// Fails if name is not a known option.
+    bool set(const std::string& name, const std::string& value);
+
+    /// Returns the value of name, or an empty string if it's not set.
+    std::string get(const std::string& name) const;
+};
+
+option_store& get_option_store();
+
+/// Shorthand for get_option_store().get().
+std::string get_option(const std::string& name);
+
+/// Parse "name=value" and apply it to the store. Known options:
+///
+/// - background_workers: how many workers may run background tasks, all but
+///   one by default.
+/// - cache_directory: where the symbol index and translation unit snapshots
+///   are persisted, nothing is persisted if empty.
+/// - header_owners: if 1, requests about a location in a header use a cached
+///   translation unit including it, if any.
+/// - memory_budget: megabytes the cached translation units may take, 2048 by
+///   default.
+/// - snapshot_size_limit: megabytes the snapshots may take, 512 by default.
+const char* set_option(const std::string& option);
+
+} // namespace libclang_vim
+
+#endif // LIBCLANG_VIM_OPTIONS_HPP_INCLUDED
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
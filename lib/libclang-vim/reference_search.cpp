@@ -0,0 +1,376 @@
+#include "reference_search.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#include "include_graph.hpp"
+#include "shared_pch.hpp"
+#include "symbol_index.hpp"
+#include "thread_pool.hpp"
+#include "translation_unit_cache.hpp"
+
+namespace {
+
+bool contains(const libclang_vim::unsaved_buffer& buffer,
+              const std::string& text) {
+    const char* end = buffer.data() + buffer.size();
+    return std::search(buffer.data(), end, text.begin(), text.end()) != end;
+}
+
+/// Returns the contents of file as seen when parsing info.
+libclang_vim::unsaved_buffer
+get_contents(const libclang_vim::location_tuple& info,
+             const std::string& file) {
+    for (const auto& unsaved_file : info.other_unsaved_files) {
+        if (libclang_vim::get_real_path(unsaved_file.first) == file)
+            return unsaved_file.second;
+    }
+    return libclang_vim::unsaved_buffer::map_file(file);
+}
+
+/// Occurrences found in one file of a translation unit.
+class file_occurrences {
+  public:
+    std::string name;
+    const char* contents = nullptr;
+    std::size_t size = 0;
+    std::vector<libclang_vim::symbol_occurrence> found;
+};
+
+/// Collects the occurrences of a symbol while visiting a translation unit.
+class occurrence_collector {
+    CXTranslationUnit m_unit;
+    const std::string& m_usr;
+    const std::string& m_spelling;
+    /// Whether the canonical cursors seen so far are the symbol, by hash.
+    std::unordered_map<unsigned, std::vector<std::pair<CXCursor, bool>>>
+        m_matches;
+
+    bool is_match(CXCursor cursor) {
+        cursor = clang_getCanonicalCursor(cursor);
+        auto& bucket = m_matches[clang_hashCursor(cursor)];
+        for (const auto& seen : bucket) {
+            if (clang_equalCursors(seen.first, cursor))
+                return seen.second;
+        }
+        libclang_vim::cxstring_ptr usr = clang_getCursorUSR(cursor);
+        const bool match = m_usr == clang_getCString(usr);
+        bucket.emplace_back(cursor, match);
+        return match;
+    }
+
+    file_occurrences& get_file(CXFile file) {
+        file_occurrences& occurrences = files[file];
+        if (occurrences.name.empty()) {
+            libclang_vim::cxstring_ptr file_name = clang_getFileName(file);
+            occurrences.name = libclang_vim::get_real_path(
+                libclang_vim::to_c_str(file_name));
+            occurrences.contents =
+                clang_getFileContents(m_unit, file, &occurrences.size);
+        }
+        return occurrences;
+    }
+
+  public:
+    std::map<CXFile, file_occurrences> files;
+
+    occurrence_collector(CXTranslationUnit unit, const std::string& usr,
+                         const std::string& spelling)
+        : m_unit(unit), m_usr(usr), m_spelling(spelling) {}
+
+    void add(CXCursor cursor, CXSourceLocation location) {
+        const CXCursorKind kind = clang_getCursorKind(cursor);
+        libclang_vim::symbol_role role = libclang_vim::symbol_reference;
+        CXCursor symbol = cursor;
+        if (clang_isDeclaration(kind)) {
+            if (clang_isCursorDefinition(cursor))
+                role = libclang_vim::symbol_definition;
+            else
+                role = libclang_vim::symbol_declaration;
+        } else if (clang_isReference(kind) || kind == CXCursor_DeclRefExpr ||
+                   kind == CXCursor_MemberRefExpr)
+            symbol = clang_getCursorReferenced(cursor);
+        else
+            return;
+        if (clang_Cursor_isNull(symbol) || !is_match(symbol))
+            return;
+
+        CXFile file;
+        unsigned line, column, offset;
+        clang_getSpellingLocation(location, &file, &line, &column, &offset);
+        if (!file)
+            return;
+
+        // Only report locations where an edit of the spelling is possible,
+        // not e.g. implicit uses.
+        file_occurrences& occurrences = get_file(file);
+        if (!occurrences.contents ||
+            offset + m_spelling.size() > occurrences.size ||
+            std::memcmp(occurrences.contents + offset, m_spelling.data(),
+                        m_spelling.size()) != 0)
+            return;
+
+        libclang_vim::symbol_occurrence occurrence;
+        occurrence.file = occurrences.name;
+        occurrence.line = line;
+        occurrence.column = column;
+        occurrence.offset = offset;
+        occurrence.role = role;
+        occurrences.found.push_back(occurrence);
+    }
+};
+
+/// Returns the USR of the symbol at location_info, and sets spelling to its
+/// name unless it's already set.
+std::string get_symbol_at(const libclang_vim::location_tuple& location_info,
+                          std::string& spelling) {
+    if (location_info.file.empty())
+        return std::string();
+
+    libclang_vim::cached_translation_unit_ptr translation_unit =
+        libclang_vim::parse_translation_unit_at(location_info,
+                                                CXTranslationUnit_Incomplete);
+    if (!translation_unit)
+        return std::string();
+
+    CXFile file = clang_getFile(translation_unit, location_info.file.c_str());
+    CXSourceLocation location = clang_getLocation(
+        translation_unit, file, location_info.line, location_info.col);
+    CXCursor cursor = clang_getCursor(translation_unit, location);
+    CXCursor referenced = clang_getCursorReferenced(cursor);
+    if (clang_Cursor_isNull(referenced))
+        referenced = cursor;
+    libclang_vim::cxstring_ptr cursor_usr = clang_getCursorUSR(referenced);
+    if (spelling.empty()) {
+        libclang_vim::cxstring_ptr cursor_spelling =
+            clang_getCursorSpelling(referenced);
+        spelling = clang_getCString(cursor_spelling);
+    }
+    return clang_getCString(cursor_usr);
+}
+
+CXChildVisitResult collect_occurrence(CXCursor cursor, CXCursor /*parent*/,
+                                      CXClientData client_data) {
+    CXSourceLocation location = clang_getCursorLocation(cursor);
+    if (clang_Location_isInSystemHeader(location))
+        return CXChildVisit_Continue;
+
+    static_cast<occurrence_collector*>(client_data)->add(cursor, location);
+    return CXChildVisit_Recurse;
+}
+}
+
+bool libclang_vim::reference_search::is_current(std::uint64_t generation) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return generation == m_generation;
+}
+
+bool libclang_vim::reference_search::is_candidate(std::uint64_t generation,
+                                                  const location_tuple& info) {
+    std::string spelling;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (generation != m_generation)
+            return false;
+        if (m_indexed_units.count(info.file))
+            return true;
+        spelling = m_spelling;
+    }
+
+    if (contains(info.unsaved_file.empty()
+                     ? unsaved_buffer::map_file(info.file)
+                     : info.unsaved_file,
+                 spelling))
+        return true;
+
+    for (const auto& inclusion :
+         get_include_graph().get_inclusions(get_real_path(info.file))) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_headers.find(inclusion.file);
+            if (it != m_headers.end()) {
+                if (it->second)
+                    return true;
+                continue;
+            }
+        }
+
+        const bool found =
+            contains(get_contents(info, inclusion.file), spelling);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_headers[inclusion.file] = found;
+        if (found)
+            return true;
+    }
+    return false;
+}
+
+void libclang_vim::reference_search::search(std::uint64_t generation,
+                                            const location_tuple& info) {
+    std::string usr;
+    std::string spelling;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        usr = m_usr;
+        spelling = m_spelling;
+    }
+
+    // Each worker has its own index, so parses don't contend on it.
+    thread_local cxindex_ptr index(
+        clang_createIndex(/*excludeDeclsFromPCH*/ 1, /*displayDiagnostics*/ 0));
+    args_type args = info.args;
+    const args_type pch_args = get_shared_pch_store().get_args(info);
+    args.insert(args.end(), pch_args.begin(), pch_args.end());
+    auto const args_ptrs = get_args_ptrs(args);
+    std::vector<CXUnsavedFile> unsaved_files = create_unsaved_files(info);
+    cxtranslation_unit_ptr translation_unit(clang_parseTranslationUnit(
+        index, info.file.c_str(), args_ptrs.data(), args_ptrs.size(),
+        unsaved_files.data(), unsaved_files.size(),
+        CXTranslationUnit_Incomplete));
+
+    occurrence_collector collector(translation_unit, usr, spelling);
+    if (translation_unit) {
+        get_include_graph().update(get_real_path(info.file), translation_unit);
+        clang_visitChildren(clang_getTranslationUnitCursor(translation_unit),
+                            collect_occurrence, &collector);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (generation != m_generation)
+        return;
+
+    for (const auto& file : collector.files) {
+        std::string references;
+        for (const auto& occurrence : file.second.found) {
+            if (!m_seen.emplace(occurrence.file, occurrence.offset).second)
+                continue;
+
+            references += "{'line':" + std::to_string(occurrence.line) +
+                          ",'column':" + std::to_string(occurrence.column) +
+                          ",'offset':" + std::to_string(occurrence.offset) +
+                          ",'role':'" + stringize_role(occurrence.role) +
+                          "'},";
+        }
+        if (!references.empty())
+            m_results.push_back("{'file':'" + file.second.name +
+                                "','references':[" + references + "]}");
+    }
+    ++m_done;
+}
+
+bool libclang_vim::reference_search::start(
+    const std::string& usr, const std::string& spelling,
+    const std::vector<location_tuple>& files) {
+    std::uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_done < m_total)
+            return false;
+
+        generation = ++m_generation;
+        m_usr = usr;
+        m_spelling = spelling;
+        m_results.clear();
+        m_indexed_units = get_symbol_index().get_units(usr);
+        m_headers.clear();
+        m_seen.clear();
+        m_total = files.size();
+        m_done = 0;
+        m_skipped = 0;
+    }
+
+    thread_pool& pool = get_thread_pool();
+    for (const auto& file : files) {
+        pool.post(
+            [this, generation, file] {
+                if (!is_current(generation))
+                    return;
+
+                if (is_candidate(generation, file)) {
+                    search(generation, file);
+                    return;
+                }
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (generation != m_generation)
+                    return;
+                ++m_skipped;
+                ++m_done;
+            },
+            task_priority::visible);
+    }
+    return true;
+}
+
+void libclang_vim::reference_search::cancel() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_generation;
+    m_results.clear();
+    m_total = m_done;
+}
+
+std::string libclang_vim::reference_search::poll() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::string vimson = "{'done':" + std::to_string(m_done) +
+                         ",'total':" + std::to_string(m_total) +
+                         ",'skipped':" + std::to_string(m_skipped) +
+                         ",'results':[";
+    for (const auto& result : m_results)
+        vimson += result + ",";
+    vimson += "]}";
+    m_results.clear();
+    return vimson;
+}
+
+libclang_vim::reference_search& libclang_vim::get_reference_search() {
+    // Deliberately leaked, see get_thread_pool().
+    static reference_search& search = *new reference_search;
+    return search;
+}
+
+const char* libclang_vim::start_reference_search(const std::string& request) {
+    static std::string vimson;
+
+    const auto usr_end = request.find('\n');
+    if (usr_end == std::string::npos || usr_end == 0)
+        return "{}";
+    const auto spelling_end = request.find('\n', usr_end + 1);
+    std::string spelling = request.substr(
+        usr_end + 1, spelling_end == std::string::npos
+                         ? std::string::npos
+                         : spelling_end - usr_end - 1);
+    const std::string usr = get_usr_of_request(
+        request.substr(0, usr_end),
+        [&spelling](const location_tuple& location_info) {
+            return get_symbol_at(location_info, spelling);
+        });
+    if (usr.empty())
+        return "{}";
+    if (spelling.empty())
+        spelling = get_symbol_index().get_name(usr);
+    if (spelling.empty())
+        return "{}";
+
+    std::vector<location_tuple> files;
+    if (spelling_end != std::string::npos)
+        files = parse_file_list(request.substr(spelling_end + 1));
+    if (!get_reference_search().start(usr, spelling, files))
+        return "{}";
+
+    vimson = "{'total':" + std::to_string(files.size()) + "}";
+    return vimson.c_str();
+}
+
+const char* libclang_vim::poll_reference_search() {
+    static std::string vimson;
+    vimson = get_reference_search().poll();
+    return vimson.c_str();
+}
+
+const char* libclang_vim::cancel_reference_search() {
+    get_reference_search().cancel();
+    return "{}";
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
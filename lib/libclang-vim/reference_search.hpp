@@ -0,0 +1,77 @@
+#if !defined LIBCLANG_VIM_REFERENCE_SEARCH_HPP_INCLUDED
+#define LIBCLANG_VIM_REFERENCE_SEARCH_HPP_INCLUDED
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "helpers.hpp"
+
+namespace libclang_vim {
+
+/// Collects the occurrences of a symbol in many files on the thread pool, e.g.
+/// for a rename. Only the files which may refer to the symbol are parsed: the
+/// ones the index knows to, and the ones which contain its spelling, directly
+/// or in the headers they included the last time they were parsed.
+class reference_search {
+    std::string m_usr;
+    std::string m_spelling;
+    /// Results finished since the last poll().
+    std::vector<std::string> m_results;
+    std::size_t m_total = 0;
+    std::size_t m_done = 0;
+    /// Files not parsed, as they can't refer to the symbol.
+    std::size_t m_skipped = 0;
+    /// Units indexed with an occurrence of the symbol.
+    std::set<std::string> m_indexed_units;
+    /// Whether a header contains the spelling, for the headers checked so far.
+    std::map<std::string, bool> m_headers;
+    /// Reported locations as file and offset: headers are seen by many units.
+    std::set<std::pair<std::string, unsigned>> m_seen;
+    /// Incremented on each start() and cancel(), so that tasks of an earlier
+    /// search know that they are obsolete.
+    std::uint64_t m_generation = 0;
+    std::mutex m_mutex;
+
+    bool is_current(std::uint64_t generation);
+
+    /// Decides if info has to be parsed.
+    bool is_candidate(std::uint64_t generation, const location_tuple& info);
+
+    /// Parses info and adds the occurrences not reported yet to the results.
+    void search(std::uint64_t generation, const location_tuple& info);
+
+  public:
+    /// Starts searching files for usr, spelled as spelling. Fails if the
+    /// previous search is still running.
+    bool start(const std::string& usr, const std::string& spelling,
+               const std::vector<location_tuple>& files);
+
+    void cancel();
+
+    /// Returns the progress and the occurrences found since the last poll,
+    /// grouped by file.
+    std::string poll();
+};
+
+reference_search& get_reference_search();
+
+/// Parse "usr\nspelling\n" followed by a file list (see parse_file_list()),
+/// and start a search. The USR may also be given as "file:args:line:col" of
+/// an occurrence. The spelling may be empty for an indexed symbol or if a
+/// location is given.
+const char* start_reference_search(const std::string& request);
+
+const char* poll_reference_search();
+
+const char* cancel_reference_search();
+
+} // namespace libclang_vim
+
+#endif // LIBCLANG_VIM_REFERENCE_SEARCH_HPP_INCLUDED
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,93 @@
+#include "result_cache.hpp"
+
+#include "include_graph.hpp"
+#include "index_shard.hpp"
+#include "stats.hpp"
+
+namespace {
+
+/// Number of results kept at the same time.
+const std::size_t max_cached_results = 64;
+
+std::string make_key(const std::string& kind,
+                     const libclang_vim::location_tuple& location_info) {
+    std::string key = kind + '\n' + libclang_vim::get_current_directory() +
+                      '\n' + location_info.file;
+    for (const auto& arg : location_info.args)
+        key += '\n' + arg;
+    return key;
+}
+}
+
+libclang_vim::result_cache::result_cache() { pin_library(); }
+
+void libclang_vim::result_cache::evict() {
+    while (m_entries.size() > max_cached_results) {
+        auto oldest = m_entries.begin();
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (it->second.last_used < oldest->second.last_used)
+                oldest = it;
+        }
+        m_entries.erase(oldest);
+    }
+}
+
+const char*
+libclang_vim::result_cache::get(const std::string& kind,
+                                const location_tuple& location_info,
+                                const std::function<std::string()>& compute) {
+    const std::uint64_t unsaved_hash =
+        hash_unsaved_files(create_unsaved_files(location_info));
+    const std::string key = make_key(kind, location_info);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end() && it->second.unsaved_hash == unsaved_hash &&
+            it->second.dependencies.is_current(location_info)) {
+            it->second.last_used = ++m_clock;
+            count_event("result_cache.hits");
+            return it->second.result.c_str();
+        }
+    }
+    count_event("result_cache.misses");
+
+    std::string result = compute();
+    std::string file = get_real_path(location_info.file);
+    dependency_state dependencies;
+    dependencies.record(get_include_graph().get_dependencies(file),
+                        location_info);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    entry& stored = m_entries[key];
+    stored.unsaved_hash = unsaved_hash;
+    stored.dependencies = std::move(dependencies);
+    stored.file = std::move(file);
+    stored.result = std::move(result);
+    stored.last_used = ++m_clock;
+    const char* ret = stored.result.c_str();
+    evict();
+    return ret;
+}
+
+std::size_t
+libclang_vim::result_cache::invalidate(const std::set<std::string>& files) {
+    std::size_t invalidated = 0;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (files.count(it->second.file)) {
+            it = m_entries.erase(it);
+            ++invalidated;
+        } else
+            ++it;
+    }
+    return invalidated;
+}
+
+libclang_vim::result_cache& libclang_vim::get_result_cache() {
+    // Deliberately leaked, see get_thread_pool().
+    static result_cache& cache = *new result_cache;
+    return cache;
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
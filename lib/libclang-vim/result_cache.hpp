@@ -0,0 +1,60 @@
+#if !defined LIBCLANG_VIM_RESULT_CACHE_HPP_INCLUDED
+#define LIBCLANG_VIM_RESULT_CACHE_HPP_INCLUDED
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "file_watcher.hpp"
+#include "helpers.hpp"
+
+namespace libclang_vim {
+
+/// Keeps the results of recent requests, so that repeating a request with
+/// unchanged inputs (e.g. on every CursorHold) does not even reparse. The
+/// inputs are the unsaved buffers and all files the unit was parsed from.
+class result_cache {
+    struct entry {
+        /// Hash of the unsaved files.
+        std::uint64_t unsaved_hash = 0;
+        /// Files the result was computed from, according to the include graph
+        /// after the computation.
+        dependency_state dependencies;
+        /// Canonical name of the main file.
+        std::string file;
+        std::string result;
+        std::uint64_t last_used = 0;
+    };
+
+    std::map<std::string, entry> m_entries;
+    std::uint64_t m_clock = 0;
+    std::mutex m_mutex;
+
+    void evict();
+
+  public:
+    result_cache();
+
+    /// Returns the result of the request kind for location_info, calling
+    /// compute() only if the request was not seen with the same inputs
+    /// before. The result is valid until the next call.
+    const char* get(const std::string& kind,
+                    const location_tuple& location_info,
+                    const std::function<std::string()>& compute);
+
+    /// Forgets the results for the canonical main files in files. Returns the
+    /// number of forgotten results.
+    std::size_t invalidate(const std::set<std::string>& files);
+};
+
+result_cache& get_result_cache();
+
+} // namespace libclang_vim
+
+#endif // LIBCLANG_VIM_RESULT_CACHE_HPP_INCLUDED
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,133 @@
+#include "session_recorder.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "helpers.hpp"
+
+namespace {
+
+libclang_vim::session_recorder* create_session_recorder() {
+    auto* instance = new libclang_vim::session_recorder();
+    // Not destroyed, but the session file is closed all the same.
+    std::atexit([] { libclang_vim::get_session_recorder().stop(); });
+    return instance;
+}
+}
+
+libclang_vim::session_recorder::session_recorder() : m_enabled(false) {
+    pin_library();
+}
+
+libclang_vim::session_recorder::~session_recorder() { stop(); }
+
+bool libclang_vim::session_recorder::start(const std::string& file) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file)
+        return false;
+
+    m_file = std::fopen(file.c_str(), "w");
+    if (!m_file)
+        return false;
+
+    std::fputs("libclang-vim session\n", m_file);
+    m_start = std::chrono::steady_clock::now();
+    m_calls = 0;
+    m_enabled = true;
+    return true;
+}
+
+std::size_t libclang_vim::session_recorder::stop() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file)
+        return 0;
+
+    m_enabled = false;
+    std::fclose(m_file);
+    m_file = nullptr;
+    return m_calls;
+}
+
+bool libclang_vim::session_recorder::is_enabled() const {
+    return m_enabled.load(std::memory_order_relaxed);
+}
+
+void libclang_vim::session_recorder::write_record(const std::string& header,
+                                                  const char* data,
+                                                  std::size_t size) {
+    std::fputs(header.c_str(), m_file);
+    std::fwrite(data, 1, size, m_file);
+    std::fputc('\n', m_file);
+}
+
+void libclang_vim::session_recorder::add_call(const char* name,
+                                              const char* input) {
+    const auto now = std::chrono::steady_clock::now();
+
+    // Unsaved buffers are in the "file#path" first field of each line: file
+    // lists have one file per line, other requests only one line.
+    std::vector<std::pair<std::string, location_tuple>> snapshots;
+    for (const char* line = input; *line;) {
+        const char* line_end = std::strchr(line, '\n');
+        if (!line_end)
+            line_end = line + std::strlen(line);
+        const char* field_end = std::find(line, line_end, ':');
+        const std::string field(line, field_end);
+        const auto hash = field.find('#');
+        if (hash != std::string::npos) {
+            location_tuple info;
+            info.file = field;
+            extract_unsaved_file(info);
+            snapshots.emplace_back(field.substr(hash + 1), std::move(info));
+        }
+        line = *line_end ? line_end + 1 : line_end;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file)
+        return;
+
+    for (const auto& snapshot : snapshots) {
+        const unsaved_buffer& buffer = snapshot.second.unsaved_file;
+        write_record("snapshot " + std::to_string(buffer.size()) + " " +
+                         snapshot.first + "\n",
+                     buffer.data(), buffer.size());
+    }
+    const auto elapsed =
+        std::chrono::duration_cast<std::chrono::microseconds>(now - m_start);
+    const std::size_t size = std::strlen(input);
+    write_record("call " + std::to_string(elapsed.count()) + " " + name + " " +
+                     std::to_string(size) + "\n",
+                 input, size);
+    ++m_calls;
+}
+
+libclang_vim::session_recorder& libclang_vim::get_session_recorder() {
+    // Deliberately leaked, see get_thread_pool().
+    static session_recorder& instance = *create_session_recorder();
+    return instance;
+}
+
+void libclang_vim::record_call(const char* name, const char* input) {
+    session_recorder& recorder = get_session_recorder();
+    if (recorder.is_enabled())
+        recorder.add_call(name, input);
+}
+
+const char* libclang_vim::start_recording(const std::string& file) {
+    if (file.empty() || !get_session_recorder().start(file))
+        return "{}";
+
+    return "{'ok':1}";
+}
+
+const char* libclang_vim::stop_recording() {
+    static std::string vimson;
+    vimson = "{'calls':" + std::to_string(get_session_recorder().stop()) + "}";
+    return vimson.c_str();
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
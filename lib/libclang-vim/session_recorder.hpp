@@ -0,0 +1,66 @@
+#if !defined LIBCLANG_VIM_SESSION_RECORDER_HPP_INCLUDED
+#define LIBCLANG_VIM_SESSION_RECORDER_HPP_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+namespace libclang_vim {
+
+/// Writes the calls of the entry points to a file while started, so that an
+/// editor session can be replayed later by qa/tool --replay. The file starts
+/// with a "libclang-vim session" line, followed by records of the form
+///
+///     call <microseconds since start> <name> <bytes>\n<input>\n
+///     snapshot <bytes> <path>\n<contents>\n
+///
+/// where a snapshot of each unsaved buffer passed as "file#path", on any line
+/// of the input, precedes the call using it, as the buffer is usually gone by
+/// the time of the replay.
+class session_recorder {
+    std::atomic<bool> m_enabled;
+    std::FILE* m_file = nullptr;
+    std::chrono::steady_clock::time_point m_start;
+    std::size_t m_calls = 0;
+    std::mutex m_mutex;
+
+    void write_record(const std::string& header, const char* data,
+                      std::size_t size);
+
+  public:
+    session_recorder();
+    session_recorder(const session_recorder&) = delete;
+    session_recorder& operator=(const session_recorder&) = delete;
+    ~session_recorder();
+
+    /// Starts writing to file, replacing its contents. Fails if already
+    /// started or the file can't be created.
+    bool start(const std::string& file);
+
+    /// Closes the file, returns the number of recorded calls.
+    std::size_t stop();
+
+    bool is_enabled() const;
+
+    /// Records a call of the entry point name with input.
+    void add_call(const char* name, const char* input);
+};
+
+session_recorder& get_session_recorder();
+
+/// Record a call of the entry point name, if recording is started.
+void record_call(const char* name, const char* input);
+
+/// Start recording the calls into file.
+const char* start_recording(const std::string& file);
+
+/// Stop recording and describe the written session.
+const char* stop_recording();
+
+} // namespace libclang_vim
+
+#endif // LIBCLANG_VIM_SESSION_RECORDER_HPP_INCLUDED
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
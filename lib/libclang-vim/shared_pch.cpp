@@ -0,0 +1,335 @@
+#include "shared_pch.hpp"
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unistd.h>
+
+#include "index_shard.hpp"
+#include "options.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+
+/// A prefix of includes is only worth a header if this many files share it.
+const std::size_t min_shared_files = 2;
+
+/// Only the start of a file is searched for includes.
+const std::size_t max_scanned_size = 64 * 1024;
+
+std::string trim(const std::string& text) {
+    const auto begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos)
+        return std::string();
+    const auto end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+bool starts_with(const std::string& text, const char* prefix) {
+    return text.compare(0, std::strlen(prefix), prefix) == 0;
+}
+
+std::string get_directory(const std::string& file) {
+    const auto slash = file.rfind('/');
+    if (slash == std::string::npos || slash == 0)
+        return "/";
+    return file.substr(0, slash);
+}
+
+std::vector<std::string>
+get_file_includes(const libclang_vim::location_tuple& info) {
+    libclang_vim::unsaved_buffer contents = info.unsaved_file;
+    if (contents.empty())
+        contents = libclang_vim::unsaved_buffer::map_file(info.file);
+    return libclang_vim::get_leading_includes(
+        contents.data(), std::min(contents.size(), max_scanned_size));
+}
+
+/// Drops the arguments which differ between the files of a project, but don't
+/// matter for a header.
+libclang_vim::args_type get_header_args(const libclang_vim::args_type& args) {
+    libclang_vim::args_type header_args;
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == "-o" || args[i] == "-include-pch" || args[i] == "-MF" ||
+            args[i] == "-MT" || args[i] == "-MQ")
+            ++i;
+        else if (args[i] != "-c" && args[i] != "-MD" && args[i] != "-MMD")
+            header_args.push_back(args[i]);
+    }
+    return header_args;
+}
+
+const char* get_header_language(const std::string& file) {
+    const auto dot = file.rfind('.');
+    if (dot != std::string::npos && file.substr(dot) == ".c")
+        return "c-header";
+    return "c++-header";
+}
+
+std::string get_group_key(const libclang_vim::location_tuple& info) {
+    std::string key = get_directory(libclang_vim::get_real_path(info.file)) +
+                      '\n' + get_header_language(info.file);
+    for (const auto& arg : get_header_args(info.args))
+        key += '\n' + arg;
+    return key;
+}
+
+/// Returns the prefix of lists which saves the most parsing: the number of
+/// lists starting with it times its length.
+std::vector<std::string>
+find_shared_prefix(const std::vector<std::vector<std::string>>& lists) {
+    std::map<std::vector<std::string>, std::size_t> counts;
+    for (const auto& list : lists) {
+        for (std::size_t size = 1; size <= list.size(); ++size)
+            ++counts[std::vector<std::string>(list.begin(),
+                                              list.begin() + size)];
+    }
+
+    std::vector<std::string> best;
+    std::size_t best_score = 0;
+    for (const auto& count : counts) {
+        const std::size_t score = count.first.size() * count.second;
+        if (count.second >= min_shared_files && score > best_score) {
+            best = count.first;
+            best_score = score;
+        }
+    }
+    return best;
+}
+
+bool starts_with(const std::vector<std::string>& list,
+                 const std::vector<std::string>& prefix) {
+    return list.size() >= prefix.size() &&
+           std::equal(prefix.begin(), prefix.end(), list.begin());
+}
+
+/// Writes and precompiles path.h, the includes of header for the files like
+/// info, to path.pch.
+bool build_header(const std::string& path,
+                  const libclang_vim::location_tuple& info,
+                  libclang_vim::shared_pch& header) {
+    const std::string source = path + ".h";
+    {
+        // Quoted includes are relative to the directory of the including
+        // file, which is not the one of the header.
+        const std::string directory =
+            get_directory(libclang_vim::get_real_path(info.file));
+        std::ofstream stream(source);
+        for (const auto& include : header.includes) {
+            const std::string name = include.substr(1, include.size() - 2);
+            if (include[0] == '"' && name[0] != '/' &&
+                access((directory + "/" + name).c_str(), F_OK) == 0)
+                stream << "#include \"" << directory << "/" << name << "\"\n";
+            else
+                stream << "#include " << include << "\n";
+        }
+        if (!stream)
+            return false;
+    }
+
+    thread_local libclang_vim::cxindex_ptr index(
+        clang_createIndex(/*excludeDeclsFromPCH*/ 1, /*displayDiagnostics*/ 0));
+    libclang_vim::args_type args = get_header_args(info.args);
+    args.emplace_back("-x");
+    args.emplace_back(get_header_language(info.file));
+    auto const args_ptrs = libclang_vim::get_args_ptrs(args);
+    libclang_vim::cxtranslation_unit_ptr translation_unit(
+        clang_parseTranslationUnit(index, source.c_str(), args_ptrs.data(),
+                                   args_ptrs.size(), nullptr, 0,
+                                   CXTranslationUnit_Incomplete |
+                                       CXTranslationUnit_ForSerialization));
+    if (!translation_unit)
+        return false;
+
+    // A header with errors would only break the files using it.
+    for (unsigned i = 0; i < clang_getNumDiagnostics(translation_unit); ++i) {
+        CXDiagnostic diagnostic = clang_getDiagnostic(translation_unit, i);
+        const CXDiagnosticSeverity severity =
+            clang_getDiagnosticSeverity(diagnostic);
+        clang_disposeDiagnostic(diagnostic);
+        if (severity >= CXDiagnostic_Error)
+            return false;
+    }
+
+    header.path = path + ".pch";
+    if (clang_saveTranslationUnit(translation_unit, header.path.c_str(),
+                                  clang_defaultSaveOptions(translation_unit)) !=
+        CXSaveError_None)
+        return false;
+
+    header.dependencies = libclang_vim::get_dependencies(translation_unit);
+    header.dependency_hash = libclang_vim::hash_dependencies(
+        header.dependencies, libclang_vim::location_tuple());
+    return true;
+}
+}
+
+libclang_vim::shared_pch::shared_pch() = default;
+
+libclang_vim::shared_pch_store::shared_pch_store() { pin_library(); }
+
+void libclang_vim::shared_pch_store::set(
+    std::map<std::string, shared_pch> headers) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_headers = std::move(headers);
+}
+
+libclang_vim::args_type libclang_vim::shared_pch_store::get_args(
+    const location_tuple& info, std::vector<std::string>* dependencies) const {
+    shared_pch header;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_headers.empty())
+            return args_type();
+
+        auto it = m_headers.find(get_group_key(info));
+        if (it == m_headers.end())
+            return args_type();
+        header = it->second;
+    }
+
+    // The file has to include the same files first, and none of them may
+    // have changed since the header was built, or clang refuses it.
+    if (!starts_with(get_file_includes(info), header.includes) ||
+        hash_dependencies(header.dependencies, info) != header.dependency_hash)
+        return args_type();
+
+    if (dependencies)
+        *dependencies = header.dependencies;
+    return args_type{"-include-pch", header.path};
+}
+
+libclang_vim::shared_pch_store& libclang_vim::get_shared_pch_store() {
+    // Deliberately leaked, see get_thread_pool().
+    static shared_pch_store& store = *new shared_pch_store;
+    return store;
+}
+
+std::vector<std::string> libclang_vim::get_leading_includes(const char* data,
+                                                            size_t size) {
+    std::vector<std::string> includes;
+    bool in_comment = false;
+    const char* end = data + size;
+    for (const char* line = data; line < end;) {
+        const char* line_end =
+            static_cast<const char*>(std::memchr(line, '\n', end - line));
+        if (!line_end)
+            line_end = end;
+        const std::string text = trim(std::string(line, line_end));
+        line = line_end + 1;
+
+        if (in_comment) {
+            in_comment = text.find("*/") == std::string::npos;
+            continue;
+        }
+        if (text.empty() || starts_with(text, "//"))
+            continue;
+        if (starts_with(text, "/*")) {
+            in_comment = text.find("*/", 2) == std::string::npos;
+            continue;
+        }
+        if (text[0] != '#')
+            break;
+
+        const std::string directive = trim(text.substr(1));
+        if (starts_with(directive, "pragma once"))
+            continue;
+        if (!starts_with(directive, "include"))
+            break;
+
+        const std::string target = trim(directive.substr(7));
+        if (target.empty() || (target[0] != '"' && target[0] != '<'))
+            break;
+        const auto closing = target.find(target[0] == '"' ? '"' : '>', 1);
+        if (closing == std::string::npos)
+            break;
+        includes.push_back(target.substr(0, closing + 1));
+    }
+    return includes;
+}
+
+const char* libclang_vim::build_shared_pch(const std::string& request) {
+    static std::string vimson;
+
+    const std::string cache_directory = get_option("cache_directory");
+    if (cache_directory.empty())
+        return "{}";
+    const std::string directory = cache_directory + "/pch";
+    if (!make_directories(directory))
+        return "{}";
+
+    std::map<std::string, std::vector<location_tuple>> groups;
+    for (const auto& file : parse_file_list(request))
+        groups[get_group_key(file)].push_back(file);
+
+    // Only one header per group: a file can only use one.
+    std::vector<std::pair<std::string, location_tuple>> builds;
+    std::map<std::string, shared_pch> headers;
+    std::map<std::string, std::size_t> covered_files;
+    for (const auto& group : groups) {
+        std::vector<std::vector<std::string>> includes;
+        for (const auto& file : group.second)
+            includes.push_back(get_file_includes(file));
+        shared_pch header;
+        header.includes = find_shared_prefix(includes);
+        if (header.includes.empty())
+            continue;
+
+        for (const auto& file_includes : includes)
+            covered_files[group.first] +=
+                starts_with(file_includes, header.includes);
+        headers[group.first] = header;
+        builds.emplace_back(group.first, group.second.front());
+    }
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::size_t remaining = builds.size();
+    for (const auto& build : builds) {
+        shared_pch& header = headers[build.first];
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx",
+                      static_cast<unsigned long long>(hash_bytes(
+                          build.first.data(), build.first.size())));
+        const std::string path = directory + "/" + name;
+        const location_tuple& info = build.second;
+        get_thread_pool().post(
+            [&, path] {
+                const bool built = build_header(path, info, header);
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!built)
+                    header.includes.clear();
+                if (--remaining == 0)
+                    finished.notify_one();
+            },
+            task_priority::interactive);
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&remaining] { return remaining == 0; });
+    }
+
+    std::size_t files = 0;
+    for (auto it = headers.begin(); it != headers.end();) {
+        if (it->second.includes.empty())
+            it = headers.erase(it);
+        else {
+            files += covered_files[it->first];
+            ++it;
+        }
+    }
+    const std::size_t built = headers.size();
+    get_shared_pch_store().set(std::move(headers));
+
+    vimson = "{'headers':" + std::to_string(built) +
+             ",'files':" + std::to_string(files) + "}";
+    return vimson.c_str();
+}
+
+const char* libclang_vim::clear_shared_pch() {
+    get_shared_pch_store().set(std::map<std::string, shared_pch>());
+    return "{'ok':1}";
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,65 @@
+#if !defined LIBCLANG_VIM_SHARED_PCH_HPP_INCLUDED
+#define LIBCLANG_VIM_SHARED_PCH_HPP_INCLUDED
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "helpers.hpp"
+
+namespace libclang_vim {
+
+/// A precompiled header of the #include directives many files of a project
+/// start with, built for one set of arguments.
+class shared_pch {
+  public:
+    std::string path;
+    /// The shared #include directives, as their "file" or <file> part.
+    std::vector<std::string> includes;
+    /// The files the header was built from, and the hash of their state.
+    std::vector<std::string> dependencies;
+    std::uint64_t dependency_hash = 0;
+
+    shared_pch();
+};
+
+/// The shared precompiled headers, by the directory, language and arguments
+/// of the files they are for.
+class shared_pch_store {
+    std::map<std::string, shared_pch> m_headers;
+    mutable std::mutex m_mutex;
+
+  public:
+    shared_pch_store();
+
+    /// Replaces all headers.
+    void set(std::map<std::string, shared_pch> headers);
+
+    /// Returns the arguments to add when parsing info, which make it use a
+    /// shared header if there is an up to date one for it. If dependencies
+    /// is given, it's set to the files the header was built from.
+    args_type get_args(const location_tuple& info,
+                       std::vector<std::string>* dependencies = nullptr) const;
+};
+
+shared_pch_store& get_shared_pch_store();
+
+/// Returns the #include directives at the start of the data, before anything
+/// else than comments and blank lines, as their "file" or <file> part.
+std::vector<std::string> get_leading_includes(const char* data, size_t size);
+
+/// Parse a file list (see parse_file_list()), build a header for each group
+/// of files with the same arguments that start with the same includes, and
+/// use them from then on.
+const char* build_shared_pch(const std::string& request);
+
+/// Stop using shared headers.
+const char* clear_shared_pch();
+
+} // namespace libclang_vim
+
+#endif // LIBCLANG_VIM_SHARED_PCH_HPP_INCLUDED
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
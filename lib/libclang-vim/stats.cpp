@@ -0,0 +1,136 @@
+#include "stats.hpp"
+
+#include <algorithm>
+
+#include "helpers.hpp"
+#include "trace.hpp"
+
+namespace {
+
+/// Number of samples kept per latency for the percentiles.
+const std::size_t max_samples = 1024;
+
+const char hits_suffix[] = ".hits";
+const char misses_suffix[] = ".misses";
+
+/// Returns the nearest-rank percentile of sorted samples.
+std::uint64_t get_percentile(const std::vector<std::uint64_t>& sorted,
+                             unsigned percent) {
+    if (sorted.empty())
+        return 0;
+    const std::size_t rank = (sorted.size() * percent + 99) / 100;
+    return sorted[std::max<std::size_t>(rank, 1) - 1];
+}
+}
+
+libclang_vim::stats_store::stats_store() { pin_library(); }
+
+void libclang_vim::stats_store::record(const std::string& name,
+                                       std::uint64_t microseconds) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    timer& stored = m_timers[name];
+    ++stored.count;
+    stored.total += microseconds;
+    stored.max = std::max(stored.max, microseconds);
+    if (stored.samples.size() < max_samples)
+        stored.samples.push_back(microseconds);
+    else
+        stored.samples[stored.next] = microseconds;
+    stored.next = (stored.next + 1) % max_samples;
+}
+
+void libclang_vim::stats_store::count(const std::string& name) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_counters[name];
+}
+
+std::string libclang_vim::stats_store::get_vimson() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::string vimson = "{'timers':{";
+    for (const auto& stored : m_timers) {
+        std::vector<std::uint64_t> sorted = stored.second.samples;
+        std::sort(sorted.begin(), sorted.end());
+        vimson += "'" + stored.first +
+                  "':{'count':" + std::to_string(stored.second.count) +
+                  ",'total':" + std::to_string(stored.second.total) +
+                  ",'max':" + std::to_string(stored.second.max) +
+                  ",'p50':" + std::to_string(get_percentile(sorted, 50)) +
+                  ",'p95':" + std::to_string(get_percentile(sorted, 95)) +
+                  ",'p99':" + std::to_string(get_percentile(sorted, 99)) +
+                  "},";
+    }
+
+    vimson += "},'counters':{";
+    for (const auto& counter : m_counters)
+        vimson += "'" + counter.first +
+                  "':" + std::to_string(counter.second) + ",";
+
+    // In percent.
+    vimson += "},'hit_rates':{";
+    const std::size_t suffix_size = sizeof(hits_suffix) - 1;
+    for (const auto& counter : m_counters) {
+        const std::string& name = counter.first;
+        if (name.size() <= suffix_size ||
+            name.compare(name.size() - suffix_size, suffix_size,
+                         hits_suffix) != 0)
+            continue;
+        const std::string cache = name.substr(0, name.size() - suffix_size);
+        const auto misses = m_counters.find(cache + misses_suffix);
+        const std::uint64_t total =
+            counter.second +
+            (misses == m_counters.end() ? 0 : misses->second);
+        vimson += "'" + cache +
+                  "':" + std::to_string(counter.second * 100 / total) + ",";
+    }
+    vimson += "}}";
+    return vimson;
+}
+
+void libclang_vim::stats_store::reset() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_timers.clear();
+    m_counters.clear();
+}
+
+libclang_vim::stats_store& libclang_vim::get_stats_store() {
+    // Deliberately leaked, see get_thread_pool().
+    static stats_store& store = *new stats_store;
+    return store;
+}
+
+libclang_vim::scoped_timer::scoped_timer(const char* name)
+    : m_name(name), m_start(std::chrono::steady_clock::now()) {}
+
+libclang_vim::scoped_timer::~scoped_timer() { stop(); }
+
+void libclang_vim::scoped_timer::stop() {
+    if (!m_name)
+        return;
+
+    const auto elapsed = std::chrono::steady_clock::now() - m_start;
+    tracer& trace = get_tracer();
+    if (trace.is_enabled())
+        trace.add_span(m_name, m_start, elapsed);
+    get_stats_store().record(
+        m_name,
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed)
+            .count());
+    m_name = nullptr;
+}
+
+void libclang_vim::count_event(const char* name) {
+    get_stats_store().count(name);
+}
+
+const char* libclang_vim::get_stats() {
+    static std::string vimson;
+    vimson = get_stats_store().get_vimson();
+    return vimson.c_str();
+}
+
+const char* libclang_vim::reset_stats() {
+    get_stats_store().reset();
+    return "{'ok':1}";
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
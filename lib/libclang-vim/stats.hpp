@@ -0,0 +1,75 @@
+#if !defined LIBCLANG_VIM_STATS_HPP_INCLUDED
+#define LIBCLANG_VIM_STATS_HPP_INCLUDED
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace libclang_vim {
+
+/// Counters and latencies of the work done by the library, per entry point
+/// and per phase of the bigger requests.
+class stats_store {
+    struct timer {
+        std::uint64_t count = 0;
+        std::uint64_t total = 0;
+        std::uint64_t max = 0;
+        /// The most recent samples, as a ring buffer.
+        std::vector<std::uint64_t> samples;
+        std::size_t next = 0;
+    };
+
+    std::map<std::string, timer> m_timers;
+    std::map<std::string, std::uint64_t> m_counters;
+    mutable std::mutex m_mutex;
+
+  public:
+    stats_store();
+
+    /// Adds a latency sample of name, in microseconds.
+    void record(const std::string& name, std::uint64_t microseconds);
+
+    /// Increments the counter name.
+    void count(const std::string& name);
+
+    /// Describes the latencies, the counters and the hit rates of the caches,
+    /// i.e. of the "<cache>.hits" and "<cache>.misses" counters.
+    std::string get_vimson() const;
+
+    void reset();
+};
+
+stats_store& get_stats_store();
+
+/// Records the time until stop() or its destruction as a sample of name, and
+/// as a span of the trace if tracing.
+class scoped_timer {
+    const char* m_name;
+    std::chrono::steady_clock::time_point m_start;
+
+  public:
+    explicit scoped_timer(const char* name);
+    scoped_timer(const scoped_timer&) = delete;
+    scoped_timer& operator=(const scoped_timer&) = delete;
+    ~scoped_timer();
+
+    void stop();
+};
+
+/// Shorthand for get_stats_store().count().
+void count_event(const char* name);
+
+/// Describe the counters and latencies collected so far.
+const char* get_stats();
+
+/// Forget the counters and latencies collected so far.
+const char* reset_stats();
+
+} // namespace libclang_vim
+
+#endif // LIBCLANG_VIM_STATS_HPP_INCLUDED
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
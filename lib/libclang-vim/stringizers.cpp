@@ -213,4 +213,65 @@ std::string libclang_vim::stringize_extent(CXCursor const& cursor) {
            "},'end':{" + stringize_location(clang_getRangeEnd(r)) + "}";
 }
 
+std::string libclang_vim::stringize_diagnostics(
+    CXTranslationUnit const& translation_unit) {
+    std::string result;
+    unsigned num_diagnostics = clang_getNumDiagnostics(translation_unit);
+    for (unsigned i = 0; i < num_diagnostics; ++i) {
+        CXDiagnostic diagnostic = clang_getDiagnostic(translation_unit, i);
+        if (diagnostic) {
+            std::string severity;
+            switch (clang_getDiagnosticSeverity(diagnostic)) {
+            case CXDiagnostic_Ignored:
+                severity = "ignored";
+                break;
+            case CXDiagnostic_Note:
+                severity = "note";
+                break;
+            case CXDiagnostic_Warning:
+                severity = "warning";
+                break;
+            case CXDiagnostic_Error:
+                severity = "error";
+                break;
+            case CXDiagnostic_Fatal:
+                severity = "fatal";
+                break;
+            }
+            result += "{'severity': '" + severity + "', ";
+
+            CXSourceLocation location = clang_getDiagnosticLocation(diagnostic);
+            result += stringize_location(location) + "}, ";
+        }
+        clang_disposeDiagnostic(diagnostic);
+    }
+    return result;
+}
+
+std::string libclang_vim::stringize_string(const std::string& text) {
+    std::string result = "\"";
+    for (const char character : text) {
+        switch (character) {
+        case '"':
+        case '\\':
+            result += '\\';
+            result += character;
+            break;
+        case '\n':
+            result += "\\n";
+            break;
+        case '\r':
+            result += "\\r";
+            break;
+        case '\t':
+            result += "\\t";
+            break;
+        default:
+            result += character;
+            break;
+        }
+    }
+    return result + "\"";
+}
+
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
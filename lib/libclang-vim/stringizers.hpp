@@ -39,6 +39,12 @@ std::string stringize_range(CXSourceRange const& range);
 
 std::string stringize_extent(CXCursor const& cursor);
 
+/// Double-quoted Vim string of text, which may span lines.
+std::string stringize_string(const std::string& text);
+
+/// List items describing the diagnostics of translation_unit.
+std::string stringize_diagnostics(CXTranslationUnit const& translation_unit);
+
 } // namespace libclang_vim
 
 #endif // LIBCLANG_VIM_STRINGIZERS_HPP_INCLUDED
@@ -0,0 +1,783 @@
+#include "symbol_index.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+#include "index_shard.hpp"
+#include "options.hpp"
+#include "symbol_search.hpp"
+#include "thread_pool.hpp"
+#include "translation_unit_cache.hpp"
+
+namespace {
+
+/// Class to avoid the need to call clang_IndexAction_dispose() manually.
+class cxindex_action_ptr {
+    CXIndexAction m_action;
+
+  public:
+    explicit cxindex_action_ptr(CXIndex index)
+        : m_action(clang_IndexAction_create(index)) {}
+    cxindex_action_ptr(const cxindex_action_ptr&) = delete;
+    cxindex_action_ptr& operator=(const cxindex_action_ptr&) = delete;
+    ~cxindex_action_ptr() { clang_IndexAction_dispose(m_action); }
+
+    operator CXIndexAction() const { return m_action; }
+};
+
+/// Collects the symbols while indexing a single file.
+class index_data {
+  public:
+    libclang_vim::indexed_unit unit;
+    /// Avoids a clang_getFileName() call for each occurrence.
+    std::map<CXFile, std::string> file_names;
+    /// Headers are included multiple times, but are one dependency.
+    std::set<CXFile> dependencies;
+
+    void add_dependency(CXFile file) {
+        if (dependencies.insert(file).second)
+            unit.dependencies.push_back(get_file_name(file));
+    }
+
+    const std::string& get_file_name(CXFile file) {
+        auto it = file_names.find(file);
+        if (it == file_names.end()) {
+            libclang_vim::cxstring_ptr file_name = clang_getFileName(file);
+            it = file_names.emplace(file, clang_getCString(file_name)).first;
+        }
+        return it->second;
+    }
+};
+
+CXIdxClientFile entered_main_file(CXClientData client_data, CXFile file,
+                                  void*) {
+    static_cast<index_data*>(client_data)->add_dependency(file);
+    return nullptr;
+}
+
+CXIdxClientFile included_file(CXClientData client_data,
+                              const CXIdxIncludedFileInfo* info) {
+    if (info->file)
+        static_cast<index_data*>(client_data)->add_dependency(info->file);
+    return nullptr;
+}
+
+void add_occurrence(index_data& data, const CXIdxEntityInfo& entity,
+                    CXIdxLoc loc, libclang_vim::symbol_role role,
+                    const char* caller = nullptr) {
+    if (!entity.USR || !*entity.USR)
+        return;
+
+    CXFile file;
+    unsigned line, column, offset;
+    clang_indexLoc_getFileLocation(loc, nullptr, &file, &line, &column,
+                                   &offset);
+    if (!file)
+        return;
+
+    libclang_vim::symbol_info& symbol = data.unit.symbols[entity.USR];
+    if (entity.name)
+        symbol.name = entity.name;
+    symbol.kind = entity.kind;
+
+    libclang_vim::symbol_occurrence occurrence;
+    occurrence.usr = entity.USR;
+    occurrence.file = data.get_file_name(file);
+    occurrence.line = line;
+    occurrence.column = column;
+    occurrence.offset = offset;
+    occurrence.role = role;
+    if (caller)
+        occurrence.caller = caller;
+    data.unit.occurrences.push_back(std::move(occurrence));
+}
+
+std::string get_qualified_name(CXCursor cursor) {
+    std::string name;
+    for (; !clang_Cursor_isNull(cursor) &&
+           !clang_isInvalid(clang_getCursorKind(cursor)) &&
+           clang_getCursorKind(cursor) != CXCursor_TranslationUnit;
+         cursor = clang_getCursorSemanticParent(cursor)) {
+        libclang_vim::cxstring_ptr spelling = clang_getCursorSpelling(cursor);
+        const char* part = clang_getCString(spelling);
+        name = std::string(*part ? part : "(anonymous)") +
+               (name.empty() ? "" : "::") + name;
+    }
+    return name;
+}
+
+void index_declaration(CXClientData client_data, const CXIdxDeclInfo* info) {
+    if (!info->entityInfo)
+        return;
+
+    auto& data = *static_cast<index_data*>(client_data);
+    add_occurrence(data, *info->entityInfo, info->loc,
+                   info->isDefinition ? libclang_vim::symbol_definition
+                                      : libclang_vim::symbol_declaration);
+
+    const char* usr = info->entityInfo->USR;
+    if (!usr || !*usr)
+        return;
+
+    libclang_vim::symbol_info& symbol = data.unit.symbols[usr];
+    if (symbol.qualified_name.empty())
+        symbol.qualified_name = get_qualified_name(info->cursor);
+
+    if (const CXIdxCXXClassDeclInfo* class_info =
+            clang_index_getCXXClassDeclInfo(info)) {
+        for (unsigned i = 0; i < class_info->numBases; ++i) {
+            const CXIdxEntityInfo* base = class_info->bases[i]->base;
+            if (base && base->USR && *base->USR)
+                data.unit.bases.emplace(usr, base->USR);
+        }
+    }
+
+    if (info->entityInfo->kind == CXIdxEntity_CXXInstanceMethod ||
+        info->entityInfo->kind == CXIdxEntity_CXXDestructor) {
+        CXCursor* overridden = nullptr;
+        unsigned overridden_count = 0;
+        clang_getOverriddenCursors(info->cursor, &overridden,
+                                   &overridden_count);
+        for (unsigned i = 0; i < overridden_count; ++i) {
+            libclang_vim::cxstring_ptr overridden_usr =
+                clang_getCursorUSR(overridden[i]);
+            if (*clang_getCString(overridden_usr))
+                data.unit.overrides.emplace(usr,
+                                            clang_getCString(overridden_usr));
+        }
+        clang_disposeOverriddenCursors(overridden);
+    }
+}
+
+void index_entity_reference(CXClientData client_data,
+                            const CXIdxEntityRefInfo* info) {
+    if (!info->referencedEntity)
+        return;
+
+    const char* caller = nullptr;
+    if ((info->role & CXSymbolRole_Call) && info->parentEntity &&
+        info->parentEntity->USR && *info->parentEntity->USR)
+        caller = info->parentEntity->USR;
+    add_occurrence(*static_cast<index_data*>(client_data),
+                   *info->referencedEntity, info->loc,
+                   libclang_vim::symbol_reference, caller);
+}
+
+/// Decrements the count of the edge from -> to in lists.
+void remove_edge(std::map<std::string, std::map<std::string, unsigned>>& lists,
+                 const std::string& from, const std::string& to) {
+    auto list = lists.find(from);
+    if (list == lists.end())
+        return;
+
+    auto count = list->second.find(to);
+    if (count != list->second.end() && --count->second == 0)
+        list->second.erase(count);
+    if (list->second.empty())
+        lists.erase(list);
+}
+
+/// Forgets the occurrences of usr in file.
+void remove_positions(
+    std::unordered_map<std::uint32_t, libclang_vim::occurrence_positions>&
+        index,
+    std::uint32_t usr, std::uint32_t file) {
+    auto it = index.find(usr);
+    if (it == index.end())
+        return;
+
+    it->second.erase(file);
+    if (it->second.empty())
+        index.erase(it);
+}
+
+bool pooled_less(const libclang_vim::pooled_occurrence& lhs,
+                 const libclang_vim::pooled_occurrence& rhs) {
+    return std::tie(lhs.offset, lhs.usr, lhs.role, lhs.caller) <
+           std::tie(rhs.offset, rhs.usr, rhs.role, rhs.caller);
+}
+
+bool pooled_equal(const libclang_vim::pooled_occurrence& lhs,
+                  const libclang_vim::pooled_occurrence& rhs) {
+    return std::tie(lhs.offset, lhs.usr, lhs.role, lhs.caller) ==
+           std::tie(rhs.offset, rhs.usr, rhs.role, rhs.caller);
+}
+
+libclang_vim::indexed_unit
+index_file(const libclang_vim::location_tuple& info) {
+    // Each worker has its own index and indexing session.
+    thread_local libclang_vim::cxindex_ptr index(
+        clang_createIndex(/*excludeDeclsFromPCH*/ 1, /*displayDiagnostics*/ 0));
+    thread_local cxindex_action_ptr action(index);
+
+    IndexerCallbacks callbacks{};
+    callbacks.enteredMainFile = entered_main_file;
+    callbacks.ppIncludedFile = included_file;
+    callbacks.indexDeclaration = index_declaration;
+    callbacks.indexEntityReference = index_entity_reference;
+
+    index_data data;
+    auto const args_ptrs = libclang_vim::get_args_ptrs(info.args);
+    std::vector<CXUnsavedFile> unsaved_files =
+        libclang_vim::create_unsaved_files(info);
+    clang_indexSourceFile(action, &data, &callbacks, sizeof(callbacks),
+                          CXIndexOpt_SuppressWarnings, info.file.c_str(),
+                          args_ptrs.data(), args_ptrs.size(),
+                          unsaved_files.data(), unsaved_files.size(),
+                          /*out_TU*/ nullptr, CXTranslationUnit_Incomplete);
+    return std::move(data.unit);
+}
+
+}
+
+const char* libclang_vim::stringize_role(symbol_role role) {
+    switch (role) {
+    case symbol_declaration:
+        return "declaration";
+    case symbol_definition:
+        return "definition";
+    case symbol_reference:
+        break;
+    }
+    return "reference";
+}
+
+const char* libclang_vim::stringize_entity_kind(CXIdxEntityKind kind) {
+    switch (kind) {
+    case CXIdxEntity_Typedef:
+        return "typedef";
+    case CXIdxEntity_Function:
+        return "function";
+    case CXIdxEntity_Variable:
+        return "variable";
+    case CXIdxEntity_Field:
+        return "field";
+    case CXIdxEntity_EnumConstant:
+        return "enum_constant";
+    case CXIdxEntity_Enum:
+        return "enum";
+    case CXIdxEntity_Struct:
+        return "struct";
+    case CXIdxEntity_Union:
+        return "union";
+    case CXIdxEntity_CXXClass:
+        return "class";
+    case CXIdxEntity_CXXNamespace:
+        return "namespace";
+    case CXIdxEntity_CXXNamespaceAlias:
+        return "namespace_alias";
+    case CXIdxEntity_CXXStaticVariable:
+        return "static_variable";
+    case CXIdxEntity_CXXStaticMethod:
+        return "static_method";
+    case CXIdxEntity_CXXInstanceMethod:
+        return "method";
+    case CXIdxEntity_CXXConstructor:
+        return "constructor";
+    case CXIdxEntity_CXXDestructor:
+        return "destructor";
+    case CXIdxEntity_CXXConversionFunction:
+        return "conversion_function";
+    default:
+        return "unexposed";
+    }
+}
+
+void libclang_vim::symbol_graph::add(
+    const std::set<std::pair<std::string, std::string>>& edges) {
+    for (const auto& edge : edges) {
+        ++m_targets[edge.first][edge.second];
+        ++m_sources[edge.second][edge.first];
+    }
+}
+
+void libclang_vim::symbol_graph::remove(
+    const std::set<std::pair<std::string, std::string>>& edges) {
+    for (const auto& edge : edges) {
+        remove_edge(m_targets, edge.first, edge.second);
+        remove_edge(m_sources, edge.second, edge.first);
+    }
+}
+
+std::vector<std::string>
+libclang_vim::symbol_graph::get_targets(const std::string& usr) const {
+    std::vector<std::string> targets;
+    auto list = m_targets.find(usr);
+    if (list != m_targets.end()) {
+        for (const auto& target : list->second)
+            targets.push_back(target.first);
+    }
+    return targets;
+}
+
+std::vector<std::string>
+libclang_vim::symbol_graph::get_sources(const std::string& usr) const {
+    std::vector<std::string> sources;
+    auto list = m_sources.find(usr);
+    if (list != m_sources.end()) {
+        for (const auto& source : list->second)
+            sources.push_back(source.first);
+    }
+    return sources;
+}
+
+libclang_vim::string_pool::string_pool() { intern(std::string()); }
+
+std::uint32_t libclang_vim::string_pool::intern(const std::string& string) {
+    auto inserted = m_ids.emplace(string, m_strings.size());
+    if (inserted.second)
+        m_strings.push_back(&inserted.first->first);
+    return inserted.first->second;
+}
+
+std::uint32_t
+libclang_vim::string_pool::find(const std::string& string) const {
+    auto it = m_ids.find(string);
+    if (it == m_ids.end())
+        return -1;
+    return it->second;
+}
+
+const std::string& libclang_vim::string_pool::get(std::uint32_t id) const {
+    return *m_strings[id];
+}
+
+void libclang_vim::symbol_index::set_occurrences(
+    std::uint32_t file, std::vector<pooled_occurrence> occurrences) {
+    file_occurrences& stored = m_files[file];
+    for (const auto& occurrence : stored.occurrences) {
+        remove_positions(m_usr_occurrences, occurrence.usr, file);
+        if (occurrence.caller)
+            remove_positions(m_calls, occurrence.caller, file);
+    }
+    m_occurrence_count -= stored.occurrences.size();
+
+    stored.occurrences = std::move(occurrences);
+    for (std::size_t i = 0; i < stored.occurrences.size(); ++i) {
+        const pooled_occurrence& occurrence = stored.occurrences[i];
+        m_usr_occurrences[occurrence.usr][file].push_back(i);
+        if (occurrence.caller)
+            m_calls[occurrence.caller][file].push_back(i);
+    }
+    m_occurrence_count += stored.occurrences.size();
+}
+
+void libclang_vim::symbol_index::release_file(std::uint32_t file,
+                                              std::uint32_t unit) {
+    auto it = m_files.find(file);
+    if (it == m_files.end())
+        return;
+
+    it->second.units.erase(unit);
+    if (!it->second.units.empty())
+        return;
+
+    set_occurrences(file, std::vector<pooled_occurrence>());
+    m_files.erase(file);
+}
+
+libclang_vim::symbol_occurrence libclang_vim::symbol_index::make_occurrence(
+    std::uint32_t file, const pooled_occurrence& pooled) const {
+    symbol_occurrence occurrence;
+    occurrence.usr = m_strings.get(pooled.usr);
+    occurrence.file = m_strings.get(file);
+    occurrence.line = pooled.line;
+    occurrence.column = pooled.column;
+    occurrence.offset = pooled.offset;
+    occurrence.role = pooled.role;
+    occurrence.caller = m_strings.get(pooled.caller);
+    return occurrence;
+}
+
+void libclang_vim::symbol_index::replace(const std::string& unit,
+                                         const indexed_unit& data) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const std::uint32_t unit_id = m_strings.intern(unit);
+    unit_entry& stored = m_units[unit_id];
+    for (const auto usr : stored.usrs) {
+        auto it = m_usr_units.find(usr);
+        if (it == m_usr_units.end())
+            continue;
+
+        it->second.erase(unit_id);
+        if (it->second.empty()) {
+            m_usr_units.erase(it);
+            m_symbols.erase(usr);
+        }
+    }
+    for (const auto file : stored.files)
+        release_file(file, unit_id);
+    m_bases.remove(stored.bases);
+    m_overrides.remove(stored.overrides);
+
+    stored = unit_entry();
+    for (const auto& symbol : data.symbols) {
+        const std::uint32_t usr = m_strings.intern(symbol.first);
+        stored.usrs.push_back(usr);
+        m_usr_units[usr].insert(unit_id);
+
+        auto known = m_symbols.emplace(usr, symbol.second).first;
+        if (known->second.qualified_name.empty())
+            known->second = symbol.second;
+    }
+
+    std::map<std::uint32_t, std::vector<pooled_occurrence>> by_file;
+    for (const auto& dependency : data.dependencies)
+        by_file[m_strings.intern(dependency)];
+    for (const auto& occurrence : data.occurrences) {
+        pooled_occurrence pooled{m_strings.intern(occurrence.usr),
+                                 occurrence.line,
+                                 occurrence.column,
+                                 occurrence.offset,
+                                 occurrence.role,
+                                 m_strings.intern(occurrence.caller)};
+        by_file[m_strings.intern(occurrence.file)].push_back(pooled);
+    }
+    for (auto& file : by_file) {
+        std::vector<pooled_occurrence>& occurrences = file.second;
+        std::sort(occurrences.begin(), occurrences.end(), pooled_less);
+        occurrences.erase(std::unique(occurrences.begin(), occurrences.end(),
+                                      pooled_equal),
+                          occurrences.end());
+
+        stored.files.push_back(file.first);
+        m_files[file.first].units.insert(unit_id);
+        set_occurrences(file.first, std::move(occurrences));
+    }
+
+    stored.bases = data.bases;
+    stored.overrides = data.overrides;
+    m_bases.add(stored.bases);
+    m_overrides.add(stored.overrides);
+    ++m_generation;
+}
+
+std::vector<libclang_vim::symbol_occurrence>
+libclang_vim::symbol_index::find(const std::string& usr,
+                                 unsigned roles) const {
+    std::vector<symbol_occurrence> found;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto positions = m_usr_occurrences.find(m_strings.find(usr));
+    if (positions == m_usr_occurrences.end())
+        return found;
+
+    for (const auto& file : positions->second) {
+        const file_occurrences& stored = m_files.at(file.first);
+        for (const auto position : file.second) {
+            const pooled_occurrence& occurrence = stored.occurrences[position];
+            if (occurrence.role & roles)
+                found.push_back(make_occurrence(file.first, occurrence));
+        }
+    }
+    return found;
+}
+
+std::size_t libclang_vim::symbol_index::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_occurrence_count;
+}
+
+std::set<std::string>
+libclang_vim::symbol_index::get_units(const std::string& usr) const {
+    std::set<std::string> units;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_usr_units.find(m_strings.find(usr));
+    if (it == m_usr_units.end())
+        return units;
+
+    for (const auto unit : it->second)
+        units.insert(m_strings.get(unit));
+    return units;
+}
+
+std::string libclang_vim::symbol_index::get_name(const std::string& usr) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_symbols.find(m_strings.find(usr));
+    if (it == m_symbols.end())
+        return std::string();
+    return it->second.name;
+}
+
+libclang_vim::symbol_info
+libclang_vim::symbol_index::get_symbol(const std::string& usr) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_symbols.find(m_strings.find(usr));
+    if (it == m_symbols.end())
+        return symbol_info();
+    return it->second;
+}
+
+std::vector<libclang_vim::symbol_occurrence>
+libclang_vim::symbol_index::find_calls_from(const std::string& caller) const {
+    std::vector<symbol_occurrence> found;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto positions = m_calls.find(m_strings.find(caller));
+    if (positions == m_calls.end())
+        return found;
+
+    for (const auto& file : positions->second) {
+        const file_occurrences& stored = m_files.at(file.first);
+        for (const auto position : file.second)
+            found.push_back(
+                make_occurrence(file.first, stored.occurrences[position]));
+    }
+    return found;
+}
+
+std::vector<std::string>
+libclang_vim::symbol_index::get_bases(const std::string& usr) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bases.get_targets(usr);
+}
+
+std::vector<std::string>
+libclang_vim::symbol_index::get_derived(const std::string& usr) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bases.get_sources(usr);
+}
+
+std::vector<std::string>
+libclang_vim::symbol_index::get_overriders(const std::string& usr) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_overrides.get_sources(usr);
+}
+
+std::uint64_t libclang_vim::symbol_index::generation() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_generation;
+}
+
+bool libclang_vim::symbol_index::find_location(std::uint32_t usr,
+                                               symbol_role role,
+                                               indexed_symbol& symbol) const {
+    auto positions = m_usr_occurrences.find(usr);
+    if (positions == m_usr_occurrences.end())
+        return false;
+
+    for (const auto& file : positions->second) {
+        const file_occurrences& stored = m_files.at(file.first);
+        for (const auto position : file.second) {
+            const pooled_occurrence& occurrence = stored.occurrences[position];
+            if (occurrence.role != role)
+                continue;
+
+            symbol.file = m_strings.get(file.first);
+            symbol.line = occurrence.line;
+            symbol.column = occurrence.column;
+            symbol.offset = occurrence.offset;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<libclang_vim::indexed_symbol>
+libclang_vim::symbol_index::get_symbols() const {
+    std::vector<indexed_symbol> symbols;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    symbols.reserve(m_symbols.size());
+    for (const auto& symbol : m_symbols) {
+        if (symbol.second.qualified_name.empty())
+            continue;
+
+        symbols.emplace_back();
+        indexed_symbol& found = symbols.back();
+        found.usr = m_strings.get(symbol.first);
+        found.info = symbol.second;
+        if (!find_location(symbol.first, symbol_definition, found))
+            find_location(symbol.first, symbol_declaration, found);
+    }
+    return symbols;
+}
+
+libclang_vim::symbol_index& libclang_vim::get_symbol_index() {
+    // Deliberately leaked, see get_thread_pool().
+    static symbol_index& index = *new symbol_index;
+    return index;
+}
+
+bool libclang_vim::indexer::is_current(std::uint64_t generation) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return generation == m_generation;
+}
+
+bool libclang_vim::indexer::replaced(std::uint64_t generation) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return generation == m_generation && ++m_replaced == m_total;
+}
+
+void libclang_vim::indexer::finish(std::uint64_t generation, bool loaded) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (generation != m_generation)
+        return;
+
+    ++m_done;
+    if (loaded)
+        ++m_loaded;
+}
+
+bool libclang_vim::indexer::start(const std::vector<location_tuple>& files) {
+    std::uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_done < m_total)
+            return false;
+
+        generation = ++m_generation;
+        m_total = files.size();
+        m_done = 0;
+        m_loaded = 0;
+        m_replaced = 0;
+    }
+
+    const std::string cache_directory = get_option("cache_directory");
+    thread_pool& pool = get_thread_pool();
+    for (const auto& file : files) {
+        pool.post(
+            [this, generation, file, cache_directory] {
+                if (!is_current(generation))
+                    return;
+
+                indexed_unit data;
+                const bool loaded =
+                    !cache_directory.empty() &&
+                    load_index_shard(cache_directory, file, data);
+                if (!loaded) {
+                    data = index_file(file);
+                    if (!cache_directory.empty())
+                        save_index_shard(cache_directory, file, data);
+                }
+                get_symbol_index().replace(file.file, data);
+                // Workspace symbols are up to date when the run is done.
+                if (replaced(generation))
+                    get_symbol_search().update();
+                else
+                    get_symbol_search().post_update();
+                finish(generation, loaded);
+            },
+            task_priority::background);
+    }
+    return true;
+}
+
+void libclang_vim::indexer::cancel() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_generation;
+    m_total = m_done;
+}
+
+std::string libclang_vim::indexer::poll() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return "{'done':" + std::to_string(m_done) + ",'total':" +
+           std::to_string(m_total) + ",'loaded':" +
+           std::to_string(m_loaded) + ",'occurrences':" +
+           std::to_string(get_symbol_index().size()) + "}";
+}
+
+libclang_vim::indexer& libclang_vim::get_indexer() {
+    // Deliberately leaked, see get_thread_pool().
+    static indexer& instance = *new indexer;
+    return instance;
+}
+
+const char* libclang_vim::start_indexing(const std::string& request) {
+    static std::string vimson;
+
+    std::vector<location_tuple> files = parse_file_list(request);
+    if (!get_indexer().start(files))
+        return "{}";
+
+    vimson = "{'total':" + std::to_string(files.size()) + "}";
+    return vimson.c_str();
+}
+
+const char* libclang_vim::poll_indexing() {
+    static std::string vimson;
+    vimson = get_indexer().poll();
+    return vimson.c_str();
+}
+
+const char* libclang_vim::cancel_indexing() {
+    get_indexer().cancel();
+    return "{}";
+}
+
+std::string libclang_vim::stringize_indexed_symbol(const std::string& usr) {
+    const symbol_info symbol = get_symbol_index().get_symbol(usr);
+    std::string vimson =
+        "'name':'" +
+        (symbol.qualified_name.empty() ? symbol.name : symbol.qualified_name) +
+        "','kind':'" + stringize_entity_kind(symbol.kind) + "','usr':'" + usr +
+        "'";
+    std::vector<symbol_occurrence> occurrences =
+        get_symbol_index().find(usr, symbol_definition);
+    if (occurrences.empty())
+        occurrences = get_symbol_index().find(usr, symbol_declaration);
+    if (!occurrences.empty()) {
+        const symbol_occurrence& occurrence = occurrences.front();
+        vimson += ",'line':" + std::to_string(occurrence.line) +
+                  ",'column':" + std::to_string(occurrence.column) +
+                  ",'offset':" + std::to_string(occurrence.offset) +
+                  ",'file':'" + occurrence.file + "'";
+    }
+    return vimson;
+}
+
+std::string libclang_vim::get_usr_at(const location_tuple& location_info) {
+    if (location_info.file.empty())
+        return std::string();
+
+    // The unit of the edited file is usually cached already, so this is
+    // cheap, and unlike the index, it's up to date with the buffer.
+    cached_translation_unit_ptr translation_unit =
+        parse_translation_unit_at(location_info,
+                                  CXTranslationUnit_Incomplete);
+    if (!translation_unit)
+        return std::string();
+
+    CXFile file = clang_getFile(translation_unit, location_info.file.c_str());
+    CXSourceLocation location = clang_getLocation(
+        translation_unit, file, location_info.line, location_info.col);
+    CXCursor cursor = clang_getCursor(translation_unit, location);
+    CXCursor referenced = clang_getCursorReferenced(cursor);
+    if (clang_Cursor_isNull(referenced))
+        referenced = cursor;
+    cxstring_ptr usr = clang_getCursorUSR(referenced);
+    return clang_getCString(usr);
+}
+
+std::string libclang_vim::get_usr_of_request(
+    const std::string& request,
+    const std::function<std::string(const location_tuple&)>& get_usr) {
+    // USRs of C and C++ symbols start with "c:", anything else is a location.
+    if (request.compare(0, 2, "c:") == 0)
+        return request;
+    return get_usr(parse_args_with_location(request));
+}
+
+const char*
+libclang_vim::get_indexed_occurrences_at(const location_tuple& location_info,
+                                         unsigned roles) {
+    static std::string vimson;
+
+    const std::string usr = get_usr_at(location_info);
+    if (usr.empty())
+        return "[]";
+
+    std::stringstream ss;
+    ss << "[";
+    for (const auto& occurrence : get_symbol_index().find(usr, roles)) {
+        ss << "{'line':" << occurrence.line
+           << ",'column':" << occurrence.column
+           << ",'offset':" << occurrence.offset << ",'file':'"
+           << occurrence.file << "','role':'" << stringize_role(occurrence.role)
+           << "'},";
+    }
+    ss << "]";
+    vimson = ss.str();
+    return vimson.c_str();
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
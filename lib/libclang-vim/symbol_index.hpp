@@ -0,0 +1,300 @@
+#if !defined LIBCLANG_VIM_SYMBOL_INDEX_HPP_INCLUDED
+#define LIBCLANG_VIM_SYMBOL_INDEX_HPP_INCLUDED
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <clang-c/Index.h>
+
+#include "helpers.hpp"
+
+namespace libclang_vim {
+
+/// How a symbol occurs at a location, usable as a mask.
+enum symbol_role : unsigned {
+    symbol_declaration = 1,
+    symbol_definition = 2,
+    symbol_reference = 4,
+};
+
+/// A declaration, definition or reference of the symbol identified by usr.
+class symbol_occurrence {
+  public:
+    std::string usr;
+    std::string file;
+    unsigned line = 0;
+    unsigned column = 0;
+    unsigned offset = 0;
+    symbol_role role = symbol_reference;
+    /// USR of the calling function if the occurrence is a call.
+    std::string caller;
+};
+
+/// Returns the name of role, as used in the results.
+const char* stringize_role(symbol_role role);
+
+/// Returns the name of kind, as used in the results.
+const char* stringize_entity_kind(CXIdxEntityKind kind);
+
+/// What the index knows about a symbol besides its occurrences.
+class symbol_info {
+  public:
+    std::string name;
+    /// Name with the enclosing namespaces and classes, known if the symbol
+    /// is declared in the indexed files.
+    std::string qualified_name;
+    CXIdxEntityKind kind = CXIdxEntity_Unexposed;
+};
+
+/// A declared symbol with the location of its definition, or else of a
+/// declaration.
+class indexed_symbol {
+  public:
+    std::string usr;
+    symbol_info info;
+    /// Empty if the symbol has no indexed definition or declaration.
+    std::string file;
+    unsigned line = 0;
+    unsigned column = 0;
+    unsigned offset = 0;
+};
+
+/// Everything found while indexing a main file, including its headers.
+class indexed_unit {
+  public:
+    /// Symbols by USR.
+    std::map<std::string, symbol_info> symbols;
+    std::vector<symbol_occurrence> occurrences;
+    /// The main file and the files it includes.
+    std::vector<std::string> dependencies;
+    /// Derived and base class USRs.
+    std::set<std::pair<std::string, std::string>> bases;
+    /// Overriding and overridden method USRs.
+    std::set<std::pair<std::string, std::string>> overrides;
+};
+
+/// Edges between USRs as adjacency lists in both directions. Each edge counts
+/// the units it was found in, as headers are seen by many units.
+class symbol_graph {
+    std::map<std::string, std::map<std::string, unsigned>> m_targets;
+    std::map<std::string, std::map<std::string, unsigned>> m_sources;
+
+  public:
+    void add(const std::set<std::pair<std::string, std::string>>& edges);
+
+    void remove(const std::set<std::pair<std::string, std::string>>& edges);
+
+    /// Returns the USRs usr has an edge to, e.g. the bases of a class.
+    std::vector<std::string> get_targets(const std::string& usr) const;
+
+    /// Returns the USRs having an edge to usr, e.g. the derived classes.
+    std::vector<std::string> get_sources(const std::string& usr) const;
+};
+
+/// Stores each distinct string once and refers to it by a number. Strings are
+/// never removed: USRs and file names mostly come back when units are
+/// indexed again.
+class string_pool {
+    std::vector<const std::string*> m_strings;
+    std::unordered_map<std::string, std::uint32_t> m_ids;
+
+  public:
+    /// The empty string is always 0.
+    string_pool();
+
+    std::uint32_t intern(const std::string& string);
+
+    /// Returns the number of string, or -1 if it was never interned.
+    std::uint32_t find(const std::string& string) const;
+
+    const std::string& get(std::uint32_t id) const;
+};
+
+/// A symbol_occurrence in the index, with its file implied and its strings
+/// interned.
+class pooled_occurrence {
+  public:
+    std::uint32_t usr;
+    unsigned line;
+    unsigned column;
+    unsigned offset;
+    symbol_role role;
+    /// 0 if the occurrence is not a call.
+    std::uint32_t caller;
+};
+
+/// The occurrences in a file, stored once, however many units include it.
+class file_occurrences {
+  public:
+    /// Sorted by offset, without duplicates.
+    std::vector<pooled_occurrence> occurrences;
+    /// Units depending on the file.
+    std::set<std::uint32_t> units;
+};
+
+/// What is remembered of a unit, so that its part of the index can be
+/// removed when it's replaced.
+class unit_entry {
+  public:
+    std::vector<std::uint32_t> usrs;
+    std::vector<std::uint32_t> files;
+    std::set<std::pair<std::string, std::string>> bases;
+    std::set<std::pair<std::string, std::string>> overrides;
+};
+
+/// Positions of occurrences in m_files, by file.
+using occurrence_positions =
+    std::map<std::uint32_t, std::vector<std::uint32_t>>;
+
+/// Occurrences of symbols in all indexed translation units, by USR.
+class symbol_index {
+    /// USRs, file and unit names.
+    string_pool m_strings;
+    std::unordered_map<std::uint32_t, unit_entry> m_units;
+    std::unordered_map<std::uint32_t, file_occurrences> m_files;
+    /// Occurrences of each USR.
+    std::unordered_map<std::uint32_t, occurrence_positions> m_usr_occurrences;
+    /// Calls made by each function.
+    std::unordered_map<std::uint32_t, occurrence_positions> m_calls;
+    /// Main files having occurrences of a USR.
+    std::unordered_map<std::uint32_t, std::set<std::uint32_t>> m_usr_units;
+    /// What is known of each USR, preferably from a unit declaring it.
+    std::unordered_map<std::uint32_t, symbol_info> m_symbols;
+    std::size_t m_occurrence_count = 0;
+    /// Derived classes to base classes.
+    symbol_graph m_bases;
+    /// Overriding methods to overridden ones.
+    symbol_graph m_overrides;
+    /// Incremented on each change.
+    std::uint64_t m_generation = 0;
+    mutable std::mutex m_mutex;
+
+    /// Stores the occurrences of file, replacing its earlier ones.
+    void set_occurrences(std::uint32_t file,
+                         std::vector<pooled_occurrence> occurrences);
+
+    /// Removes unit from the users of file, and the occurrences of file if
+    /// it was the last one.
+    void release_file(std::uint32_t file, std::uint32_t unit);
+
+    symbol_occurrence make_occurrence(std::uint32_t file,
+                                      const pooled_occurrence& pooled) const;
+
+    /// Copies the location of an occurrence of usr with role to symbol.
+    bool find_location(std::uint32_t usr, symbol_role role,
+                       indexed_symbol& symbol) const;
+
+  public:
+    /// Replaces the symbols and occurrences found in unit by data. The
+    /// occurrences in headers replace the ones found by other units: the
+    /// latest indexing of a header is as good as any.
+    void replace(const std::string& unit, const indexed_unit& data);
+
+    /// Returns the occurrences of usr whose role is in roles.
+    std::vector<symbol_occurrence> find(const std::string& usr,
+                                        unsigned roles) const;
+
+    /// Returns the main files having occurrences of usr.
+    std::set<std::string> get_units(const std::string& usr) const;
+
+    /// Returns the name of usr, or an empty string if it's not indexed.
+    std::string get_name(const std::string& usr) const;
+
+    /// Returns what is known about usr, preferably from a unit declaring it.
+    symbol_info get_symbol(const std::string& usr) const;
+
+    /// Returns the calls made by the function caller.
+    std::vector<symbol_occurrence>
+    find_calls_from(const std::string& caller) const;
+
+    /// Returns the direct base classes of usr.
+    std::vector<std::string> get_bases(const std::string& usr) const;
+
+    /// Returns the classes directly derived from usr.
+    std::vector<std::string> get_derived(const std::string& usr) const;
+
+    /// Returns the methods directly overriding usr.
+    std::vector<std::string> get_overriders(const std::string& usr) const;
+
+    /// Number of stored occurrences.
+    std::size_t size() const;
+
+    std::uint64_t generation() const;
+
+    /// Returns the declared symbols of all units, each USR once.
+    std::vector<indexed_symbol> get_symbols() const;
+};
+
+symbol_index& get_symbol_index();
+
+/// Indexes files on the thread pool with clang_indexSourceFile().
+class indexer {
+    std::size_t m_total = 0;
+    std::size_t m_done = 0;
+    /// Files whose up to date index was loaded from the cache directory.
+    std::size_t m_loaded = 0;
+    /// Files put in the symbol index, which is ahead of m_done.
+    std::size_t m_replaced = 0;
+    /// Incremented on each start(), so that tasks of an earlier run know
+    /// that they are obsolete.
+    std::uint64_t m_generation = 0;
+    std::mutex m_mutex;
+
+    bool is_current(std::uint64_t generation);
+
+    /// Returns if the file was the last one of the run to be put in the
+    /// symbol index.
+    bool replaced(std::uint64_t generation);
+
+    void finish(std::uint64_t generation, bool loaded);
+
+  public:
+    /// Fails if the previous run is still in progress.
+    bool start(const std::vector<location_tuple>& files);
+
+    void cancel();
+
+    /// Returns the progress, the number of files loaded from the cache
+    /// directory and the size of the index.
+    std::string poll();
+};
+
+indexer& get_indexer();
+
+/// Parse a file list (see parse_file_list()) and start indexing it.
+const char* start_indexing(const std::string& request);
+
+const char* poll_indexing();
+
+const char* cancel_indexing();
+
+/// Describes usr by its name, kind and the location of its definition, or
+/// else declaration, as the items of a dictionary.
+std::string stringize_indexed_symbol(const std::string& usr);
+
+/// Returns the USR of the symbol referenced or declared at location_info.
+std::string get_usr_at(const location_tuple& location_info);
+
+/// Returns request itself if it's a USR, or else looks up the USR at the
+/// location it describes with get_usr.
+std::string get_usr_of_request(
+    const std::string& request,
+    const std::function<std::string(const location_tuple&)>& get_usr =
+        get_usr_at);
+
+/// Looks up the occurrences of the symbol at location_info in the index.
+const char* get_indexed_occurrences_at(const location_tuple& location_info,
+                                       unsigned roles);
+
+} // namespace libclang_vim
+
+#endif // LIBCLANG_VIM_SYMBOL_INDEX_HPP_INCLUDED
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,332 @@
+#include "symbol_search.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#include "thread_pool.hpp"
+
+namespace {
+
+/// Number of results when the request does not tell.
+const std::size_t default_search_limit = 50;
+
+/// Scores of the different kinds of matches.
+const unsigned fuzzy_match_score = 1000;
+const unsigned substring_match_score = 2000;
+
+std::uint32_t make_trigram(const char* text) {
+    return static_cast<std::uint32_t>(static_cast<unsigned char>(text[0]))
+               << 16 |
+           static_cast<std::uint32_t>(static_cast<unsigned char>(text[1]))
+               << 8 |
+           static_cast<unsigned char>(text[2]);
+}
+
+/// Set of the characters of text, approximated to one bit per letter and
+/// digit.
+std::uint64_t make_character_mask(const std::string& text) {
+    std::uint64_t mask = 0;
+    for (const char character : text) {
+        if (character >= 'a' && character <= 'z')
+            mask |= std::uint64_t(1) << (character - 'a');
+        else if (character >= '0' && character <= '9')
+            mask |= std::uint64_t(1) << (26 + character - '0');
+        else
+            mask |= std::uint64_t(1) << 36;
+    }
+    return mask;
+}
+
+std::size_t find_substring(const char* text, std::size_t size,
+                           const std::string& pattern) {
+    if (pattern.size() > size)
+        return std::string::npos;
+
+    const char* last = text + size - pattern.size();
+    for (const char* position = text; position <= last; ++position) {
+        const void* found =
+            std::memchr(position, pattern[0], last - position + 1);
+        if (!found)
+            break;
+
+        position = static_cast<const char*>(found);
+        if (std::memcmp(position, pattern.data(), pattern.size()) == 0)
+            return position - text;
+    }
+    return std::string::npos;
+}
+
+std::string fold_case(const std::string& text) {
+    std::string folded(text);
+    for (auto& character : folded)
+        character = std::tolower(static_cast<unsigned char>(character));
+    return folded;
+}
+}
+
+libclang_vim::symbol_match::symbol_match(std::uint32_t symbol, unsigned score)
+    : symbol(symbol), score(score) {}
+
+void libclang_vim::symbol_search::update() {
+    const std::uint64_t generation = get_symbol_index().generation();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_table && m_table->generation == generation)
+            return;
+    }
+
+    // Built without the lock, searches go on with the previous table.
+    std::vector<indexed_symbol> symbols = get_symbol_index().get_symbols();
+    auto table = std::make_shared<symbol_table>();
+    table->generation = generation;
+    table->offsets.assign(1, 0);
+    table->usrs.reserve(symbols.size());
+    table->names.reserve(symbols.size());
+    table->kinds.reserve(symbols.size());
+    table->locations.reserve(symbols.size());
+    table->offsets.reserve(symbols.size() + 1);
+    table->unqualified.reserve(symbols.size());
+    table->masks.reserve(symbols.size());
+
+    std::unordered_map<std::string, std::uint32_t> file_indexes;
+    for (auto& symbol : symbols) {
+        const auto index = static_cast<std::uint32_t>(table->usrs.size());
+        const std::string& name = symbol.info.qualified_name;
+        const std::string folded = fold_case(name);
+        for (std::size_t i = 0; i + 3 <= folded.size(); ++i) {
+            // Each symbol is added once per trigram, so lists stay sorted.
+            std::vector<std::uint32_t>& list =
+                table->trigrams[make_trigram(folded.data() + i)];
+            if (list.empty() || list.back() != index)
+                list.push_back(index);
+        }
+
+        symbol_location location{static_cast<std::uint32_t>(-1), symbol.line,
+                                 symbol.column, symbol.offset};
+        if (!symbol.file.empty()) {
+            auto file = file_indexes.emplace(symbol.file, table->files.size());
+            if (file.second)
+                table->files.push_back(symbol.file);
+            location.file = file.first->second;
+        }
+        table->locations.push_back(location);
+
+        const auto separator = name.rfind("::");
+        table->unqualified.push_back(
+            separator == std::string::npos ? 0 : separator + 2);
+        table->folded_names += folded;
+        table->offsets.push_back(table->folded_names.size());
+        table->masks.push_back(make_character_mask(folded));
+        table->kinds.push_back(symbol.info.kind);
+        table->names.push_back(std::move(symbol.info.qualified_name));
+        table->usrs.push_back(std::move(symbol.usr));
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // A concurrent update() may have built a newer table already.
+    if (!m_table || m_table->generation < generation)
+        m_table = std::move(table);
+}
+
+void libclang_vim::symbol_search::post_update() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_update_posted)
+            return;
+        m_update_posted = true;
+    }
+
+    get_thread_pool().post(
+        [this] {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_update_posted = false;
+            }
+            update();
+        },
+        task_priority::background);
+}
+
+unsigned
+libclang_vim::symbol_table::substring_score(std::uint32_t symbol,
+                                            const std::string& query) const {
+    const char* name = folded_names.data() + offsets[symbol];
+    const std::size_t size = offsets[symbol + 1] - offsets[symbol];
+    const std::size_t unqualified_offset = unqualified[symbol];
+
+    const std::size_t position = find_substring(name, size, query);
+    if (position == std::string::npos)
+        return 0;
+
+    unsigned score = substring_match_score;
+    if (position == unqualified_offset) {
+        // Prefix of the unqualified name, or the name itself.
+        score += size - unqualified_offset == query.size() ? 1000 : 500;
+    } else if (position == 0 || name[position - 1] == '_' ||
+               name[position - 1] == ':')
+        score += 250;
+    return score;
+}
+
+unsigned
+libclang_vim::symbol_table::fuzzy_score(std::uint32_t symbol,
+                                        const std::string& query) const {
+    const char* name = folded_names.data() + offsets[symbol];
+    const char* end = folded_names.data() + offsets[symbol + 1];
+
+    // Subsequence: fewer gaps between the matched characters is better.
+    unsigned gaps = 0;
+    const char* last = nullptr;
+    for (const char character : query) {
+        const void* found = std::memchr(name, character, end - name);
+        if (!found)
+            return 0;
+
+        const char* position = static_cast<const char*>(found);
+        if (last && position != last + 1)
+            ++gaps;
+        last = position;
+        name = position + 1;
+    }
+    return fuzzy_match_score - std::min(gaps, fuzzy_match_score - 1);
+}
+
+std::string libclang_vim::symbol_search::search(const std::string& query,
+                                                std::size_t limit) {
+    std::vector<symbol_match> matches;
+    std::vector<std::uint32_t> substring_matches;
+    const std::string folded_query = fold_case(query);
+    if (folded_query.empty() || limit == 0)
+        return "[]";
+
+    std::shared_ptr<const symbol_table> table;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        table = m_table;
+    }
+    if (!table)
+        return "[]";
+
+    if (folded_query.size() >= 3) {
+        // Substring matches contain all trigrams of the query: intersect
+        // their lists, starting with the shortest one.
+        std::vector<const std::vector<std::uint32_t>*> lists;
+        for (std::size_t i = 0; i + 3 <= folded_query.size(); ++i) {
+            auto it =
+                table->trigrams.find(make_trigram(folded_query.data() + i));
+            if (it == table->trigrams.end()) {
+                lists.clear();
+                break;
+            }
+            lists.push_back(&it->second);
+        }
+        std::sort(lists.begin(), lists.end(),
+                  [](const std::vector<std::uint32_t>* lhs,
+                     const std::vector<std::uint32_t>* rhs) {
+                      return lhs->size() < rhs->size();
+                  });
+
+        std::vector<std::uint32_t> candidates;
+        if (!lists.empty())
+            candidates = *lists.front();
+        for (std::size_t i = 1; i < lists.size() && !candidates.empty(); ++i) {
+            std::vector<std::uint32_t> intersection;
+            std::set_intersection(candidates.begin(), candidates.end(),
+                                  lists[i]->begin(), lists[i]->end(),
+                                  std::back_inserter(intersection));
+            candidates.swap(intersection);
+        }
+
+        for (const auto candidate : candidates) {
+            // Trigrams may match without the query being a substring.
+            const unsigned score =
+                table->substring_score(candidate, folded_query);
+            if (score) {
+                matches.emplace_back(candidate, score);
+                substring_matches.push_back(candidate);
+            }
+        }
+    }
+
+    if (matches.size() < limit) {
+        // Short queries have no trigrams, and fuzzy matches can't be found
+        // with them: scan all names, skipping the ones lacking a character
+        // of the query.
+        const bool substrings_found = folded_query.size() >= 3;
+        const std::uint64_t query_mask = make_character_mask(folded_query);
+        for (std::uint32_t i = 0; i < table->usrs.size(); ++i) {
+            if ((table->masks[i] & query_mask) != query_mask)
+                continue;
+
+            if (!substrings_found) {
+                const unsigned score = table->substring_score(i, folded_query);
+                if (score) {
+                    matches.emplace_back(i, score);
+                    continue;
+                }
+            }
+
+            const unsigned score = table->fuzzy_score(i, folded_query);
+            if (score && !std::binary_search(substring_matches.begin(),
+                                             substring_matches.end(), i))
+                matches.emplace_back(i, score);
+        }
+    }
+
+    const std::size_t count = std::min(limit, matches.size());
+    std::partial_sort(
+        matches.begin(), matches.begin() + count, matches.end(),
+        [&table](const symbol_match& lhs, const symbol_match& rhs) {
+            if (lhs.score != rhs.score)
+                return lhs.score > rhs.score;
+            const std::string& lhs_name = table->names[lhs.symbol];
+            const std::string& rhs_name = table->names[rhs.symbol];
+            if (lhs_name.size() != rhs_name.size())
+                return lhs_name.size() < rhs_name.size();
+            return lhs_name < rhs_name;
+        });
+    matches.erase(matches.begin() + count, matches.end());
+
+    std::string vimson = "[";
+    for (const auto& match : matches) {
+        const symbol_location& location = table->locations[match.symbol];
+        vimson += "{'name':'" + table->names[match.symbol] + "','kind':'" +
+                  stringize_entity_kind(table->kinds[match.symbol]) +
+                  "','usr':'" + table->usrs[match.symbol] + "'";
+        if (location.file != static_cast<std::uint32_t>(-1))
+            vimson += ",'line':" + std::to_string(location.line) +
+                      ",'column':" + std::to_string(location.column) +
+                      ",'offset':" + std::to_string(location.offset) +
+                      ",'file':'" + table->files[location.file] + "'";
+        vimson += "},";
+    }
+    vimson += "]";
+    return vimson;
+}
+
+libclang_vim::symbol_search& libclang_vim::get_symbol_search() {
+    // Deliberately leaked, see get_thread_pool().
+    static symbol_search& search = *new symbol_search;
+    return search;
+}
+
+const char* libclang_vim::search_workspace_symbols(const std::string& request) {
+    static std::string vimson;
+
+    std::size_t limit = default_search_limit;
+    std::string query = request;
+    char* limit_end = nullptr;
+    const unsigned long parsed_limit =
+        std::strtoul(request.c_str(), &limit_end, 10);
+    if (limit_end != request.c_str() && *limit_end == ':') {
+        limit = parsed_limit;
+        query = limit_end + 1;
+    }
+
+    vimson = get_symbol_search().search(query, limit);
+    return vimson.c_str();
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,96 @@
+#if !defined LIBCLANG_VIM_SYMBOL_SEARCH_HPP_INCLUDED
+#define LIBCLANG_VIM_SYMBOL_SEARCH_HPP_INCLUDED
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "symbol_index.hpp"
+
+namespace libclang_vim {
+
+/// A symbol found by symbol_search, with its score, higher is better.
+class symbol_match {
+  public:
+    std::uint32_t symbol;
+    unsigned score;
+
+    symbol_match(std::uint32_t symbol, unsigned score);
+};
+
+/// Where a symbol is defined, or else declared.
+class symbol_location {
+  public:
+    /// Index in symbol_table::files, -1 if unknown.
+    std::uint32_t file;
+    unsigned line;
+    unsigned column;
+    unsigned offset;
+};
+
+/// The names of the symbols of one generation of the symbol index, and the
+/// trigram index of their lowercase forms.
+class symbol_table {
+  public:
+    /// Generation of the symbol index the table was built from.
+    std::uint64_t generation = 0;
+    std::vector<std::string> usrs;
+    std::vector<std::string> names;
+    std::vector<CXIdxEntityKind> kinds;
+    std::vector<symbol_location> locations;
+    /// Files of the locations, each once.
+    std::vector<std::string> files;
+    /// Lowercase names, one after the other, name i is at
+    /// [offsets[i], offsets[i + 1]).
+    std::string folded_names;
+    std::vector<std::uint32_t> offsets;
+    /// Offset of the unqualified part of each name.
+    std::vector<std::uint32_t> unqualified;
+    /// Characters of each name, see make_character_mask().
+    std::vector<std::uint64_t> masks;
+    /// Symbols containing each trigram of lowercase characters, in
+    /// increasing order.
+    std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> trigrams;
+
+    /// Scores query as a substring of symbol's name, 0 if it's not one.
+    unsigned substring_score(std::uint32_t symbol,
+                             const std::string& query) const;
+
+    /// Scores query as a subsequence of symbol's name, 0 if it's not one.
+    unsigned fuzzy_score(std::uint32_t symbol, const std::string& query) const;
+};
+
+/// Finds symbols of the symbol index by their qualified names. Substring
+/// matches are found with a trigram index, fuzzy (subsequence) matches with
+/// a scan of all names. The table is rebuilt by the indexer when the index
+/// changes, searches use the latest table built.
+class symbol_search {
+    std::shared_ptr<const symbol_table> m_table;
+    /// An update() is posted to the thread pool, but not started yet.
+    bool m_update_posted = false;
+    std::mutex m_mutex;
+
+  public:
+    /// Rebuilds the table if the symbol index changed since it was built.
+    void update();
+
+    /// Posts update() to the thread pool, unless it's already posted.
+    void post_update();
+
+    /// Returns the best limit matches of query, best first.
+    std::string search(const std::string& query, std::size_t limit);
+};
+
+symbol_search& get_symbol_search();
+
+/// Parse "limit:query" and search the symbols of the index.
+const char* search_workspace_symbols(const std::string& request);
+
+} // namespace libclang_vim
+
+#endif // LIBCLANG_VIM_SYMBOL_SEARCH_HPP_INCLUDED
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
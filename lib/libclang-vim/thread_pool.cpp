@@ -0,0 +1,151 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "helpers.hpp"
+#include "options.hpp"
+#include "stats.hpp"
+
+namespace {
+
+/// Names of the spans of tasks per priority.
+const char* const task_names[] = {
+    "thread_pool.interactive",
+    "thread_pool.visible",
+    "thread_pool.background",
+};
+
+libclang_vim::thread_pool* create_thread_pool() {
+    auto* pool = new libclang_vim::thread_pool(
+        std::max(1U, std::thread::hardware_concurrency()));
+    std::atexit([] { libclang_vim::get_thread_pool().stop(); });
+    return pool;
+}
+}
+
+libclang_vim::thread_pool::thread_pool(std::size_t size) {
+    pin_library();
+    for (std::size_t i = 0; i < size; ++i)
+        m_threads.emplace_back(&thread_pool::run, this);
+}
+
+libclang_vim::thread_pool::~thread_pool() { stop(); }
+
+void libclang_vim::thread_pool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        for (auto& tasks : m_tasks)
+            tasks.clear();
+    }
+    m_condition.notify_all();
+    for (auto& thread : m_threads) {
+        if (thread.joinable())
+            thread.join();
+    }
+}
+
+bool libclang_vim::thread_pool::pick(std::size_t& priority) const {
+    for (std::size_t i = 0; i < priorities; ++i) {
+        if (m_tasks[i].empty())
+            continue;
+        if (i != static_cast<std::size_t>(task_priority::interactive) &&
+            m_interactive > 0)
+            return false;
+        if (m_running[i] < get_limit(static_cast<task_priority>(i))) {
+            priority = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void libclang_vim::thread_pool::run() {
+    while (true) {
+        std::function<void()> task;
+        std::size_t priority = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this, &priority] {
+                return m_stopping || pick(priority);
+            });
+            if (m_stopping)
+                return;
+
+            task = std::move(m_tasks[priority].front());
+            m_tasks[priority].pop_front();
+            ++m_running[priority];
+        }
+        {
+            scoped_timer timer(task_names[priority]);
+            task();
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_running[priority];
+        }
+        // An other worker may wait for the freed up slot.
+        m_condition.notify_one();
+    }
+}
+
+void libclang_vim::thread_pool::post(std::function<void()> task,
+                                     task_priority priority) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping)
+            return;
+        m_tasks[static_cast<std::size_t>(priority)].push_back(std::move(task));
+    }
+    m_condition.notify_one();
+}
+
+std::size_t libclang_vim::thread_pool::size() const { return m_threads.size(); }
+
+std::size_t
+libclang_vim::thread_pool::get_limit(task_priority priority) const {
+    if (priority == task_priority::interactive)
+        return m_threads.size();
+
+    const std::string option =
+        get_option(priority == task_priority::visible ? "visible_workers"
+                                                      : "background_workers");
+    const std::size_t limit =
+        option.empty() ? m_threads.size() - 1 : std::atoi(option.c_str());
+    return std::max<std::size_t>(1, std::min(limit, m_threads.size()));
+}
+
+void libclang_vim::thread_pool::begin_interactive() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_interactive;
+}
+
+void libclang_vim::thread_pool::end_interactive() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        --m_interactive;
+    }
+    m_condition.notify_all();
+}
+
+bool libclang_vim::thread_pool::is_interactive() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_interactive > 0;
+}
+
+libclang_vim::thread_pool& libclang_vim::get_thread_pool() {
+    // Deliberately leaked, see the declaration.
+    static thread_pool& pool = *create_thread_pool();
+    return pool;
+}
+
+libclang_vim::interactive_scope::interactive_scope() {
+    get_thread_pool().begin_interactive();
+}
+
+libclang_vim::interactive_scope::~interactive_scope() {
+    get_thread_pool().end_interactive();
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
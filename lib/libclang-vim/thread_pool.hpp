@@ -0,0 +1,94 @@
+#if !defined LIBCLANG_VIM_THREAD_POOL_HPP_INCLUDED
+#define LIBCLANG_VIM_THREAD_POOL_HPP_INCLUDED
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace libclang_vim {
+
+/// Scheduling class of a task, in decreasing order of priority.
+enum class task_priority {
+    /// Work a request from Vim waits for.
+    interactive,
+    /// Work on files shown to the user, e.g. a diagnostics sweep.
+    visible,
+    /// Everything else, e.g. indexing.
+    background
+};
+
+/// Fixed number of worker threads running posted tasks, higher priority ones
+/// first and in FIFO order within a class. Each task is expected to handle one
+/// translation unit: lower priority tasks yield to interactive requests at
+/// these boundaries, i.e. none of them is started while a request is in
+/// progress.
+class thread_pool {
+    static const std::size_t priorities = 3;
+
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_tasks[priorities];
+    /// Number of tasks being run per class.
+    std::size_t m_running[priorities] = {};
+    /// Number of interactive requests in progress.
+    std::size_t m_interactive = 0;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping = false;
+
+    void run();
+
+    /// Finds the class of the next task to run, if any may be started now.
+    bool pick(std::size_t& priority) const;
+
+  public:
+    explicit thread_pool(std::size_t size);
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+    /// Same as stop().
+    ~thread_pool();
+
+    /// Drops the queued tasks and waits for the running ones. Tasks posted
+    /// afterwards are dropped, too.
+    void stop();
+
+    void post(std::function<void()> task,
+              task_priority priority = task_priority::background);
+
+    std::size_t size() const;
+
+    /// Returns how many tasks of priority may run at the same time: all
+    /// workers for interactive tasks. Visible and background tasks leave a
+    /// core to the higher priority ones, unless the visible_workers or the
+    /// background_workers option says otherwise.
+    std::size_t get_limit(task_priority priority) const;
+
+    /// Counts interactive requests in progress, see interactive_scope.
+    void begin_interactive();
+    void end_interactive();
+    bool is_interactive() const;
+};
+
+/// The pool of background workers, one per core. It's stopped at exit, but
+/// never destroyed, and neither are the objects its tasks use (the caches,
+/// the indexes, the stores of the options and the statistics): exit() would
+/// otherwise destroy them in an order unrelated to what the running tasks
+/// use.
+thread_pool& get_thread_pool();
+
+/// Marks an interactive request in progress during its lifetime.
+class interactive_scope {
+  public:
+    interactive_scope();
+    interactive_scope(const interactive_scope&) = delete;
+    interactive_scope& operator=(const interactive_scope&) = delete;
+    ~interactive_scope();
+};
+
+} // namespace libclang_vim
+
+#endif // LIBCLANG_VIM_THREAD_POOL_HPP_INCLUDED
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -1,9 +1,12 @@
 #include "tokenizer.hpp"
 #include <numeric>
 
+#include "stats.hpp"
+#include "translation_unit_cache.hpp"
+
 CXSourceRange libclang_vim::tokenizer::get_range_whole_file(
     const location_tuple& tuple,
-    const libclang_vim::cxtranslation_unit_ptr& translation_unit) const {
+    const CXTranslationUnit& translation_unit) const {
     size_t const file_size = tuple.unsaved_file.empty()
                                  ? get_file_size(tuple.file.c_str())
                                  : tuple.unsaved_file.size();
@@ -43,7 +46,7 @@ libclang_vim::tokenizer::get_kind_spelling(const CXTokenKind kind) const {
 }
 
 std::string libclang_vim::tokenizer::make_vimson_from_tokens(
-    const libclang_vim::cxtranslation_unit_ptr& translation_unit,
+    const CXTranslationUnit& translation_unit,
     std::vector<CXToken> tokens) const {
     return "[" + std::accumulate(
                      std::begin(tokens), std::end(tokens), std::string{},
@@ -72,28 +75,28 @@ std::string libclang_vim::tokenizer::make_vimson_from_tokens(
 
 std::string
 libclang_vim::tokenizer::tokenize_as_vimson(const location_tuple& tuple) {
-    cxindex_ptr index =
-        clang_createIndex(/*excludeDeclsFromPCH*/ 1, /*displayDiagnostics*/ 0);
-
-    std::vector<const char*> args_ptrs = get_args_ptrs(tuple.args);
-    std::vector<CXUnsavedFile> unsaved_files = create_unsaved_files(tuple);
     unsigned options = CXTranslationUnit_Incomplete;
-    cxtranslation_unit_ptr translation_unit = clang_parseTranslationUnit(
-        index, tuple.file.c_str(), args_ptrs.data(), args_ptrs.size(),
-        unsaved_files.data(), unsaved_files.size(), options);
+    scoped_timer parse_timer("tokenizer.parse");
+    cached_translation_unit_ptr translation_unit =
+        parse_translation_unit(tuple, options);
     if (!translation_unit)
         return "{}";
+    parse_timer.stop();
 
     auto file_range = get_range_whole_file(tuple, translation_unit);
     if (clang_Range_isNull(file_range))
         return "{}";
 
+    scoped_timer tokenize_timer("tokenizer.tokenize");
     CXToken* tokens_;
     unsigned int num_tokens;
     clang_tokenize(translation_unit, file_range, &tokens_, &num_tokens);
     std::vector<CXToken> tokens(tokens_, tokens_ + num_tokens);
+    tokenize_timer.stop();
 
+    scoped_timer stringize_timer("tokenizer.stringize");
     auto result = make_vimson_from_tokens(translation_unit, tokens);
+    stringize_timer.stop();
 
     clang_disposeTokens(translation_unit, tokens_, num_tokens);
 
@@ -0,0 +1,102 @@
+#include "trace.hpp"
+
+#include <cstdlib>
+#include <unistd.h>
+
+#include "helpers.hpp"
+
+namespace {
+
+/// Small number identifying the calling thread in the trace.
+unsigned get_thread_id() {
+    static std::atomic<unsigned> next_id(1);
+    thread_local unsigned id = next_id++;
+    return id;
+}
+
+libclang_vim::tracer* create_tracer() {
+    auto* instance = new libclang_vim::tracer();
+    // Not destroyed, but the trace is completed all the same.
+    std::atexit([] { libclang_vim::get_tracer().stop(); });
+    return instance;
+}
+
+long long to_microseconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration)
+        .count();
+}
+}
+
+libclang_vim::tracer::tracer() : m_enabled(false) { pin_library(); }
+
+libclang_vim::tracer::~tracer() { stop(); }
+
+bool libclang_vim::tracer::start(const std::string& file) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file)
+        return false;
+
+    m_file = std::fopen(file.c_str(), "w");
+    if (!m_file)
+        return false;
+
+    std::fputs("[\n", m_file);
+    m_events = 0;
+    m_enabled = true;
+    return true;
+}
+
+std::size_t libclang_vim::tracer::stop() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file)
+        return 0;
+
+    m_enabled = false;
+    std::fputs("\n]\n", m_file);
+    std::fclose(m_file);
+    m_file = nullptr;
+    return m_events;
+}
+
+bool libclang_vim::tracer::is_enabled() const {
+    return m_enabled.load(std::memory_order_relaxed);
+}
+
+void libclang_vim::tracer::add_span(
+    const char* name, std::chrono::steady_clock::time_point start,
+    std::chrono::steady_clock::duration duration) {
+    const unsigned thread_id = get_thread_id();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file)
+        return;
+
+    std::fprintf(m_file,
+                 "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,"
+                 "\"pid\":%d,\"tid\":%u}",
+                 m_events ? ",\n" : "", name,
+                 to_microseconds(start.time_since_epoch()),
+                 to_microseconds(duration), static_cast<int>(getpid()),
+                 thread_id);
+    ++m_events;
+}
+
+libclang_vim::tracer& libclang_vim::get_tracer() {
+    // Deliberately leaked, see get_thread_pool().
+    static tracer& instance = *create_tracer();
+    return instance;
+}
+
+const char* libclang_vim::start_tracing(const std::string& file) {
+    if (file.empty() || !get_tracer().start(file))
+        return "{}";
+
+    return "{'ok':1}";
+}
+
+const char* libclang_vim::stop_tracing() {
+    static std::string vimson;
+    vimson = "{'events':" + std::to_string(get_tracer().stop()) + "}";
+    return vimson.c_str();
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
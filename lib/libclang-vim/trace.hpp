@@ -0,0 +1,53 @@
+#if !defined LIBCLANG_VIM_TRACE_HPP_INCLUDED
+#define LIBCLANG_VIM_TRACE_HPP_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+namespace libclang_vim {
+
+/// Writes the spans measured by scoped_timer to a file in the Chrome
+/// trace_event format, as long as it's started. Does nothing otherwise, apart
+/// from checking is_enabled().
+class tracer {
+    std::atomic<bool> m_enabled;
+    std::FILE* m_file = nullptr;
+    std::size_t m_events = 0;
+    std::mutex m_mutex;
+
+  public:
+    tracer();
+    tracer(const tracer&) = delete;
+    tracer& operator=(const tracer&) = delete;
+    ~tracer();
+
+    /// Starts writing to file, replacing its contents. Fails if already
+    /// started or the file can't be created.
+    bool start(const std::string& file);
+
+    /// Finishes the file, returns the number of written events.
+    std::size_t stop();
+
+    bool is_enabled() const;
+
+    /// Adds a complete event of name on the calling thread.
+    void add_span(const char* name, std::chrono::steady_clock::time_point start,
+                  std::chrono::steady_clock::duration duration);
+};
+
+tracer& get_tracer();
+
+/// Start tracing into file.
+const char* start_tracing(const std::string& file);
+
+/// Stop tracing and describe the written trace.
+const char* stop_tracing();
+
+} // namespace libclang_vim
+
+#endif // LIBCLANG_VIM_TRACE_HPP_INCLUDED
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,484 @@
+#include "translation_unit_cache.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "include_graph.hpp"
+#include "index_shard.hpp"
+#include "options.hpp"
+#include "shared_pch.hpp"
+#include "stats.hpp"
+#include "thread_pool.hpp"
+#include "unit_snapshot.hpp"
+
+namespace {
+
+/// Number of translation units kept alive at the same time, however small.
+const std::size_t max_cached_translation_units = 32;
+
+/// Used unless the memory_budget option is set, in megabytes.
+const std::uint64_t default_memory_budget = 2048;
+
+std::uint64_t get_memory_budget() {
+    const std::string budget = libclang_vim::get_option("memory_budget");
+    if (budget.empty())
+        return default_memory_budget << 20;
+    return std::strtoull(budget.c_str(), nullptr, 10) << 20;
+}
+
+/// Returns the bytes used by unit, as far as libclang knows.
+std::uint64_t get_memory_usage(CXTranslationUnit unit) {
+    CXTUResourceUsage usage = clang_getCXTUResourceUsage(unit);
+    std::uint64_t bytes = 0;
+    for (unsigned i = 0; i < usage.numEntries; ++i) {
+        const CXTUResourceUsageEntry& entry = usage.entries[i];
+        if (entry.kind >= CXTUResourceUsage_MEMORY_IN_BYTES_BEGIN &&
+            entry.kind <= CXTUResourceUsage_MEMORY_IN_BYTES_END)
+            bytes += entry.amount;
+    }
+    clang_disposeCXTUResourceUsage(usage);
+    return bytes;
+}
+
+/// Updates what is known about entry after a (re)parse with location_info.
+void record_parse(libclang_vim::cached_translation_unit& entry,
+                  const libclang_vim::location_tuple& location_info,
+                  std::uint64_t unsaved_hash) {
+    libclang_vim::get_include_graph().update(entry.file, entry.unit,
+                                             entry.pch_dependencies);
+    entry.memory = get_memory_usage(entry.unit);
+    entry.unsaved_files.clear();
+    if (!location_info.unsaved_file.empty())
+        entry.unsaved_files.emplace_back(
+            location_info.file, location_info.unsaved_file.private_copy());
+    for (const auto& other : location_info.other_unsaved_files)
+        entry.unsaved_files.emplace_back(other.first,
+                                         other.second.private_copy());
+    entry.unsaved_hash = unsaved_hash;
+    std::vector<std::string> dependencies =
+        libclang_vim::get_dependencies(entry.unit);
+    dependencies.insert(dependencies.end(), entry.pch_dependencies.begin(),
+                        entry.pch_dependencies.end());
+    entry.dependencies.record(std::move(dependencies), location_info);
+    entry.stale = false;
+}
+
+std::string make_key(const libclang_vim::location_tuple& location_info,
+                     unsigned options) {
+    // Relative file names are resolved against the working directory.
+    std::string key = libclang_vim::get_current_directory() + '\n' +
+                      location_info.file + '\n' + std::to_string(options);
+    for (const auto& arg : location_info.args)
+        key += '\n' + arg;
+    return key;
+}
+}
+
+libclang_vim::cached_translation_unit::cached_translation_unit() = default;
+
+libclang_vim::cached_translation_unit::~cached_translation_unit() {
+    if (unit)
+        clang_disposeTranslationUnit(unit);
+}
+
+libclang_vim::cached_translation_unit_ptr::cached_translation_unit_ptr(
+    std::shared_ptr<cached_translation_unit> entry)
+    : m_entry(std::move(entry)), m_unit(m_entry ? m_entry->unit : nullptr) {
+    if (m_entry)
+        m_lock = std::make_shared<std::unique_lock<std::recursive_mutex>>(
+            m_entry->use_mutex);
+}
+
+libclang_vim::cached_translation_unit_ptr::
+operator const CXTranslationUnit&() const {
+    return m_unit;
+}
+
+libclang_vim::cached_translation_unit_ptr::operator bool() const {
+    return m_unit != nullptr;
+}
+
+const std::string*
+libclang_vim::cached_translation_unit_ptr::get_snapshot_diagnostics() const {
+    if (!m_entry || !m_entry->from_snapshot)
+        return nullptr;
+    return &m_entry->snapshot_diagnostics;
+}
+
+libclang_vim::translation_unit_cache::translation_unit_cache()
+    : m_index(clang_createIndex(/*excludeDeclsFromPCH*/ 1,
+                                /*displayDiagnostics*/ 0)) {
+    pin_library();
+}
+
+void libclang_vim::translation_unit_cache::evict(
+    const cached_translation_unit* keep) {
+    const std::uint64_t budget = get_memory_budget();
+    std::uint64_t total = 0;
+    for (const auto& entry : m_entries)
+        total += entry.second->memory;
+
+    while (m_entries.size() > 1 &&
+           (m_entries.size() > max_cached_translation_units ||
+            total > budget)) {
+        // Evicting the unit with the largest size * age is LRU for units of
+        // the same size, and lets a small unit outlive a large one that was
+        // used a bit later.
+        auto victim = m_entries.end();
+        double victim_cost = -1;
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (it->second.get() == keep)
+                continue;
+            const double cost =
+                static_cast<double>(it->second->memory + 1) *
+                static_cast<double>(m_clock - it->second->last_used + 1);
+            if (cost > victim_cost) {
+                victim = it;
+                victim_cost = cost;
+            }
+        }
+        if (victim == m_entries.end())
+            break;
+        total -= victim->second->memory;
+        m_entries.erase(victim);
+    }
+}
+
+libclang_vim::cached_translation_unit_ptr
+libclang_vim::translation_unit_cache::get(const location_tuple& location_info,
+                                          unsigned options,
+                                          bool allow_snapshot) {
+    interactive_scope scope;
+    return cached_translation_unit_ptr(
+        get_entry(location_info, options, allow_snapshot));
+}
+
+std::shared_ptr<libclang_vim::cached_translation_unit>
+libclang_vim::translation_unit_cache::get_entry(
+    const location_tuple& location_info, unsigned options,
+    bool allow_snapshot) {
+    const char* file_name = location_info.file.c_str();
+    std::vector<CXUnsavedFile> unsaved_files =
+        create_unsaved_files(location_info);
+    const std::uint64_t unsaved_hash = hash_unsaved_files(unsaved_files);
+    const std::string key = make_key(location_info, options);
+    const std::string snapshot_directory = get_snapshot_directory();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::shared_ptr<cached_translation_unit>& entry = m_entries[key];
+    bool updated = false;
+    // Whether the snapshot on disk is still good, so that it is not saved
+    // again.
+    bool snapshot_current = false;
+    const bool changed =
+        entry && (entry->unsaved_hash != unsaved_hash || entry->stale ||
+                  !entry->dependencies.is_current(location_info));
+    count_event(entry && !changed && (allow_snapshot || !entry->from_snapshot)
+                    ? "translation_unit_cache.hits"
+                    : "translation_unit_cache.misses");
+    if (entry && entry->from_snapshot && (changed || !allow_snapshot)) {
+        snapshot_current = !changed;
+        entry.reset();
+    } else if (changed && !entry->pch_args.empty() &&
+               get_shared_pch_store().get_args(location_info) !=
+                   entry->pch_args) {
+        // Reparsing would fail with a precompiled header which is out of date
+        // or no longer shared.
+        entry.reset();
+    } else if (changed && entry->saving)
+        // The saving task keeps the old unit alive till it's done.
+        entry.reset();
+    else if (changed) {
+        scoped_timer timer("translation_unit_cache.reparse");
+        // A unit is only good for disposal after a failed reparse.
+        if (clang_reparseTranslationUnit(
+                entry->unit, unsaved_files.size(), unsaved_files.data(),
+                clang_defaultReparseOptions(entry->unit)) != 0)
+            entry.reset();
+        else
+            updated = true;
+    }
+
+    bool save = false;
+    if (!entry) {
+        auto parsed = std::make_shared<cached_translation_unit>();
+        if (!snapshot_directory.empty()) {
+            scoped_timer timer("translation_unit_cache.snapshot");
+            if (allow_snapshot)
+                parsed->unit = load_unit_snapshot(
+                    snapshot_directory, key, location_info, m_index,
+                    parsed->snapshot_diagnostics);
+            else if (!snapshot_current) {
+                std::string diagnostics;
+                snapshot_current = is_unit_snapshot_current(
+                    snapshot_directory, key, location_info, diagnostics);
+            }
+            parsed->from_snapshot = parsed->unit != nullptr;
+        }
+        if (!parsed->unit) {
+            args_type args = location_info.args;
+            parsed->pch_args = get_shared_pch_store().get_args(
+                location_info, &parsed->pch_dependencies);
+            args.insert(args.end(), parsed->pch_args.begin(),
+                        parsed->pch_args.end());
+            auto const args_ptrs = get_args_ptrs(args);
+            scoped_timer timer("translation_unit_cache.parse");
+            // The preamble makes reparsing cheap.
+            parsed->unit = clang_parseTranslationUnit(
+                m_index, file_name, args_ptrs.data(), args_ptrs.size(),
+                unsaved_files.data(), unsaved_files.size(),
+                options | CXTranslationUnit_PrecompiledPreamble);
+            timer.stop();
+            if (!parsed->unit) {
+                m_entries.erase(key);
+                return nullptr;
+            }
+            save = !snapshot_directory.empty() && !snapshot_current;
+        }
+        parsed->name = location_info.file;
+        parsed->file = get_real_path(location_info.file);
+        parsed->options = options;
+        entry = parsed;
+        updated = true;
+    }
+
+    if (updated)
+        record_parse(*entry, location_info, unsaved_hash);
+    if (save)
+        save_snapshot(snapshot_directory, key, location_info, entry);
+    entry->last_used = ++m_clock;
+    std::shared_ptr<cached_translation_unit> result = entry;
+    evict(result.get());
+    return result;
+}
+
+libclang_vim::cached_translation_unit_ptr
+libclang_vim::translation_unit_cache::get_owner(
+    const location_tuple& location_info, unsigned options) {
+    if (!is_header_file(location_info.file))
+        return cached_translation_unit_ptr(nullptr);
+
+    interactive_scope scope;
+    return cached_translation_unit_ptr(
+        get_owner_entry(location_info, options));
+}
+
+std::shared_ptr<libclang_vim::cached_translation_unit>
+libclang_vim::translation_unit_cache::get_owner_entry(
+    const location_tuple& location_info, unsigned options) {
+    const std::string header = get_real_path(location_info.file);
+    const std::set<std::string> units =
+        get_include_graph().get_dependent_units(header);
+    if (units.empty())
+        return nullptr;
+
+    std::vector<CXUnsavedFile> unsaved_files =
+        create_unsaved_files(location_info);
+    const std::uint64_t unsaved_hash = hash_unsaved_files(unsaved_files);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto owner = m_entries.end();
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        const cached_translation_unit& entry = *it->second;
+        // Snapshots can't be reparsed with the unsaved header.
+        if (entry.from_snapshot || !units.count(entry.file) ||
+            (entry.options & options) != options)
+            continue;
+        if (owner == m_entries.end() ||
+            entry.last_used > owner->second->last_used)
+            owner = it;
+    }
+    if (owner == m_entries.end())
+        return nullptr;
+
+    cached_translation_unit& entry = *owner->second;
+    if (entry.unsaved_hash != unsaved_hash || entry.stale ||
+        !entry.dependencies.is_current(location_info)) {
+        if (entry.saving)
+            return nullptr;
+
+        scoped_timer timer("translation_unit_cache.reparse");
+        if (clang_reparseTranslationUnit(
+                entry.unit, unsaved_files.size(), unsaved_files.data(),
+                clang_defaultReparseOptions(entry.unit)) != 0) {
+            m_entries.erase(owner);
+            return nullptr;
+        }
+        record_parse(entry, location_info, unsaved_hash);
+    }
+    entry.last_used = ++m_clock;
+    std::shared_ptr<cached_translation_unit> result = owner->second;
+    evict(result.get());
+    return result;
+}
+
+void libclang_vim::translation_unit_cache::save_snapshot(
+    const std::string& directory, const std::string& key,
+    const location_tuple& location_info,
+    const std::shared_ptr<cached_translation_unit>& entry) {
+    location_tuple info = location_info;
+    make_unsaved_files_private(info);
+    entry->saving = true;
+    // The task holds its own reference, so the unit outlives its eviction.
+    get_thread_pool().post(
+        [this, directory, key, info, entry] {
+            {
+                // Waits for the caller of get() to finish with the unit.
+                std::lock_guard<std::recursive_mutex> use(entry->use_mutex);
+                scoped_timer timer("translation_unit_cache.save_snapshot");
+                save_unit_snapshot(directory, key, info, entry->unit);
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            entry->saving = false;
+        },
+        task_priority::background);
+}
+
+std::size_t libclang_vim::translation_unit_cache::invalidate(
+    const std::set<std::string>& files) {
+    std::size_t invalidated = 0;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& entry : m_entries) {
+        if (files.count(entry.second->file)) {
+            entry.second->stale = true;
+            ++invalidated;
+        }
+    }
+    return invalidated;
+}
+
+void libclang_vim::translation_unit_cache::refresh(
+    const std::string& key, const std::function<void()>& reparsed) {
+    std::shared_ptr<cached_translation_unit> entry;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(key);
+        if (it == m_entries.end() || !it->second->stale ||
+            it->second.use_count() > 1)
+            return;
+
+        // Out of the map, so that get() doesn't wait for the reparse, it
+        // parses the unit on its own if it has to.
+        entry = std::move(it->second);
+        m_entries.erase(it);
+    }
+
+    location_tuple location_info;
+    location_info.file = entry->name;
+    location_info.other_unsaved_files = entry->unsaved_files;
+    std::vector<CXUnsavedFile> unsaved_files =
+        create_unsaved_files(location_info);
+    {
+        scoped_timer timer("translation_unit_cache.reparse");
+        if (clang_reparseTranslationUnit(
+                entry->unit, unsaved_files.size(), unsaved_files.data(),
+                clang_defaultReparseOptions(entry->unit)) != 0)
+            return;
+    }
+    record_parse(*entry, location_info, hash_unsaved_files(unsaved_files));
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::shared_ptr<cached_translation_unit>& slot = m_entries[key];
+        // get() parsed the unit in the meantime.
+        if (slot)
+            return;
+        slot = std::move(entry);
+        evict(nullptr);
+    }
+    reparsed();
+}
+
+std::size_t libclang_vim::translation_unit_cache::refresh_stale(
+    const std::function<void()>& reparsed) {
+    std::vector<std::string> keys;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto it = m_entries.begin(); it != m_entries.end();) {
+            const cached_translation_unit& entry = *it->second;
+            // A unit handed out by get() may be in use on an other thread,
+            // it's reparsed by its next get() instead.
+            if (!entry.stale || it->second.use_count() > 1) {
+                ++it;
+                continue;
+            }
+
+            // Whether its precompiled header is still good is up to the next
+            // get().
+            if (!entry.pch_args.empty()) {
+                it = m_entries.erase(it);
+                continue;
+            }
+
+            keys.push_back(it->first);
+            ++it;
+        }
+    }
+
+    for (const auto& key : keys)
+        get_thread_pool().post(
+            [this, key, reparsed] { refresh(key, reparsed); },
+            task_priority::background);
+    return keys.size();
+}
+
+std::string libclang_vim::translation_unit_cache::get_usage() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<const cached_translation_unit*> entries;
+    std::uint64_t total = 0;
+    for (const auto& entry : m_entries) {
+        entries.push_back(entry.second.get());
+        total += entry.second->memory;
+    }
+    // Most recently used first.
+    std::sort(entries.begin(), entries.end(),
+              [](const cached_translation_unit* lhs,
+                 const cached_translation_unit* rhs) {
+                  return lhs->last_used > rhs->last_used;
+              });
+
+    std::string vimson = "{'budget':" + std::to_string(get_memory_budget()) +
+                         ",'total':" + std::to_string(total) + ",'units':[";
+    for (const cached_translation_unit* entry : entries) {
+        vimson += "{'file':'" + entry->file +
+                  "','memory':" + std::to_string(entry->memory) +
+                  ",'age':" + std::to_string(m_clock - entry->last_used) +
+                  ",'snapshot':" + (entry->from_snapshot ? "1" : "0") + "},";
+    }
+    vimson += "]}";
+    return vimson;
+}
+
+libclang_vim::translation_unit_cache&
+libclang_vim::get_translation_unit_cache() {
+    // Deliberately leaked, see get_thread_pool().
+    static translation_unit_cache& cache = *new translation_unit_cache;
+    return cache;
+}
+
+libclang_vim::cached_translation_unit_ptr
+libclang_vim::parse_translation_unit(const location_tuple& location_info,
+                                     unsigned options, bool allow_snapshot) {
+    return get_translation_unit_cache().get(location_info, options,
+                                            allow_snapshot);
+}
+
+const char* libclang_vim::get_translation_unit_usage() {
+    static std::string vimson;
+    vimson = get_translation_unit_cache().get_usage();
+    return vimson.c_str();
+}
+
+libclang_vim::cached_translation_unit_ptr
+libclang_vim::parse_translation_unit_at(const location_tuple& location_info,
+                                        unsigned options) {
+    if (get_option("header_owners") == "1") {
+        cached_translation_unit_ptr owner =
+            get_translation_unit_cache().get_owner(location_info, options);
+        if (owner)
+            return owner;
+    }
+    return get_translation_unit_cache().get(location_info, options);
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
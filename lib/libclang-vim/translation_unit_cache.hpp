@@ -0,0 +1,171 @@
+#if !defined LIBCLANG_VIM_TRANSLATION_UNIT_CACHE_HPP_INCLUDED
+#define LIBCLANG_VIM_TRANSLATION_UNIT_CACHE_HPP_INCLUDED
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include <clang-c/Index.h>
+
+#include "file_watcher.hpp"
+#include "helpers.hpp"
+
+namespace libclang_vim {
+
+/// A parsed translation unit that is kept alive between calls.
+class cached_translation_unit {
+  public:
+    CXTranslationUnit unit = nullptr;
+    /// Name of the main file, as in the request.
+    std::string name;
+    /// Canonical name of the main file.
+    std::string file;
+    /// Options the unit was parsed with.
+    unsigned options = 0;
+    /// Private copies of the unsaved files the unit was last (re)parsed with,
+    /// and their hash.
+    std::vector<std::pair<std::string, unsaved_buffer>> unsaved_files;
+    std::uint64_t unsaved_hash = 0;
+    /// Files the unit was last (re)parsed from, including the ones in its
+    /// precompiled header.
+    dependency_state dependencies;
+    /// Set when a file the unit depends on changed on disk.
+    bool stale = false;
+    /// Set if the unit was loaded from a snapshot, which can't be reparsed.
+    bool from_snapshot = false;
+    /// Set while a background task saves the unit as a snapshot, it's not
+    /// reparsed meanwhile.
+    bool saving = false;
+    /// Held while the unit is used through a cached_translation_unit_ptr or
+    /// saved, as libclang doesn't support using a unit on two threads at
+    /// once.
+    std::recursive_mutex use_mutex;
+    /// Stringized diagnostics of a unit loaded from a snapshot.
+    std::string snapshot_diagnostics;
+    /// Arguments selecting the shared precompiled header used by the unit,
+    /// and the files in that header.
+    args_type pch_args;
+    std::vector<std::string> pch_dependencies;
+    /// Value of translation_unit_cache's clock at the last use.
+    std::uint64_t last_used = 0;
+    /// Bytes used by the unit as of its last (re)parse.
+    std::uint64_t memory = 0;
+
+    cached_translation_unit();
+    cached_translation_unit(const cached_translation_unit&) = delete;
+    cached_translation_unit& operator=(const cached_translation_unit&) = delete;
+    ~cached_translation_unit();
+};
+
+/// Shared reference to a cached translation unit, usable where a
+/// CXTranslationUnit is expected. It holds the use_mutex of the unit, so it
+/// has to be released on the thread which got it.
+class cached_translation_unit_ptr {
+    std::shared_ptr<cached_translation_unit> m_entry;
+    std::shared_ptr<std::unique_lock<std::recursive_mutex>> m_lock;
+    CXTranslationUnit m_unit = nullptr;
+
+  public:
+    cached_translation_unit_ptr(std::shared_ptr<cached_translation_unit> entry);
+
+    operator const CXTranslationUnit&() const;
+
+    operator bool() const;
+
+    /// Returns the stringized diagnostics if the unit was loaded from a
+    /// snapshot, as clang_getDiagnostic() knows none then.
+    const std::string* get_snapshot_diagnostics() const;
+};
+
+/// Keeps the recently used translation units, so that a repeated request on
+/// the same file only needs a clang_reparseTranslationUnit(), and only if the
+/// unsaved buffers or any file it was parsed from changed since. Units are
+/// evicted once they take more memory than the memory_budget option allows,
+/// large ones which were not used for a long time first. If the
+/// cache_directory option is set, parsed units are also saved there, and
+/// loaded instead of parsed the next time if none of their files changed.
+class translation_unit_cache {
+    cxindex_ptr m_index;
+    std::map<std::string, std::shared_ptr<cached_translation_unit>> m_entries;
+    std::uint64_t m_clock = 0;
+    std::mutex m_mutex;
+
+    /// See get(), returns the entry without locking its use_mutex, as that
+    /// may wait for a snapshot to be saved.
+    std::shared_ptr<cached_translation_unit>
+    get_entry(const location_tuple& location_info, unsigned options,
+              bool allow_snapshot);
+
+    /// See get_owner().
+    std::shared_ptr<cached_translation_unit>
+    get_owner_entry(const location_tuple& location_info, unsigned options);
+
+    /// Evicts units until the cache fits into its budget, except keep.
+    void evict(const cached_translation_unit* keep);
+
+    /// Reparses the unit of key if it's still stale and not in use, see
+    /// refresh_stale().
+    void refresh(const std::string& key, const std::function<void()>& reparsed);
+
+    /// Queues saving the unit of entry, just parsed from location_info, as the
+    /// snapshot of key.
+    void save_snapshot(const std::string& directory, const std::string& key,
+                       const location_tuple& location_info,
+                       const std::shared_ptr<cached_translation_unit>& entry);
+
+  public:
+    translation_unit_cache();
+
+    /// Returns the up to date translation unit for the file and arguments in
+    /// location_info, parsed with options. Pass allow_snapshot = false if the
+    /// unit has to support everything a parsed one does, e.g. code completion.
+    cached_translation_unit_ptr get(const location_tuple& location_info,
+                                    unsigned options,
+                                    bool allow_snapshot = true);
+
+    /// Returns the most recently used cached unit including the header in
+    /// location_info and parsed with at least options, brought up to date with
+    /// the unsaved buffers, or a null one if there is none.
+    cached_translation_unit_ptr get_owner(const location_tuple& location_info,
+                                          unsigned options);
+
+    /// Makes the units of the canonical main files in files reparse on their
+    /// next use. Returns the number of affected units.
+    std::size_t invalidate(const std::set<std::string>& files);
+
+    /// Queues a background reparse of each unit made out of date by
+    /// invalidate() which is not in use, with the unsaved files of its last
+    /// (re)parse. Calls reparsed() after each successful reparse, on the
+    /// worker thread. Returns the number of queued units.
+    std::size_t refresh_stale(const std::function<void()>& reparsed);
+
+    /// Describes the memory used by the cached units.
+    std::string get_usage();
+};
+
+translation_unit_cache& get_translation_unit_cache();
+
+/// Shorthand for get_translation_unit_cache().get().
+cached_translation_unit_ptr
+parse_translation_unit(const location_tuple& location_info, unsigned options,
+                       bool allow_snapshot = true);
+
+/// Describe the memory used by the translation unit cache.
+const char* get_translation_unit_usage();
+
+/// Same as parse_translation_unit(), for requests only about the location in
+/// location_info: if the header_owners option is set, a header is looked up
+/// in an already parsed unit including it instead.
+cached_translation_unit_ptr
+parse_translation_unit_at(const location_tuple& location_info,
+                          unsigned options);
+
+} // namespace libclang_vim
+
+#endif // LIBCLANG_VIM_TRANSLATION_UNIT_CACHE_HPP_INCLUDED
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,83 @@
+#include "type_hierarchy.hpp"
+
+#include <set>
+#include <vector>
+
+#include "symbol_index.hpp"
+
+namespace {
+
+using get_related_type = std::vector<std::string> (
+    libclang_vim::symbol_index::*)(const std::string&) const;
+
+/// Describes the classes related to usr and theirs, recursively. path has the
+/// classes above, so that a broken index can't make a cycle.
+std::string stringize_tree(const std::string& usr, get_related_type related,
+                           const char* key, std::set<std::string>& path) {
+    std::string vimson = "[";
+    for (const auto& child : (libclang_vim::get_symbol_index().*related)(usr)) {
+        if (!path.insert(child).second)
+            continue;
+
+        vimson += "{" + libclang_vim::stringize_indexed_symbol(child) + ",'" +
+                  key + "':" + stringize_tree(child, related, key, path) + "},";
+        path.erase(child);
+    }
+    vimson += "]";
+    return vimson;
+}
+
+const char* get_tree(const std::string& request, get_related_type related,
+                     const char* key) {
+    static std::string vimson;
+
+    const std::string usr = libclang_vim::get_usr_of_request(request);
+    if (usr.empty())
+        return "[]";
+
+    std::set<std::string> path{usr};
+    vimson = stringize_tree(usr, related, key, path);
+    return vimson.c_str();
+}
+}
+
+const char* libclang_vim::get_base_classes(const std::string& request) {
+    return get_tree(request, &symbol_index::get_bases, "bases");
+}
+
+const char* libclang_vim::get_derived_classes(const std::string& request) {
+    return get_tree(request, &symbol_index::get_derived, "derived");
+}
+
+const char* libclang_vim::get_implementations(const std::string& request) {
+    static std::string vimson;
+
+    const std::string usr = libclang_vim::get_usr_of_request(request);
+    if (usr.empty())
+        return "[]";
+
+    // Only one of the graphs has edges to usr: the overrides of a method or
+    // the bases of a class.
+    const symbol_index& index = get_symbol_index();
+    // Breadth-first, so that the nearest implementations come first.
+    std::set<std::string> seen{usr};
+    std::vector<std::string> found{usr};
+    vimson = "[";
+    for (std::size_t i = 0; i < found.size(); ++i) {
+        std::vector<std::string> implementations =
+            index.get_overriders(found[i]);
+        if (implementations.empty())
+            implementations = index.get_derived(found[i]);
+        for (const auto& implementation : implementations) {
+            if (!seen.insert(implementation).second)
+                continue;
+
+            vimson += "{" + stringize_indexed_symbol(implementation) + "},";
+            found.push_back(implementation);
+        }
+    }
+    vimson += "]";
+    return vimson.c_str();
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
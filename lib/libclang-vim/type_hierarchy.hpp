@@ -0,0 +1,25 @@
+#if !defined LIBCLANG_VIM_TYPE_HIERARCHY_HPP_INCLUDED
+#define LIBCLANG_VIM_TYPE_HIERARCHY_HPP_INCLUDED
+
+#include <string>
+
+namespace libclang_vim {
+
+/// Describes the base classes of a class as a tree, from the base specifiers
+/// recorded by the symbol index. The class is given by its USR or as
+/// "file:args:line:col" of an occurrence.
+const char* get_base_classes(const std::string& request);
+
+/// Describes the classes derived from a class as a tree, the same way as
+/// get_base_classes().
+const char* get_derived_classes(const std::string& request);
+
+/// Lists the methods overriding a virtual method, or the classes derived from
+/// a class, directly or not.
+const char* get_implementations(const std::string& request);
+
+} // namespace libclang_vim
+
+#endif // LIBCLANG_VIM_TYPE_HIERARCHY_HPP_INCLUDED
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,233 @@
+#include "unit_snapshot.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "index_shard.hpp"
+#include "options.hpp"
+#include "stringizers.hpp"
+
+namespace {
+
+/// A snapshot is the AST file written by clang_saveTranslationUnit(), and a
+/// dependency file next to it: a header, then null-terminated strings, the
+/// cache key, the stringized diagnostics (which are not part of the AST file)
+/// and the names of the files the unit was parsed from.
+const char snapshot_magic[8] = {'L', 'C', 'V', 'A', 'S', 'T', '\0', '\0'};
+
+struct snapshot_header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t dependency_count;
+    std::uint64_t dependency_hash;
+    std::uint64_t string_table_size;
+};
+
+/// Used unless the snapshot_size_limit option is set, in megabytes.
+const std::uint64_t default_size_limit = 512;
+
+const char ast_suffix[] = ".ast";
+const char dependencies_suffix[] = ".deps";
+
+std::string get_snapshot_path(const std::string& directory,
+                              const std::string& key) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx",
+                  static_cast<unsigned long long>(
+                      libclang_vim::hash_bytes(key.data(), key.size())));
+    return directory + "/" + name;
+}
+
+std::uint64_t get_size_limit() {
+    const std::string limit =
+        libclang_vim::get_option("snapshot_size_limit");
+    if (limit.empty())
+        return default_size_limit << 20;
+    return std::strtoull(limit.c_str(), nullptr, 10) << 20;
+}
+
+bool ends_with(const std::string& string, const char* suffix) {
+    const std::size_t size = std::strlen(suffix);
+    return string.size() >= size &&
+           string.compare(string.size() - size, size, suffix) == 0;
+}
+}
+
+std::string libclang_vim::get_snapshot_directory() {
+    const std::string cache_directory = get_option("cache_directory");
+    if (cache_directory.empty())
+        return std::string();
+    return cache_directory + "/units";
+}
+
+bool libclang_vim::save_unit_snapshot(const std::string& directory,
+                                      const std::string& key,
+                                      const location_tuple& info,
+                                      CXTranslationUnit unit) {
+    if (!make_directories(directory))
+        return false;
+
+    const std::vector<std::string> dependencies = get_dependencies(unit);
+    const std::string diagnostics = stringize_diagnostics(unit);
+    std::string strings(key.c_str(), key.size() + 1);
+    strings.append(diagnostics.c_str(), diagnostics.size() + 1);
+    for (const auto& dependency : dependencies)
+        strings.append(dependency.c_str(), dependency.size() + 1);
+
+    snapshot_header header{};
+    std::memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+    header.version = unit_snapshot_version;
+    header.dependency_count = dependencies.size();
+    header.dependency_hash = hash_dependencies(dependencies, info);
+    header.string_table_size = strings.size();
+
+    // The AST file goes first, so a dependency file never describes an older
+    // one.
+    const std::string path = get_snapshot_path(directory, key);
+    const std::string ast_path = path + ast_suffix;
+    if (clang_saveTranslationUnit(unit, ast_path.c_str(),
+                                  clang_defaultSaveOptions(unit)) !=
+        CXSaveError_None)
+        return false;
+
+    const std::string dependencies_path = path + dependencies_suffix;
+    const std::string temporary_path =
+        dependencies_path + "." + std::to_string(getpid()) + ".tmp";
+    std::FILE* stream = std::fopen(temporary_path.c_str(), "wb");
+    if (!stream)
+        return false;
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, stream) == 1 &&
+              std::fwrite(strings.data(), 1, strings.size(), stream) ==
+                  strings.size();
+    ok = std::fclose(stream) == 0 && ok;
+    if (!ok ||
+        std::rename(temporary_path.c_str(), dependencies_path.c_str()) != 0) {
+        std::remove(temporary_path.c_str());
+        std::remove(ast_path.c_str());
+        return false;
+    }
+
+    evict_unit_snapshots(directory, get_size_limit());
+    return true;
+}
+
+bool libclang_vim::is_unit_snapshot_current(const std::string& directory,
+                                            const std::string& key,
+                                            const location_tuple& info,
+                                            std::string& diagnostics) {
+    unsaved_buffer stored = unsaved_buffer::map_file(
+        get_snapshot_path(directory, key) + dependencies_suffix);
+    if (stored.size() < sizeof(snapshot_header))
+        return false;
+
+    snapshot_header header;
+    std::memcpy(&header, stored.data(), sizeof(header));
+    if (std::memcmp(header.magic, snapshot_magic, sizeof(header.magic)) != 0 ||
+        header.version != unit_snapshot_version ||
+        sizeof(header) + header.string_table_size != stored.size() ||
+        stored.data()[stored.size() - 1] != '\0')
+        return false;
+
+    const char* position = stored.data() + sizeof(header);
+    const char* end = stored.data() + stored.size();
+    // Different key, just with the same hash.
+    if (key != position)
+        return false;
+    position += key.size() + 1;
+    if (position == end)
+        return false;
+    std::string stored_diagnostics = position;
+    position += stored_diagnostics.size() + 1;
+
+    std::vector<std::string> dependencies;
+    for (; position < end; position += dependencies.back().size() + 1)
+        dependencies.emplace_back(position);
+    if (dependencies.size() != header.dependency_count ||
+        hash_dependencies(dependencies, info) != header.dependency_hash)
+        return false;
+
+    diagnostics = std::move(stored_diagnostics);
+    return true;
+}
+
+CXTranslationUnit libclang_vim::load_unit_snapshot(const std::string& directory,
+                                                   const std::string& key,
+                                                   const location_tuple& info,
+                                                   CXIndex index,
+                                                   std::string& diagnostics) {
+    if (!is_unit_snapshot_current(directory, key, info, diagnostics))
+        return nullptr;
+
+    const std::string ast_path = get_snapshot_path(directory, key) + ast_suffix;
+    CXTranslationUnit unit = nullptr;
+    if (clang_createTranslationUnit2(index, ast_path.c_str(), &unit) !=
+        CXError_Success)
+        return nullptr;
+
+    // The modification time orders the snapshots for eviction.
+    utimes(ast_path.c_str(), nullptr);
+    return unit;
+}
+
+void libclang_vim::evict_unit_snapshots(const std::string& directory,
+                                        std::uint64_t max_size) {
+    struct snapshot_file {
+        std::string path;
+        std::uint64_t size;
+        std::uint64_t modified;
+    };
+
+    DIR* stream = opendir(directory.c_str());
+    if (!stream)
+        return;
+
+    std::vector<snapshot_file> snapshots;
+    std::uint64_t total_size = 0;
+    while (dirent* entry = readdir(stream)) {
+        const std::string name = entry->d_name;
+        if (!ends_with(name, ast_suffix))
+            continue;
+
+        const std::string path = directory + "/" + name;
+        struct stat st {};
+        if (stat(path.c_str(), &st) != 0)
+            continue;
+
+        snapshot_file snapshot;
+        snapshot.path = path.substr(0, path.size() - std::strlen(ast_suffix));
+        snapshot.size = st.st_size;
+#if defined __APPLE__
+        const std::uint64_t nanoseconds = st.st_mtimespec.tv_nsec;
+#else
+        const std::uint64_t nanoseconds = st.st_mtim.tv_nsec;
+#endif
+        snapshot.modified =
+            static_cast<std::uint64_t>(st.st_mtime) * 1000000000 + nanoseconds;
+        total_size += snapshot.size;
+        snapshots.push_back(snapshot);
+    }
+    closedir(stream);
+
+    std::sort(snapshots.begin(), snapshots.end(),
+              [](const snapshot_file& lhs, const snapshot_file& rhs) {
+                  return lhs.modified < rhs.modified;
+              });
+    for (const auto& snapshot : snapshots) {
+        if (total_size <= max_size)
+            break;
+
+        std::remove((snapshot.path + dependencies_suffix).c_str());
+        std::remove((snapshot.path + ast_suffix).c_str());
+        total_size -= snapshot.size;
+    }
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
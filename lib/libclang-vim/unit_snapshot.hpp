@@ -0,0 +1,51 @@
+#if !defined LIBCLANG_VIM_UNIT_SNAPSHOT_HPP_INCLUDED
+#define LIBCLANG_VIM_UNIT_SNAPSHOT_HPP_INCLUDED
+
+#include <cstdint>
+#include <string>
+
+#include <clang-c/Index.h>
+
+#include "helpers.hpp"
+
+namespace libclang_vim {
+
+/// Bump this when the layout of the snapshot dependency files changes.
+const std::uint32_t unit_snapshot_version = 1;
+
+/// Returns where translation units are saved, or an empty string if the
+/// cache_directory option is not set.
+std::string get_snapshot_directory();
+
+/// Saves unit, parsed from info, as the snapshot of key (a key of
+/// translation_unit_cache), then evicts the least recently used snapshots
+/// over the size limit.
+bool save_unit_snapshot(const std::string& directory, const std::string& key,
+                        const location_tuple& info, CXTranslationUnit unit);
+
+/// Tells if the snapshot of key exists and none of the files it was parsed
+/// from changed since. If so, sets diagnostics to the stringized diagnostics
+/// of the saved unit.
+bool is_unit_snapshot_current(const std::string& directory,
+                              const std::string& key,
+                              const location_tuple& info,
+                              std::string& diagnostics);
+
+/// Loads the snapshot of key if it's current. Returns nullptr otherwise. The
+/// loaded unit can't be reparsed, and its diagnostics are only available as
+/// a string.
+CXTranslationUnit load_unit_snapshot(const std::string& directory,
+                                     const std::string& key,
+                                     const location_tuple& info,
+                                     CXIndex index, std::string& diagnostics);
+
+/// Removes the least recently used snapshots in directory till the rest
+/// takes at most max_size bytes.
+void evict_unit_snapshots(const std::string& directory,
+                          std::uint64_t max_size);
+
+} // namespace libclang_vim
+
+#endif // LIBCLANG_VIM_UNIT_SNAPSHOT_HPP_INCLUDED
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,127 @@
+#include "unsaved_files.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+/// Returns the offset of the first byte of the 1-based line, counting from
+/// offset, which is the start of the 1st line.
+size_t get_line_offset(const std::string& contents, size_t offset,
+                       size_t line) {
+    for (; line > 1 && offset < contents.size(); --line) {
+        const void* newline = std::memchr(contents.data() + offset, '\n',
+                                          contents.size() - offset);
+        if (!newline)
+            return contents.size();
+        offset = static_cast<const char*>(newline) - contents.data() + 1;
+    }
+    return std::min(offset, contents.size());
+}
+}
+
+libclang_vim::unsaved_file_store::unsaved_file_store() { pin_library(); }
+
+void libclang_vim::unsaved_file_store::set(const std::string& file,
+                                           unsigned long version,
+                                           std::string contents) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    entry& stored = m_files[file];
+    stored.contents = std::make_shared<std::string>(std::move(contents));
+    stored.version = version;
+}
+
+bool libclang_vim::unsaved_file_store::patch(const std::string& file,
+                                             unsigned long version,
+                                             size_t first, size_t last,
+                                             const std::string& text) {
+    if (first < 1 || last < first)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_files.find(file);
+    if (it == m_files.end() || version <= it->second.version)
+        return false;
+
+    entry& stored = it->second;
+    // Someone still uses the old contents: copy them, otherwise the patch is
+    // applied in place.
+    if (stored.contents.use_count() > 1)
+        stored.contents = std::make_shared<std::string>(*stored.contents);
+
+    std::string& contents = *stored.contents;
+    size_t begin = get_line_offset(contents, 0, first);
+    size_t end = get_line_offset(contents, begin, last - first + 1);
+    contents.replace(begin, end - begin, text);
+    stored.version = version;
+    return true;
+}
+
+libclang_vim::unsaved_buffer
+libclang_vim::unsaved_file_store::get(const std::string& file) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_files.find(file);
+    if (it == m_files.end())
+        return unsaved_buffer();
+
+    return unsaved_buffer::from_string(it->second.contents);
+}
+
+std::vector<std::pair<std::string, libclang_vim::unsaved_buffer>>
+libclang_vim::unsaved_file_store::get_all() const {
+    std::vector<std::pair<std::string, unsaved_buffer>> files;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    files.reserve(m_files.size());
+    for (const auto& file : m_files)
+        files.emplace_back(file.first,
+                           unsaved_buffer::from_string(file.second.contents));
+    return files;
+}
+
+bool libclang_vim::unsaved_file_store::discard(const std::string& file) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_files.erase(file) > 0;
+}
+
+libclang_vim::unsaved_file_store& libclang_vim::get_unsaved_file_store() {
+    // Deliberately leaked, see get_thread_pool().
+    static unsaved_file_store& store = *new unsaved_file_store;
+    return store;
+}
+
+const char* libclang_vim::update_unsaved_file(const std::string& update) {
+    static std::string vimson;
+
+    const auto header_end = update.find('\n');
+    const std::string header = update.substr(0, header_end);
+    const std::string text = header_end == std::string::npos
+                                 ? std::string()
+                                 : update.substr(header_end + 1);
+    const auto file_end = header.find(':');
+    if (file_end == std::string::npos || file_end == 0)
+        return "{}";
+
+    const std::string file = header.substr(0, file_end);
+    unsigned long version;
+    size_t first, last;
+    const auto num_input = std::sscanf(header.c_str() + file_end + 1,
+                                       "%lu:%zu:%zu", &version, &first, &last);
+    if (num_input == 1)
+        get_unsaved_file_store().set(file, version, text);
+    else if (num_input != 3 ||
+             !get_unsaved_file_store().patch(file, version, first, last, text))
+        return "{}";
+
+    vimson = "{'version':" + std::to_string(version) + "}";
+    return vimson.c_str();
+}
+
+const char* libclang_vim::discard_unsaved_file(const std::string& file) {
+    if (!get_unsaved_file_store().discard(file))
+        return "{}";
+
+    return "{'discarded':1}";
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
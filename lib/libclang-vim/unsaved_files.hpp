@@ -0,0 +1,60 @@
+#if !defined LIBCLANG_VIM_UNSAVED_FILES_HPP_INCLUDED
+#define LIBCLANG_VIM_UNSAVED_FILES_HPP_INCLUDED
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "helpers.hpp"
+
+namespace libclang_vim {
+
+/// Last known contents of files whose buffers are sent to the library
+/// incrementally, so that a change only has to transfer the modified lines.
+class unsaved_file_store {
+    struct entry {
+        std::shared_ptr<std::string> contents;
+        unsigned long version = 0;
+    };
+
+    std::map<std::string, entry> m_files;
+    mutable std::mutex m_mutex;
+
+  public:
+    unsaved_file_store();
+
+    /// Replaces the contents of file.
+    void set(const std::string& file, unsigned long version,
+             std::string contents);
+
+    /// Replaces lines [first, last) of file with text, which is expected to
+    /// have a trailing newline unless empty. Fails if file is unknown or
+    /// version is not newer than the one of the stored contents.
+    bool patch(const std::string& file, unsigned long version, size_t first,
+               size_t last, const std::string& text);
+
+    /// Returns the contents of file, or an empty buffer if it's unknown.
+    unsaved_buffer get(const std::string& file) const;
+
+    /// Returns the names and contents of all files.
+    std::vector<std::pair<std::string, unsaved_buffer>> get_all() const;
+
+    /// Forgets file, e.g. because its buffer was saved or closed.
+    bool discard(const std::string& file);
+};
+
+unsaved_file_store& get_unsaved_file_store();
+
+/// Parse "file:version[:first:last]\ntext" and apply it to the store.
+const char* update_unsaved_file(const std::string& update);
+
+/// Remove file from the store, so that its contents are read from disk again.
+const char* discard_unsaved_file(const std::string& file);
+
+} // namespace libclang_vim
+
+#endif // LIBCLANG_VIM_UNSAVED_FILES_HPP_INCLUDED
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -8,10 +8,12 @@ class ast_test : public CPPUNIT_NS::TestFixture {
     CPPUNIT_TEST_SUITE(ast_test);
     CPPUNIT_TEST(test_extract_declarations_current_file);
     CPPUNIT_TEST(test_unsaved_extract_declarations_current_file);
+    CPPUNIT_TEST(test_extract_cached_per_api);
     CPPUNIT_TEST_SUITE_END();
 
     void test_extract_declarations_current_file();
     void test_unsaved_extract_declarations_current_file();
+    void test_extract_cached_per_api();
 
     void* m_handle = nullptr;
 
@@ -63,6 +65,27 @@ void ast_test::test_unsaved_extract_declarations_current_file() {
     CPPUNIT_ASSERT(actual != "{'root':[]}");
 }
 
+void ast_test::test_extract_cached_per_api() {
+    auto vim_clang_extract_definitions_current_file =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_extract_definitions_current_file"));
+    assert(vim_clang_extract_definitions_current_file);
+    auto vim_clang_extract_static_member_functions_current_file =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle,
+                  "vim_clang_extract_static_member_functions_current_file"));
+    assert(vim_clang_extract_static_member_functions_current_file);
+
+    // Both predicates are plain functions of the same type, but the results
+    // are cached separately.
+    std::string actual(vim_clang_extract_definitions_current_file(
+        "qa/data/hierarchy/circle.cpp:"));
+    CPPUNIT_ASSERT(actual.find("'children'") != std::string::npos);
+    actual = vim_clang_extract_static_member_functions_current_file(
+        "qa/data/hierarchy/circle.cpp:");
+    CPPUNIT_ASSERT_EQUAL(std::string("{'root':[]}"), actual);
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(ast_test);
 
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,496 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+/// Benchmarks the entry points of the library on a generated project, the
+/// same way as Vimscript calls them via libcall(). Prints one JSON object per
+/// line, so that runs of different commits can be compared by a script.
+
+namespace {
+
+typedef char const* (*function_type)(char const*);
+
+/// Size of the generated project.
+class generator_options {
+  public:
+    /// Number of headers, each including the previous one.
+    unsigned headers = 32;
+    /// Depth of the recursive template instantiated by each header.
+    unsigned template_depth = 256;
+    /// Number of statements in the long function of each source file.
+    unsigned function_length = 2000;
+    /// Number of macro generated member functions per header.
+    unsigned macros = 100;
+    /// Number of source files in the compilation database.
+    unsigned units = 8;
+
+    generator_options();
+};
+
+generator_options::generator_options() = default;
+
+/// A generated project in a temporary directory.
+class project {
+  public:
+    std::string directory;
+    std::string args;
+    /// Contents of each source file.
+    std::string source;
+    std::size_t lines = 0;
+    /// Location of a use of a local variable in the long function.
+    unsigned use_line = 0;
+    unsigned use_column = 0;
+
+    project();
+};
+
+project::project() = default;
+
+void write_file(const std::string& path, const std::string& contents) {
+    std::ofstream stream(path.c_str());
+    stream << contents;
+}
+
+std::string generate_header(const generator_options& options, unsigned i) {
+    std::stringstream ss;
+    ss << "#pragma once\n";
+    if (i > 0)
+        ss << "#include \"h" << i - 1 << ".hpp\"\n";
+    else
+        ss << "#include <map>\n#include <string>\n#include <vector>\n";
+    ss << "\nnamespace bench" << i << " {\n\n";
+    ss << "template <int N> struct depth {\n"
+          "    static const int value = depth<N - 1>::value + 1;\n"
+          "};\n"
+          "template <> struct depth<0> {\n"
+          "    static const int value = 0;\n"
+          "};\n\n";
+    ss << "#define BENCH" << i << "_GETTER(name) \\\n"
+       << "    int get_##name() const { return name; } \\\n"
+       << "    void set_##name(int value) { name = value; }\n\n";
+    ss << "class widget {\n";
+    for (unsigned j = 0; j < options.macros; ++j)
+        ss << "    int m" << j << " = " << j << ";\n";
+    ss << "\n  public:\n";
+    for (unsigned j = 0; j < options.macros; ++j)
+        ss << "    BENCH" << i << "_GETTER(m" << j << ")\n";
+    ss << "    virtual ~widget() = default;\n"
+          "    virtual int area() const = 0;\n"
+          "    static widget* make();\n"
+          "    std::vector<std::string> names;\n"
+          "};\n\n";
+    ss << "inline int deep() { return depth<" << options.template_depth
+       << ">::value; }\n\n";
+    ss << "} // namespace bench" << i << "\n";
+    return ss.str();
+}
+
+/// Generates the source of a unit: a long function using all headers.
+void generate_source(const generator_options& options, project& generated) {
+    std::stringstream ss;
+    ss << "#include \"h" << options.headers - 1 << ".hpp\"\n\n";
+    ss << "int compute(int seed) {\n";
+    ss << "    auto total = seed;\n";
+    unsigned line = 5;
+    for (unsigned k = 0; k < options.function_length; ++k, line += 2) {
+        ss << "    auto v" << k << " = total + bench" << k % options.headers
+           << "::deep();\n";
+        ss << "    total += v" << k << " % 7;\n";
+        if (k == options.function_length / 2) {
+            generated.use_line = line + 1;
+            generated.use_column = 14;
+        }
+    }
+    ss << "    return total;\n}\n\nint main() { return compute(1); }\n";
+    generated.source = ss.str();
+    generated.lines =
+        std::count(generated.source.begin(), generated.source.end(), '\n');
+}
+
+bool generate(const generator_options& options, project& generated) {
+    char directory[] = "/tmp/libclang-vim-bench-XXXXXX";
+    if (!mkdtemp(directory))
+        return false;
+
+    generated.directory = directory;
+    generated.args = "-std=c++11 -I" + generated.directory + "/include";
+    const std::string include = generated.directory + "/include";
+    if (mkdir(include.c_str(), 0700) != 0)
+        return false;
+    for (unsigned i = 0; i < options.headers; ++i)
+        write_file(include + "/h" + std::to_string(i) + ".hpp",
+                   generate_header(options, i));
+    generate_source(options, generated);
+
+    std::string database = "[\n";
+    for (unsigned i = 0; i < options.units; ++i) {
+        const std::string unit =
+            generated.directory + "/unit" + std::to_string(i) + ".cpp";
+        write_file(unit, generated.source);
+        database += std::string(i ? ",\n" : "") + "{\"directory\":\"" +
+                    generated.directory + "\",\"command\":\"clang++ " +
+                    generated.args + " -c " + unit + "\",\"file\":\"" + unit +
+                    "\"}";
+    }
+    database += "\n]\n";
+    write_file(generated.directory + "/compile_commands.json", database);
+    return true;
+}
+
+/// How an entry point is called.
+enum class input_kind {
+    /// "file:args", on a file not parsed before.
+    file,
+    /// "file:args:line:col", on a file not parsed before.
+    location,
+    /// "file:args:1:12", on the #include of a file not parsed before.
+    include,
+    /// "file:", on a file not parsed before.
+    file_without_args,
+    /// A file name without arguments.
+    file_name,
+    /// "@directory" for the compilation database, then polled until done.
+    sweep,
+    index,
+    /// Same as index, with the cache_directory option set, so that the warm
+    /// calls load the index shards written by the cold one.
+    index_shards,
+    /// "@directory" for the compilation database, with the cache_directory
+    /// option set to a directory in the project.
+    pch,
+    /// A fixed string.
+    fixed
+};
+
+class entry_point {
+  public:
+    std::string name;
+    /// Name in the results, to tell apart the runs of the same entry point.
+    std::string label;
+    input_kind kind;
+    /// Input of fixed entry points.
+    const char* input;
+    /// Name of the entry point reporting the progress of sweep and index.
+    const char* poll;
+
+    entry_point(std::string name, input_kind kind, const char* input = "",
+                const char* poll = "");
+};
+
+entry_point::entry_point(std::string name, input_kind kind, const char* input,
+                         const char* poll)
+    : name(name), label(name), kind(kind), input(input), poll(poll) {}
+
+std::vector<entry_point> get_entry_points() {
+    std::vector<entry_point> entry_points;
+    // Builds the precompiled header first and removes it right away, so that
+    // it doesn't speed up the rest.
+    entry_points.emplace_back("vim_clang_build_shared_pch", input_kind::pch);
+    entry_points.emplace_back("vim_clang_clear_shared_pch", input_kind::fixed);
+    entry_points.emplace_back("vim_clang_start_diagnostics_sweep",
+                              input_kind::sweep, "",
+                              "vim_clang_poll_diagnostics_sweep");
+    entry_points.emplace_back("vim_clang_start_indexing", input_kind::index, "",
+                              "vim_clang_poll_indexing");
+    entry_points.emplace_back("vim_clang_start_indexing",
+                              input_kind::index_shards, "",
+                              "vim_clang_poll_indexing");
+    entry_points.back().label = "vim_clang_start_indexing_from_shards";
+    entry_points.emplace_back("vim_clang_search_workspace_symbols",
+                              input_kind::fixed, "100:widget");
+
+    entry_points.emplace_back("vim_clang_tokens", input_kind::file);
+    entry_points.emplace_back("vim_clang_get_diagnostics", input_kind::file);
+    for (const char* what :
+         {"all", "declarations", "attributes", "expressions", "preprocessings",
+          "references", "statements", "translation_units", "definitions",
+          "virtual_member_functions", "pure_virtual_member_functions",
+          "static_member_functions"}) {
+        for (const char* where : {"", "_current_file", "_non_system_headers"})
+            entry_points.emplace_back(
+                std::string("vim_clang_extract_") + what + where,
+                input_kind::file);
+    }
+
+    for (const char* name :
+         {"vim_clang_get_location_information",
+          "vim_clang_get_extent_of_node_at_specific_location",
+          "vim_clang_get_all_extents_at", "vim_clang_get_references_in_file_at",
+          "vim_clang_get_type_with_deduction_at",
+          "vim_clang_get_canonical_type_at", "vim_clang_get_result_type_at",
+          "vim_clang_get_pointee_type_at",
+          "vim_clang_get_class_type_of_member_pointer_at",
+          "vim_clang_get_declaration_at", "vim_clang_get_definition_at",
+          "vim_clang_get_referenced_at", "vim_clang_deduce_var_decl_at",
+          "vim_clang_deduce_func_decl_at",
+          "vim_clang_deduce_func_or_var_decl_at",
+          "vim_clang_get_current_function_at", "vim_clang_get_full_name_at",
+          "vim_clang_get_comment_at", "vim_clang_get_deduced_declaration_at",
+          "vim_clang_get_hover_at", "vim_clang_get_completion_at",
+          "vim_clang_get_indexed_definitions_at",
+          "vim_clang_get_indexed_declarations_at",
+          "vim_clang_get_indexed_references_at"})
+        entry_points.emplace_back(name, input_kind::location);
+    for (const char* what :
+         {"inner_definition", "namespace", "class", "function", "parameter",
+          "statement", "expression"})
+        entry_points.emplace_back(std::string("vim_clang_get_") + what +
+                                      "_extent_at_specific_location",
+                                  input_kind::location);
+    entry_points.emplace_back("vim_clang_get_include_at", input_kind::include);
+
+    entry_points.emplace_back("vim_clang_get_compile_commands",
+                              input_kind::file_without_args);
+    entry_points.emplace_back("vim_clang_get_inclusions",
+                              input_kind::file_name);
+    entry_points.emplace_back("vim_clang_get_includers", input_kind::file_name);
+    entry_points.emplace_back("vim_clang_get_translation_unit_usage",
+                              input_kind::fixed);
+    entry_points.emplace_back("vim_clang_stats", input_kind::fixed);
+    return entry_points;
+}
+
+long long get_microseconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration)
+        .count();
+}
+
+/// Returns the current resident set size in kilobytes, so that the growth
+/// caused by one entry point can be told apart from the earlier ones.
+long get_rss() {
+    std::ifstream statm("/proc/self/statm");
+    long size = 0;
+    long resident = 0;
+    if (!(statm >> size >> resident))
+        return 0;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/// Returns the peak resident set size of the whole process in kilobytes.
+long get_peak_rss() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    // In kilobytes on Linux.
+    return usage.ru_maxrss;
+}
+
+/// Returns the value of "'name':value" in vimson, or -1.
+long get_number(const std::string& vimson, const std::string& name) {
+    const std::string key = "'" + name + "':";
+    const auto pos = vimson.find(key);
+    if (pos == std::string::npos)
+        return -1;
+    return std::atol(vimson.c_str() + pos + key.size());
+}
+
+/// Calls function with input, and waits until poll reports that all of the
+/// started work is done, if given.
+void call(function_type function, function_type poll,
+          const std::string& input) {
+    const std::string started = function(input.c_str());
+    if (!poll)
+        return;
+
+    const long total = get_number(started, "total");
+    while (get_number(poll(""), "done") < total)
+        usleep(1000);
+}
+
+long long get_percentile(std::vector<long long> sorted, unsigned percent) {
+    if (sorted.empty())
+        return 0;
+    std::sort(sorted.begin(), sorted.end());
+    const std::size_t rank = (sorted.size() * percent + 99) / 100;
+    return sorted[std::max<std::size_t>(rank, 1) - 1];
+}
+
+void usage(const char* program) {
+    std::cerr
+        << "Usage: " << program << " [options]\n\n"
+        << "Options:\n"
+        << "  --headers N    number of chained headers (32)\n"
+        << "  --depth N      depth of the template of each header (256)\n"
+        << "  --lines N      statements of the long function (2000)\n"
+        << "  --macros N     macro generated members per header (100)\n"
+        << "  --units N      files in the compilation database (8)\n"
+        << "  --repeat N     warm calls per entry point (10)\n"
+        << "  --filter TEXT  only benchmark entry points containing TEXT\n"
+        << "  --keep         keep the generated project\n";
+}
+}
+
+int main(int argc, char** argv) {
+    generator_options options;
+    unsigned repeat = 10;
+    std::string filter;
+    bool keep = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--keep") {
+            keep = true;
+            continue;
+        }
+        if (i + 1 == argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--headers")
+            options.headers = std::max(1, std::atoi(value));
+        else if (arg == "--depth")
+            options.template_depth = std::atoi(value);
+        else if (arg == "--lines")
+            options.function_length = std::max(1, std::atoi(value));
+        else if (arg == "--macros")
+            options.macros = std::atoi(value);
+        else if (arg == "--units")
+            options.units = std::max(1, std::atoi(value));
+        else if (arg == "--repeat")
+            repeat = std::atoi(value);
+        else if (arg == "--filter")
+            filter = value;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    void* handle = dlopen(SRC_ROOT "/lib/libclang-vim.so", RTLD_NOW);
+    if (!handle) {
+        std::cerr << "dlopen() failed: " << dlerror() << std::endl;
+        return 1;
+    }
+
+    project generated;
+    if (!generate(options, generated)) {
+        std::cerr << "failed to generate the project" << std::endl;
+        return 1;
+    }
+
+    auto version = reinterpret_cast<function_type>(
+        dlsym(handle, "vim_clang_version"));
+    std::cout << "{\"clang\":\"" << version("") << "\",\"headers\":"
+              << options.headers << ",\"depth\":" << options.template_depth
+              << ",\"lines\":" << generated.lines
+              << ",\"bytes\":" << generated.source.size()
+              << ",\"units\":" << options.units << ",\"repeat\":" << repeat
+              << "}" << std::endl;
+
+    auto set_option = reinterpret_cast<function_type>(
+        dlsym(handle, "vim_clang_set_option"));
+    const auto start = std::chrono::steady_clock::now();
+    const std::vector<entry_point> entry_points = get_entry_points();
+    for (std::size_t i = 0; i < entry_points.size(); ++i) {
+        const entry_point& entry = entry_points[i];
+        if (entry.label.find(filter) == std::string::npos)
+            continue;
+
+        auto function =
+            reinterpret_cast<function_type>(dlsym(handle, entry.name.c_str()));
+        if (!function) {
+            std::cerr << "missing entry point: " << entry.name << std::endl;
+            return 1;
+        }
+        function_type poll = nullptr;
+        if (*entry.poll)
+            poll = reinterpret_cast<function_type>(dlsym(handle, entry.poll));
+
+        // Each entry point gets its own copy of the source, so that its first
+        // call is a cold parse.
+        const std::string file =
+            generated.directory + "/api" + std::to_string(i) + ".cpp";
+        write_file(file, generated.source);
+        std::string input;
+        switch (entry.kind) {
+        case input_kind::file:
+            input = file + ":" + generated.args;
+            break;
+        case input_kind::location:
+            input = file + ":" + generated.args + ":" +
+                    std::to_string(generated.use_line) + ":" +
+                    std::to_string(generated.use_column);
+            break;
+        case input_kind::include:
+            input = file + ":" + generated.args + ":1:12";
+            break;
+        case input_kind::file_without_args:
+            input = file + ":";
+            break;
+        case input_kind::file_name:
+            input = file;
+            break;
+        case input_kind::sweep:
+        case input_kind::index:
+        case input_kind::index_shards:
+        case input_kind::pch:
+            input = "@" + generated.directory;
+            break;
+        case input_kind::fixed:
+            input = entry.input;
+            break;
+        }
+
+        if (entry.kind == input_kind::pch ||
+            entry.kind == input_kind::index_shards)
+            set_option(
+                ("cache_directory=" + generated.directory + "/cache").c_str());
+        const long rss_before = get_rss();
+        auto begin = std::chrono::steady_clock::now();
+        call(function, poll, input);
+        const long long cold =
+            get_microseconds(std::chrono::steady_clock::now() - begin);
+
+        // Whole project runs are slow, a few of them are enough.
+        const unsigned runs = poll ? std::min(repeat, 3U) : repeat;
+        std::vector<long long> warm;
+        for (unsigned run = 0; run < runs; ++run) {
+            begin = std::chrono::steady_clock::now();
+            call(function, poll, input);
+            warm.push_back(
+                get_microseconds(std::chrono::steady_clock::now() - begin));
+        }
+        if (entry.kind == input_kind::pch ||
+            entry.kind == input_kind::index_shards)
+            set_option("cache_directory=");
+        long long warm_total = 0;
+        for (long long sample : warm)
+            warm_total += sample;
+
+        std::cout << "{\"api\":\"" << entry.label << "\",\"cold_us\":" << cold
+                  << ",\"warm_p50_us\":" << get_percentile(warm, 50)
+                  << ",\"warm_p95_us\":" << get_percentile(warm, 95)
+                  << ",\"warm_p99_us\":" << get_percentile(warm, 99)
+                  << ",\"warm_calls_per_s\":"
+                  << (warm_total ? warm.size() * 1000000.0 / warm_total : 0)
+                  << ",\"cold_lines_per_s\":"
+                  << (cold ? generated.lines * (poll ? options.units : 1) *
+                                 1000000.0 / cold
+                           : 0)
+                  << ",\"rss_growth_kb\":" << get_rss() - rss_before << "}"
+                  << std::endl;
+    }
+    std::cout << "{\"total_us\":"
+              << get_microseconds(std::chrono::steady_clock::now() - start)
+              << ",\"peak_rss_kb\":" << get_peak_rss() << "}" << std::endl;
+
+    if (!keep) {
+        std::string command = "rm -rf " + generated.directory;
+        if (std::system(command.c_str()) != 0)
+            return 1;
+    } else
+        std::cerr << "kept " << generated.directory << std::endl;
+
+    dlclose(handle);
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
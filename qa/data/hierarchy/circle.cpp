@@ -0,0 +1,9 @@
+#include "shape.hpp"
+
+struct circle : shape {
+    int area() const override { return 3; }
+};
+
+struct unit_circle : circle {
+    int area() const override { return 1; }
+};
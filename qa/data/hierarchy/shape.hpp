@@ -0,0 +1,4 @@
+struct shape {
+    virtual ~shape() {}
+    virtual int area() const = 0;
+};
@@ -0,0 +1,5 @@
+#include "shape.hpp"
+
+struct square : shape {
+    int area() const override { return 4; }
+};
@@ -0,0 +1,10 @@
+namespace geometry {
+
+/// Scales a length.
+///
+/// The "factor" is applied as is.
+double scale(double length, int factor) { return length * factor; }
+
+} // namespace geometry
+
+double twice(double length) { return geometry::scale(length, 2); }
@@ -0,0 +1,3 @@
+#include "b.hpp"
+
+inline int get_a() { return 1; }
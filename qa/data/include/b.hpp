@@ -0,0 +1 @@
+inline int get_b() { return 2; }
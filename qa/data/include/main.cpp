@@ -0,0 +1,3 @@
+#include "a.hpp"
+
+int main() { return get_b() + get_a(); }
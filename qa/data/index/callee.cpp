@@ -0,0 +1 @@
+int get_answer() { return 42; }
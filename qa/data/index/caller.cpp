@@ -0,0 +1,3 @@
+int get_answer();
+
+int main() { return get_answer(); }
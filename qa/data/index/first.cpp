@@ -0,0 +1,3 @@
+#include "shared.hpp"
+
+int first_user() { return get_header_value(); }
@@ -0,0 +1,3 @@
+#include "shared.hpp"
+
+int second_user() { return get_header_value(); }
@@ -0,0 +1,3 @@
+#pragma once
+
+inline int get_header_value() { return 1; }
@@ -0,0 +1,16 @@
+struct point {
+    int x;
+    double y;
+};
+
+auto make_point() { return point{1, 2.0}; }
+
+int main() {
+    auto p = make_point();
+    const auto& x = p.x;
+    auto [a, b] = p;
+    auto twice = [](auto value) { return value * 2; };
+    for (auto i = 0; i < 3; ++i)
+        twice(i);
+    return x + a;
+}
@@ -0,0 +1,3 @@
+#include "widget.hpp"
+
+int main() { return owned::make_widget(); }
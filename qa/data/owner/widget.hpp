@@ -0,0 +1,9 @@
+#if defined OWNED
+namespace owned {
+#endif
+
+inline int make_widget() { return 0; }
+
+#if defined OWNED
+}
+#endif
@@ -0,0 +1,3 @@
+#pragma once
+
+inline int common() { return 1; }
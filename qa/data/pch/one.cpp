@@ -0,0 +1,4 @@
+// The first user of common.hpp.
+#include "common.hpp"
+
+int one() { return common(); }
@@ -0,0 +1,3 @@
+#include "common.hpp"
+
+int two() { return common() + 1; }
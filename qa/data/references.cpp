@@ -0,0 +1,5 @@
+int counter = 0;
+
+int increment() { return ++counter; }
+
+int main() { counter = increment(); }
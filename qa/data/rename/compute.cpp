@@ -0,0 +1,3 @@
+#include "widget.hpp"
+
+int compute(int value) { return value + 1; }
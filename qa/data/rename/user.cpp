@@ -0,0 +1,3 @@
+#include "widget.hpp"
+
+int main() { return twice(1); }
@@ -0,0 +1,5 @@
+#pragma once
+
+int compute(int value);
+
+inline int twice(int value) { return compute(value) * 2; }
@@ -1,7 +1,9 @@
 #include <cassert>
 #include <cppunit/extensions/HelperMacros.h>
 #include <dlfcn.h>
+#include <fcntl.h>
 #include <iostream>
+#include <sys/mman.h>
 #include <unistd.h>
 
 class deduction_test : public CPPUNIT_NS::TestFixture {
@@ -19,11 +21,15 @@ class deduction_test : public CPPUNIT_NS::TestFixture {
     CPPUNIT_TEST(test_declaration_at);
     CPPUNIT_TEST(test_unsaved_declaration_at);
     CPPUNIT_TEST(test_compile_commands);
+    CPPUNIT_TEST(test_compile_commands_owner);
     CPPUNIT_TEST(test_include_at);
     CPPUNIT_TEST(test_unsaved_include_at);
     CPPUNIT_TEST(test_diagnostics);
     CPPUNIT_TEST(test_unsaved_diagnostics);
+    CPPUNIT_TEST(test_shared_memory_diagnostics);
     CPPUNIT_TEST(test_full_name_at);
+    CPPUNIT_TEST(test_inlay_hints);
+    CPPUNIT_TEST(test_hover_at);
     CPPUNIT_TEST_SUITE_END();
 
     void test_get_type_with_deduction_at();
@@ -39,11 +45,15 @@ class deduction_test : public CPPUNIT_NS::TestFixture {
     void test_declaration_at();
     void test_unsaved_declaration_at();
     void test_compile_commands();
+    void test_compile_commands_owner();
     void test_include_at();
     void test_unsaved_include_at();
     void test_diagnostics();
     void test_unsaved_diagnostics();
+    void test_shared_memory_diagnostics();
     void test_full_name_at();
+    void test_inlay_hints();
+    void test_hover_at();
 
     void* m_handle = nullptr;
 
@@ -258,6 +268,32 @@ void deduction_test::test_compile_commands() {
     CPPUNIT_ASSERT_EQUAL(expected, actual);
 }
 
+void deduction_test::test_compile_commands_owner() {
+    auto vim_clang_get_compile_commands =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_compile_commands"));
+    assert(vim_clang_get_compile_commands);
+    auto vim_clang_get_diagnostics =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_diagnostics"));
+    assert(vim_clang_get_diagnostics);
+
+    // Let the include graph know that test.cpp includes test.hpp.
+    vim_clang_get_diagnostics(SRC_ROOT
+                              "/qa/data/compile-commands/test.cpp:-I" SRC_ROOT
+                              "/qa/data/compile-commands");
+    std::string actual(vim_clang_get_compile_commands(
+        SRC_ROOT "/qa/data/compile-commands/test.hpp:"));
+    CPPUNIT_ASSERT(actual.find(" -DFOO ") != std::string::npos);
+    CPPUNIT_ASSERT(actual.find("test.hpp") == std::string::npos);
+    std::string expected_owner(",'owner':'" SRC_ROOT
+                               "/qa/data/compile-commands/test.cpp'}");
+    CPPUNIT_ASSERT(actual.size() > expected_owner.size());
+    CPPUNIT_ASSERT_EQUAL(
+        expected_owner,
+        actual.substr(actual.size() - expected_owner.size()));
+}
+
 void deduction_test::test_include_at() {
     auto vim_clang_get_include_at =
         reinterpret_cast<char const* (*)(char const*)>(
@@ -318,6 +354,31 @@ void deduction_test::test_unsaved_diagnostics() {
     CPPUNIT_ASSERT_EQUAL(expected, actual);
 }
 
+void deduction_test::test_shared_memory_diagnostics() {
+    auto vim_clang_get_diagnostics =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_diagnostics"));
+    assert(vim_clang_get_diagnostics);
+
+    const char* segment = "/libclang-vim-test";
+    const std::string contents("int main() { int i = 0; }\n");
+    int fd = shm_open(segment, O_CREAT | O_RDWR | O_TRUNC, 0600);
+    CPPUNIT_ASSERT(fd >= 0);
+    CPPUNIT_ASSERT_EQUAL(static_cast<ssize_t>(contents.size()),
+                         write(fd, contents.data(), contents.size()));
+    close(fd);
+
+    std::string expected("[{'severity': 'warning', "
+                         "'line':1,'column':18,'offset':17,'file':'qa/data/"
+                         "unsaved/diagnostics.cpp',}, ]");
+    std::string actual(vim_clang_get_diagnostics(
+        "qa/data/unsaved/diagnostics.cpp#shm=/libclang-vim-test:-Wunused-"
+        "variable"));
+    shm_unlink(segment);
+    // The on-disk file is empty, so this is "[]" if the segment is ignored.
+    CPPUNIT_ASSERT_EQUAL(expected, actual);
+}
+
 void deduction_test::test_full_name_at() {
     auto vim_clang_get_full_name_at =
         reinterpret_cast<char const* (*)(char const*)>(
@@ -330,6 +391,64 @@ void deduction_test::test_full_name_at() {
     CPPUNIT_ASSERT_EQUAL(expected, actual);
 }
 
+void deduction_test::test_inlay_hints() {
+    auto vim_clang_get_inlay_hints =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_inlay_hints"));
+    assert(vim_clang_get_inlay_hints);
+
+    std::string actual(
+        vim_clang_get_inlay_hints("qa/data/inlay-hints.cpp:-std=c++1z:1:16"));
+    CPPUNIT_ASSERT(actual.find("{'line':6,'column':1,'kind':'return','name':"
+                               "'make_point','type':'point',") !=
+                   std::string::npos);
+    CPPUNIT_ASSERT(actual.find("{'line':9,'column':5,'kind':'variable','name'"
+                               ":'p','type':'point',") != std::string::npos);
+    CPPUNIT_ASSERT(actual.find("{'line':10,'column':11,'kind':'variable','"
+                               "name':'x','type':'const int &',") !=
+                   std::string::npos);
+    CPPUNIT_ASSERT(actual.find("{'line':11,'column':5,'kind':'binding','name'"
+                               ":'[a, b]','type':'point',") !=
+                   std::string::npos);
+    CPPUNIT_ASSERT(actual.find("{'line':13,'column':10,'kind':'variable','"
+                               "name':'i','type':'int',") != std::string::npos);
+    // The parameter of the generic lambda has no hint.
+    CPPUNIT_ASSERT(actual.find("'line':12,'column':21") == std::string::npos);
+
+    // Only the given lines.
+    actual =
+        vim_clang_get_inlay_hints("qa/data/inlay-hints.cpp:-std=c++1z:10:10");
+    CPPUNIT_ASSERT_EQUAL(0, actual.compare(0, 12, "[{'line':10,"));
+    CPPUNIT_ASSERT_EQUAL(std::string::npos, actual.find("'line':11"));
+}
+
+void deduction_test::test_hover_at() {
+    auto vim_clang_get_hover_at =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_hover_at"));
+    assert(vim_clang_get_hover_at);
+
+    // The full comment spans lines and has quotes.
+    std::string expected(
+        "{'type':'double (double, int)','type_kind':'FunctionProto','"
+        "canonical':{'type':'double (double, int)','type_kind':'"
+        "FunctionProto',},'name':'geometry::scale','brief':\"Scales a "
+        "length.\",'comment':\"/// Scales a length.\\n///\\n/// The "
+        "\\\"factor\\\" is applied as is.\",'declaration':{'file':'qa/data/"
+        "hover.cpp','line':'6','col':'8',},'parameters':[{'name':'length','"
+        "type':'double','type_kind':'Double','is_POD_type':1,},{'name':'"
+        "factor','type':'int','type_kind':'Int','is_POD_type':1,},],}");
+    std::string actual(
+        vim_clang_get_hover_at("qa/data/hover.cpp:-std=c++1y:10:48"));
+    CPPUNIT_ASSERT_EQUAL(expected, actual);
+
+    // Same as vim_clang_get_full_name_at.
+    actual = vim_clang_get_hover_at(
+        "qa/data/current-function.cpp:-std=c++1y:37:8");
+    CPPUNIT_ASSERT(actual.find("'name':'E::foo','brief':\"This is foo.\",") !=
+                   std::string::npos);
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(deduction_test);
 
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
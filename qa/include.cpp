@@ -0,0 +1,175 @@
+#include <cassert>
+#include <climits>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+
+class include_test : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE(include_test);
+    CPPUNIT_TEST(test_include_graph);
+    CPPUNIT_TEST(test_header_owner);
+    CPPUNIT_TEST(test_header_change);
+    CPPUNIT_TEST_SUITE_END();
+
+    void test_include_graph();
+    void test_header_owner();
+    void test_header_change();
+
+    void* m_handle = nullptr;
+
+  public:
+    include_test();
+    include_test(const include_test&) = delete;
+    include_test& operator=(const include_test&) = delete;
+
+    void setUp() override;
+    void tearDown() override;
+};
+
+include_test::include_test() = default;
+
+void include_test::setUp() {
+    m_handle = dlopen("lib/libclang-vim.so", RTLD_NOW);
+    if (!m_handle) {
+        std::stringstream ss;
+        ss << "dlopen() failed: ";
+        ss << dlerror();
+        CPPUNIT_FAIL(ss.str());
+    }
+}
+
+void include_test::tearDown() {
+    if (m_handle)
+        dlclose(m_handle);
+}
+
+void include_test::test_include_graph() {
+    auto vim_clang_get_diagnostics =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_diagnostics"));
+    assert(vim_clang_get_diagnostics);
+    auto vim_clang_get_inclusions =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_inclusions"));
+    assert(vim_clang_get_inclusions);
+    auto vim_clang_get_includers =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_includers"));
+    assert(vim_clang_get_includers);
+    auto vim_clang_invalidate_dependents =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_invalidate_dependents"));
+    assert(vim_clang_invalidate_dependents);
+
+    char buffer[PATH_MAX];
+    CPPUNIT_ASSERT(getcwd(buffer, sizeof(buffer)));
+    const std::string directory = std::string(buffer) + "/qa/data/include/";
+
+    // Nothing is known before the first parse.
+    CPPUNIT_ASSERT_EQUAL(
+        std::string("{'files':[],'units':[]}"),
+        std::string(vim_clang_get_includers("qa/data/include/b.hpp")));
+
+    vim_clang_get_diagnostics("qa/data/include/main.cpp:");
+
+    std::string expected = "[{'file':'" + directory +
+                           "a.hpp','included_from':'" + directory +
+                           "main.cpp','line':1},{'file':'" + directory +
+                           "b.hpp','included_from':'" + directory +
+                           "a.hpp','line':1},]";
+    CPPUNIT_ASSERT_EQUAL(
+        expected,
+        std::string(vim_clang_get_inclusions("qa/data/include/main.cpp")));
+
+    expected = "{'files':['" + directory + "a.hpp',],'units':['" + directory +
+               "main.cpp',]}";
+    CPPUNIT_ASSERT_EQUAL(
+        expected,
+        std::string(vim_clang_get_includers("qa/data/include/b.hpp")));
+
+    // The unit including b.hpp and its cached diagnostics are out of date.
+    CPPUNIT_ASSERT_EQUAL(
+        std::string("{'translation_units':1,'results':1}"),
+        std::string(vim_clang_invalidate_dependents("qa/data/include/b.hpp")));
+    CPPUNIT_ASSERT_EQUAL(
+        std::string("{'translation_units':1,'results':0}"),
+        std::string(vim_clang_invalidate_dependents("qa/data/include/b.hpp")));
+}
+
+void include_test::test_header_owner() {
+    auto vim_clang_get_diagnostics =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_diagnostics"));
+    assert(vim_clang_get_diagnostics);
+    auto vim_clang_get_full_name_at =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_full_name_at"));
+    assert(vim_clang_get_full_name_at);
+    auto vim_clang_set_option = reinterpret_cast<char const* (*)(char const*)>(
+        dlsym(m_handle, "vim_clang_set_option"));
+    assert(vim_clang_set_option);
+
+    // Parsed on its own, the header doesn't know about OWNED.
+    CPPUNIT_ASSERT_EQUAL(std::string("{'name':'make_widget'}"),
+                         std::string(vim_clang_get_full_name_at(
+                             "qa/data/owner/widget.hpp:-std=c++1y:5:12")));
+
+    vim_clang_get_diagnostics("qa/data/owner/main.cpp:-DOWNED");
+    CPPUNIT_ASSERT_EQUAL(std::string("{'ok':1}"),
+                         std::string(vim_clang_set_option("header_owners=1")));
+    CPPUNIT_ASSERT_EQUAL(std::string("{'name':'owned::make_widget'}"),
+                         std::string(vim_clang_get_full_name_at(
+                             "qa/data/owner/widget.hpp:-std=c++1y:5:12")));
+    // The owner is reparsed with the unsaved contents of the header.
+    CPPUNIT_ASSERT_EQUAL(
+        std::string("{'name':'owned::make_gadget'}"),
+        std::string(vim_clang_get_full_name_at(
+            "qa/data/owner/widget.hpp#qa/data/owner/widget-unsaved.hpp:"
+            "-std=c++1y:5:12")));
+    vim_clang_set_option("header_owners=");
+}
+
+void include_test::test_header_change() {
+    auto vim_clang_get_type_with_deduction_at =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_type_with_deduction_at"));
+    assert(vim_clang_get_type_with_deduction_at);
+    auto vim_clang_get_diagnostics =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_diagnostics"));
+    assert(vim_clang_get_diagnostics);
+
+    char directory[] = "/tmp/libclang-vim-test-XXXXXX";
+    CPPUNIT_ASSERT(mkdtemp(directory));
+    const std::string header = std::string(directory) + "/value.hpp";
+    const std::string file = std::string(directory) + "/main.cpp";
+    std::ofstream(header) << "int value;\n";
+    std::ofstream(file) << "#include \"value.hpp\"\nauto copy = value;\n";
+    const std::string request = file + ":-std=c++11:2:6";
+
+    std::string actual(vim_clang_get_type_with_deduction_at(request.c_str()));
+    CPPUNIT_ASSERT_EQUAL(0, actual.compare(0, 12, "{'type':'int"));
+
+    // The cached unit is reparsed, though nobody told that the header changed.
+    std::ofstream(header) << "long value;\n";
+    actual = vim_clang_get_type_with_deduction_at(request.c_str());
+    CPPUNIT_ASSERT_EQUAL(0, actual.compare(0, 13, "{'type':'long"));
+
+    // So are the cached diagnostics.
+    const std::string diagnostics_request = file + ":-std=c++11";
+    actual = vim_clang_get_diagnostics(diagnostics_request.c_str());
+    CPPUNIT_ASSERT_EQUAL(std::string("[]"), actual);
+    std::ofstream(header) << "long value;\n#error changed\n";
+    actual = vim_clang_get_diagnostics(diagnostics_request.c_str());
+    CPPUNIT_ASSERT(actual.find("'severity': 'error'") != std::string::npos);
+
+    std::string command = "rm -rf " + std::string(directory);
+    CPPUNIT_ASSERT_EQUAL(0, std::system(command.c_str()));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(include_test);
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
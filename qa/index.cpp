@@ -0,0 +1,363 @@
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <cppunit/extensions/HelperMacros.h>
+#include <dlfcn.h>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+
+class index_test : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE(index_test);
+    CPPUNIT_TEST(test_indexed_occurrences);
+    CPPUNIT_TEST(test_cache_directory);
+    CPPUNIT_TEST(test_workspace_symbols);
+    CPPUNIT_TEST(test_reference_search);
+    CPPUNIT_TEST(test_call_hierarchy);
+    CPPUNIT_TEST(test_type_hierarchy);
+    CPPUNIT_TEST_SUITE_END();
+
+    void test_indexed_occurrences();
+    void test_cache_directory();
+    void test_workspace_symbols();
+    void test_reference_search();
+    void test_call_hierarchy();
+    void test_type_hierarchy();
+
+    /// Polls the running indexing till it's done, returns the last result.
+    std::string wait_for_indexing();
+
+    /// Polls with the entry point name till the work is done, returns the
+    /// last result. All of them are appended to polls if given.
+    std::string wait_for(const char* name, std::string* polls = nullptr);
+
+    void* m_handle = nullptr;
+
+  public:
+    index_test();
+    index_test(const index_test&) = delete;
+    index_test& operator=(const index_test&) = delete;
+
+    void setUp() override;
+    void tearDown() override;
+};
+
+index_test::index_test() = default;
+
+void index_test::setUp() {
+    m_handle = dlopen("lib/libclang-vim.so", RTLD_NOW);
+    if (!m_handle) {
+        std::stringstream ss;
+        ss << "dlopen() failed: ";
+        ss << dlerror();
+        CPPUNIT_FAIL(ss.str());
+    }
+}
+
+void index_test::tearDown() {
+    if (m_handle)
+        dlclose(m_handle);
+}
+
+std::string index_test::wait_for_indexing() {
+    return wait_for("vim_clang_poll_indexing");
+}
+
+std::string index_test::wait_for(const char* name, std::string* polls) {
+    auto vim_clang_poll = reinterpret_cast<char const* (*)(char const*)>(
+        dlsym(m_handle, name));
+    assert(vim_clang_poll);
+
+    std::string poll;
+    for (int i = 0; i < 600; ++i) {
+        poll = vim_clang_poll("");
+        if (polls)
+            *polls += poll;
+        int done = 0;
+        int total = 0;
+        if (std::sscanf(poll.c_str(), "{'done':%d,'total':%d", &done,
+                        &total) != 2)
+            CPPUNIT_FAIL("unexpected poll result: " + poll);
+        if (done == total)
+            return poll;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    CPPUNIT_FAIL("polling did not finish");
+    return poll;
+}
+
+void index_test::test_indexed_occurrences() {
+    auto vim_clang_start_indexing =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_start_indexing"));
+    assert(vim_clang_start_indexing);
+    auto vim_clang_get_indexed_definitions_at =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_indexed_definitions_at"));
+    assert(vim_clang_get_indexed_definitions_at);
+    auto vim_clang_get_indexed_references_at =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_indexed_references_at"));
+    assert(vim_clang_get_indexed_references_at);
+
+    std::string actual(vim_clang_start_indexing("qa/data/index/caller.cpp:\n"
+                                                "qa/data/index/callee.cpp:\n"));
+    CPPUNIT_ASSERT_EQUAL(std::string("{'total':2}"), actual);
+    wait_for_indexing();
+
+    // The definition is in an other translation unit.
+    std::string expected("[{'line':1,'column':5,'offset':4,'file':'qa/data/"
+                         "index/callee.cpp','role':'definition'},]");
+    actual = vim_clang_get_indexed_definitions_at(
+        "qa/data/index/caller.cpp::3:21");
+    CPPUNIT_ASSERT_EQUAL(expected, actual);
+
+    expected = "[{'line':3,'column':21,'offset':39,'file':'qa/data/index/"
+               "caller.cpp','role':'reference'},]";
+    actual = vim_clang_get_indexed_references_at(
+        "qa/data/index/callee.cpp::1:5");
+    CPPUNIT_ASSERT_EQUAL(expected, actual);
+
+    // Both units include the header, its occurrences are there once.
+    actual = vim_clang_start_indexing("qa/data/index/first.cpp:\n"
+                                      "qa/data/index/second.cpp:\n");
+    CPPUNIT_ASSERT_EQUAL(std::string("{'total':2}"), actual);
+    wait_for_indexing();
+    expected = "[{'line':3,'column':12,'offset':25,'file':'qa/data/index/"
+               "shared.hpp','role':'definition'},]";
+    actual = vim_clang_get_indexed_definitions_at(
+        "qa/data/index/second.cpp::3:29");
+    CPPUNIT_ASSERT_EQUAL(expected, actual);
+}
+
+void index_test::test_cache_directory() {
+    auto vim_clang_set_option = reinterpret_cast<char const* (*)(char const*)>(
+        dlsym(m_handle, "vim_clang_set_option"));
+    assert(vim_clang_set_option);
+    auto vim_clang_start_indexing =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_start_indexing"));
+    assert(vim_clang_start_indexing);
+    auto vim_clang_get_indexed_definitions_at =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_indexed_definitions_at"));
+    assert(vim_clang_get_indexed_definitions_at);
+
+    char directory[] = "/tmp/libclang-vim-test-XXXXXX";
+    CPPUNIT_ASSERT(mkdtemp(directory));
+    std::string cache_directory = std::string(directory) + "/index";
+    std::string actual(
+        vim_clang_set_option(("cache_directory=" + cache_directory).c_str()));
+    CPPUNIT_ASSERT_EQUAL(std::string("{'ok':1}"), actual);
+
+    // The first run writes the shards.
+    vim_clang_start_indexing("qa/data/index/caller.cpp:\n"
+                             "qa/data/index/callee.cpp:\n");
+    actual = wait_for_indexing();
+    CPPUNIT_ASSERT(actual.find("'loaded':0") != std::string::npos);
+
+    // The second one only reads them.
+    vim_clang_start_indexing("qa/data/index/caller.cpp:\n"
+                             "qa/data/index/callee.cpp:\n");
+    actual = wait_for_indexing();
+    CPPUNIT_ASSERT(actual.find("'loaded':2") != std::string::npos);
+    std::string expected("[{'line':1,'column':5,'offset':4,'file':'qa/data/"
+                         "index/callee.cpp','role':'definition'},]");
+    actual = vim_clang_get_indexed_definitions_at(
+        "qa/data/index/caller.cpp::3:21");
+    CPPUNIT_ASSERT_EQUAL(expected, actual);
+
+    // Different arguments invalidate the shard.
+    vim_clang_start_indexing("qa/data/index/callee.cpp:-DFOO\n");
+    actual = wait_for_indexing();
+    CPPUNIT_ASSERT(actual.find("'loaded':0") != std::string::npos);
+
+    vim_clang_set_option("cache_directory=");
+    std::string command = "rm -rf " + std::string(directory);
+    CPPUNIT_ASSERT_EQUAL(0, std::system(command.c_str()));
+    actual = vim_clang_set_option("no_such_option=1");
+    CPPUNIT_ASSERT_EQUAL(std::string("{}"), actual);
+}
+
+void index_test::test_workspace_symbols() {
+    auto vim_clang_start_indexing =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_start_indexing"));
+    assert(vim_clang_start_indexing);
+    auto vim_clang_search_workspace_symbols =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_search_workspace_symbols"));
+    assert(vim_clang_search_workspace_symbols);
+
+    vim_clang_start_indexing("qa/data/index/caller.cpp:\n"
+                             "qa/data/index/callee.cpp:\n");
+    wait_for_indexing();
+
+    // The definition is preferred over the declaration in caller.cpp.
+    std::string expected("[{'name':'get_answer','kind':'function','usr':'c:@"
+                         "F@get_answer#','line':1,'column':5,'offset':4,'"
+                         "file':'qa/data/index/callee.cpp'},]");
+    std::string actual(vim_clang_search_workspace_symbols("1:ANSW"));
+    CPPUNIT_ASSERT_EQUAL(expected, actual);
+
+    // Fuzzy match.
+    actual = vim_clang_search_workspace_symbols("1:gtansr");
+    CPPUNIT_ASSERT_EQUAL(expected, actual);
+
+    actual = vim_clang_search_workspace_symbols("no_such_symbol");
+    CPPUNIT_ASSERT_EQUAL(std::string("[]"), actual);
+}
+
+void index_test::test_reference_search() {
+    auto vim_clang_start_reference_search =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_start_reference_search"));
+    assert(vim_clang_start_reference_search);
+
+    const std::string files = "qa/data/rename/compute.cpp:\n"
+                              "qa/data/rename/user.cpp:\n"
+                              "qa/data/rename/unrelated.cpp:\n";
+    std::string actual(vim_clang_start_reference_search(
+        ("c:@F@compute#I#\ncompute\n" + files).c_str()));
+    CPPUNIT_ASSERT_EQUAL(std::string("{'total':3}"), actual);
+    std::string polls;
+    actual = wait_for("vim_clang_poll_reference_search", &polls);
+    // Only compute.cpp mentions the function, the reference in the header is
+    // found while parsing it.
+    CPPUNIT_ASSERT(actual.find("'skipped':2,") != std::string::npos);
+    CPPUNIT_ASSERT(polls.find("rename/compute.cpp','references':[{'line':3,"
+                              "'column':5,'offset':27,'role':'definition'},"
+                              "]}") != std::string::npos);
+    CPPUNIT_ASSERT(polls.find("rename/widget.hpp','references':[{'line':3,"
+                              "'column':5,'offset':18,'role':'declaration'},{"
+                              "'line':5,'column':38,'offset':76,'role':"
+                              "'reference'},]}") != std::string::npos);
+
+    // Now the header of compute.cpp is known to mention the symbol at the
+    // location, its definition is reported once.
+    vim_clang_start_reference_search(
+        ("qa/data/rename/user.cpp::3:21\n\n" + files).c_str());
+    polls.clear();
+    actual = wait_for("vim_clang_poll_reference_search", &polls);
+    CPPUNIT_ASSERT(actual.find("'skipped':1,") != std::string::npos);
+    const std::string definition =
+        "rename/widget.hpp','references':[{'line':5,'column':12,'offset':50,"
+        "'role':'definition'},]}";
+    CPPUNIT_ASSERT(polls.find(definition) != std::string::npos);
+    CPPUNIT_ASSERT_EQUAL(polls.find(definition), polls.rfind(definition));
+    CPPUNIT_ASSERT(polls.find("rename/user.cpp','references':[{'line':3,"
+                              "'column':21,'offset':43,'role':'reference'},"
+                              "]}") != std::string::npos);
+
+    // Neither indexed, nor spelled out.
+    actual = vim_clang_start_reference_search(
+        ("c:@F@compute#I#\n\n" + files).c_str());
+    CPPUNIT_ASSERT_EQUAL(std::string("{}"), actual);
+}
+
+void index_test::test_call_hierarchy() {
+    auto vim_clang_start_indexing =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_start_indexing"));
+    assert(vim_clang_start_indexing);
+    auto vim_clang_get_incoming_calls =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_incoming_calls"));
+    assert(vim_clang_get_incoming_calls);
+    auto vim_clang_get_outgoing_calls =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_outgoing_calls"));
+    assert(vim_clang_get_outgoing_calls);
+
+    vim_clang_start_indexing("qa/data/index/caller.cpp:\n"
+                             "qa/data/index/callee.cpp:\n");
+    wait_for_indexing();
+
+    // The function is the one defined at the location.
+    std::string expected(
+        "[{'name':'main','kind':'function','usr':'c:@F@main#','line':3,"
+        "'column':5,'offset':23,'file':'qa/data/index/caller.cpp','calls':[{"
+        "'line':3,'column':21,'offset':39,'file':'qa/data/index/caller.cpp'}"
+        ",]},]");
+    std::string actual(
+        vim_clang_get_incoming_calls("qa/data/index/callee.cpp::1:5"));
+    CPPUNIT_ASSERT_EQUAL(expected, actual);
+
+    // The next level is expanded by USR: nothing calls main().
+    actual = vim_clang_get_incoming_calls("c:@F@main#");
+    CPPUNIT_ASSERT_EQUAL(std::string("[]"), actual);
+
+    // The function is the one called at the location, its definition is in
+    // an other translation unit.
+    expected = "[{'name':'get_answer','kind':'function','usr':'c:@F@get_"
+               "answer#','line':1,'column':5,'offset':4,'file':'qa/data/index/"
+               "callee.cpp','calls':[{'line':3,'column':21,'offset':39,'file':"
+               "'qa/data/index/caller.cpp'},]},]";
+    actual = vim_clang_get_outgoing_calls("qa/data/index/caller.cpp::3:1");
+    CPPUNIT_ASSERT_EQUAL(expected, actual);
+    actual = vim_clang_get_outgoing_calls("c:@F@get_answer#");
+    CPPUNIT_ASSERT_EQUAL(std::string("[]"), actual);
+}
+
+void index_test::test_type_hierarchy() {
+    auto vim_clang_start_indexing =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_start_indexing"));
+    assert(vim_clang_start_indexing);
+    auto vim_clang_get_base_classes =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_base_classes"));
+    assert(vim_clang_get_base_classes);
+    auto vim_clang_get_derived_classes =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_derived_classes"));
+    assert(vim_clang_get_derived_classes);
+    auto vim_clang_get_implementations =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_implementations"));
+    assert(vim_clang_get_implementations);
+
+    vim_clang_start_indexing("qa/data/hierarchy/circle.cpp:\n"
+                             "qa/data/hierarchy/square.cpp:\n");
+    wait_for_indexing();
+
+    // The derived classes are in two translation units.
+    std::string expected(
+        "[{'name':'circle','kind':'struct','usr':'c:@S@circle','line':3,'"
+        "column':8,'offset':29,'file':'qa/data/hierarchy/circle.cpp','"
+        "derived':[{'name':'unit_circle','kind':'struct','usr':'c:@S@unit_"
+        "circle','line':7,'column':8,'offset':101,'file':'qa/data/hierarchy/"
+        "circle.cpp','derived':[]},]},{'name':'square','kind':'struct','usr':"
+        "'c:@S@square','line':3,'column':8,'offset':29,'file':'qa/data/"
+        "hierarchy/square.cpp','derived':[]},]");
+    std::string actual(
+        vim_clang_get_derived_classes("qa/data/hierarchy/shape.hpp::1:8"));
+    CPPUNIT_ASSERT_EQUAL(expected, actual);
+
+    expected = "[{'name':'circle','kind':'struct','usr':'c:@S@circle','line':"
+               "3,'column':8,'offset':29,'file':'qa/data/hierarchy/circle.cpp"
+               "','bases':[{'name':'shape','kind':'struct','usr':'c:@S@shape'"
+               ",'line':1,'column':8,'offset':7,'file':'qa/data/hierarchy/"
+               "shape.hpp','bases':[]},]},]";
+    actual = vim_clang_get_base_classes("c:@S@unit_circle");
+    CPPUNIT_ASSERT_EQUAL(expected, actual);
+
+    // Direct overriders come first.
+    actual = vim_clang_get_implementations("c:@S@shape@F@area#1");
+    const std::size_t circle = actual.find("'usr':'c:@S@circle@F@area#1'");
+    const std::size_t square = actual.find("'usr':'c:@S@square@F@area#1'");
+    const std::size_t unit_circle =
+        actual.find("'usr':'c:@S@unit_circle@F@area#1'");
+    CPPUNIT_ASSERT(circle != std::string::npos);
+    CPPUNIT_ASSERT(square != std::string::npos);
+    CPPUNIT_ASSERT(unit_circle != std::string::npos);
+    CPPUNIT_ASSERT(circle < unit_circle && square < unit_circle);
+
+    actual = vim_clang_get_implementations("c:@S@unit_circle");
+    CPPUNIT_ASSERT_EQUAL(std::string("[]"), actual);
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(index_test);
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
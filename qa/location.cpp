@@ -12,6 +12,7 @@ class location_test : public CPPUNIT_NS::TestFixture {
     CPPUNIT_TEST(test_unsaved_ast_node);
     CPPUNIT_TEST(test_extent);
     CPPUNIT_TEST(test_unsaved_extent);
+    CPPUNIT_TEST(test_references_in_file);
     CPPUNIT_TEST_SUITE_END();
 
     void test_all_extents();
@@ -20,6 +21,7 @@ class location_test : public CPPUNIT_NS::TestFixture {
     void test_unsaved_ast_node();
     void test_extent();
     void test_unsaved_extent();
+    void test_references_in_file();
 
     void* m_handle = nullptr;
 
@@ -142,6 +144,25 @@ void location_test::test_unsaved_extent() {
     CPPUNIT_ASSERT_EQUAL(expected, actual);
 }
 
+void location_test::test_references_in_file() {
+    auto vim_clang_get_references_in_file_at =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_references_in_file_at"));
+    assert(vim_clang_get_references_in_file_at);
+
+    std::string expected =
+        "[{'start':{'line':1,'column':5,'offset':4,'file':'qa/data/"
+        "references.cpp',},'end':{'line':1,'column':12,'offset':11,'file':'qa/"
+        "data/references.cpp',}},{'start':{'line':3,'column':28,'offset':45,"
+        "'file':'qa/data/references.cpp',},'end':{'line':3,'column':35,"
+        "'offset':52,'file':'qa/data/references.cpp',}},{'start':{'line':5,"
+        "'column':14,'offset':70,'file':'qa/data/references.cpp',},'end':{"
+        "'line':5,'column':21,'offset':77,'file':'qa/data/references.cpp',}},]";
+    std::string actual(
+        vim_clang_get_references_in_file_at("qa/data/references.cpp::3:28"));
+    CPPUNIT_ASSERT_EQUAL(expected, actual);
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(location_test);
 
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
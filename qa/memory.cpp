@@ -0,0 +1,86 @@
+#include <cassert>
+#include <climits>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <iostream>
+#include <unistd.h>
+
+class memory_test : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE(memory_test);
+    CPPUNIT_TEST(test_memory_budget);
+    CPPUNIT_TEST_SUITE_END();
+
+    void test_memory_budget();
+
+    void* m_handle = nullptr;
+
+  public:
+    memory_test();
+    memory_test(const memory_test&) = delete;
+    memory_test& operator=(const memory_test&) = delete;
+
+    void setUp() override;
+    void tearDown() override;
+};
+
+memory_test::memory_test() = default;
+
+void memory_test::setUp() {
+    m_handle = dlopen("lib/libclang-vim.so", RTLD_NOW);
+    if (!m_handle) {
+        std::stringstream ss;
+        ss << "dlopen() failed: ";
+        ss << dlerror();
+        CPPUNIT_FAIL(ss.str());
+    }
+}
+
+void memory_test::tearDown() {
+    if (m_handle)
+        dlclose(m_handle);
+}
+
+void memory_test::test_memory_budget() {
+    auto vim_clang_get_full_name_at =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_full_name_at"));
+    assert(vim_clang_get_full_name_at);
+    auto vim_clang_get_translation_unit_usage =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_translation_unit_usage"));
+    assert(vim_clang_get_translation_unit_usage);
+    auto vim_clang_set_option = reinterpret_cast<char const* (*)(char const*)>(
+        dlsym(m_handle, "vim_clang_set_option"));
+    assert(vim_clang_set_option);
+
+    char buffer[PATH_MAX];
+    CPPUNIT_ASSERT(getcwd(buffer, sizeof(buffer)));
+    const std::string directory = std::string(buffer) + "/qa/data/";
+
+    vim_clang_get_full_name_at("qa/data/current-function.cpp:-std=c++1y:37:8");
+    std::string usage(vim_clang_get_translation_unit_usage(""));
+    // The most recently used unit comes first, and takes some memory.
+    const std::string prefix = "'units':[{'file':'" + directory +
+                               "current-function.cpp','memory':";
+    auto position = usage.find(prefix);
+    CPPUNIT_ASSERT(position != std::string::npos);
+    CPPUNIT_ASSERT(
+        std::strtoull(usage.c_str() + position + prefix.size(), nullptr, 10) >
+        0);
+
+    // Without budget, only the unit in use is kept.
+    CPPUNIT_ASSERT_EQUAL(std::string("{'ok':1}"),
+                         std::string(vim_clang_set_option("memory_budget=0")));
+    vim_clang_get_full_name_at("qa/data/declaration.cpp:-std=c++1y:3:15");
+    usage = vim_clang_get_translation_unit_usage("");
+    CPPUNIT_ASSERT_EQUAL(0, usage.compare(0, 12, "{'budget':0,"));
+    CPPUNIT_ASSERT(usage.find("{'file':'" + directory + "declaration.cpp'") !=
+                   std::string::npos);
+    CPPUNIT_ASSERT_EQUAL(usage.find("{'file':"), usage.rfind("{'file':"));
+    vim_clang_set_option("memory_budget=");
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(memory_test);
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
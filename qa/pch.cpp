@@ -0,0 +1,99 @@
+#include <cassert>
+#include <climits>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <iostream>
+#include <unistd.h>
+
+class pch_test : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE(pch_test);
+    CPPUNIT_TEST(test_shared_pch);
+    CPPUNIT_TEST_SUITE_END();
+
+    void test_shared_pch();
+
+    void* m_handle = nullptr;
+
+  public:
+    pch_test();
+    pch_test(const pch_test&) = delete;
+    pch_test& operator=(const pch_test&) = delete;
+
+    void setUp() override;
+    void tearDown() override;
+};
+
+pch_test::pch_test() = default;
+
+void pch_test::setUp() {
+    m_handle = dlopen("lib/libclang-vim.so", RTLD_NOW);
+    if (!m_handle) {
+        std::stringstream ss;
+        ss << "dlopen() failed: ";
+        ss << dlerror();
+        CPPUNIT_FAIL(ss.str());
+    }
+}
+
+void pch_test::tearDown() {
+    if (m_handle)
+        dlclose(m_handle);
+}
+
+void pch_test::test_shared_pch() {
+    auto vim_clang_set_option = reinterpret_cast<char const* (*)(char const*)>(
+        dlsym(m_handle, "vim_clang_set_option"));
+    assert(vim_clang_set_option);
+    auto vim_clang_build_shared_pch =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_build_shared_pch"));
+    assert(vim_clang_build_shared_pch);
+    auto vim_clang_clear_shared_pch =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_clear_shared_pch"));
+    assert(vim_clang_clear_shared_pch);
+    auto vim_clang_get_diagnostics =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_diagnostics"));
+    assert(vim_clang_get_diagnostics);
+    auto vim_clang_get_inclusions =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_inclusions"));
+    assert(vim_clang_get_inclusions);
+
+    const char* files = "qa/data/pch/one.cpp:\nqa/data/pch/two.cpp:\n";
+    // Headers are only built into the cache directory.
+    std::string actual(vim_clang_build_shared_pch(files));
+    CPPUNIT_ASSERT_EQUAL(std::string("{}"), actual);
+
+    char directory[] = "/tmp/libclang-vim-test-XXXXXX";
+    CPPUNIT_ASSERT(mkdtemp(directory));
+    vim_clang_set_option(
+        ("cache_directory=" + std::string(directory)).c_str());
+    actual = vim_clang_build_shared_pch(files);
+    CPPUNIT_ASSERT_EQUAL(std::string("{'headers':1,'files':2}"), actual);
+
+    // common.hpp comes from the precompiled header, so it's not included
+    // again, but still known as a dependency.
+    actual = vim_clang_get_diagnostics("qa/data/pch/one.cpp:");
+    CPPUNIT_ASSERT_EQUAL(std::string("[]"), actual);
+    actual = vim_clang_get_inclusions("qa/data/pch/one.cpp");
+    char buffer[PATH_MAX];
+    CPPUNIT_ASSERT(getcwd(buffer, sizeof(buffer)));
+    const std::string data = std::string(buffer) + "/qa/data/pch/";
+    const std::string expected = "{'file':'" + data +
+                                 "common.hpp','included_from':'" + data +
+                                 "one.cpp','line':0}";
+    CPPUNIT_ASSERT(actual.find(expected) != std::string::npos);
+
+    actual = vim_clang_clear_shared_pch("");
+    CPPUNIT_ASSERT_EQUAL(std::string("{'ok':1}"), actual);
+    vim_clang_set_option("cache_directory=");
+    std::string command = "rm -rf " + std::string(directory);
+    CPPUNIT_ASSERT_EQUAL(0, std::system(command.c_str()));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(pch_test);
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
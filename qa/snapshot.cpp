@@ -0,0 +1,145 @@
+#include <cassert>
+#include <chrono>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cstdlib>
+#include <ctime>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+#include <thread>
+#include <utime.h>
+#include <unistd.h>
+
+class snapshot_test : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE(snapshot_test);
+    CPPUNIT_TEST(test_snapshots);
+    CPPUNIT_TEST_SUITE_END();
+
+    void test_snapshots();
+
+    /// Returns the names of the saved units in directory.
+    std::vector<std::string> get_snapshots(const std::string& directory);
+
+    /// Waits till the background saving leaves count units in directory.
+    bool wait_for_snapshots(const std::string& directory, std::size_t count);
+
+    void* m_handle = nullptr;
+
+  public:
+    snapshot_test();
+    snapshot_test(const snapshot_test&) = delete;
+    snapshot_test& operator=(const snapshot_test&) = delete;
+
+    void setUp() override;
+    void tearDown() override;
+};
+
+snapshot_test::snapshot_test() = default;
+
+void snapshot_test::setUp() {
+    m_handle = dlopen("lib/libclang-vim.so", RTLD_NOW);
+    if (!m_handle) {
+        std::stringstream ss;
+        ss << "dlopen() failed: ";
+        ss << dlerror();
+        CPPUNIT_FAIL(ss.str());
+    }
+}
+
+void snapshot_test::tearDown() {
+    if (m_handle)
+        dlclose(m_handle);
+}
+
+std::vector<std::string>
+snapshot_test::get_snapshots(const std::string& directory) {
+    std::vector<std::string> snapshots;
+    DIR* stream = opendir(directory.c_str());
+    if (!stream)
+        return snapshots;
+
+    while (dirent* entry = readdir(stream)) {
+        const std::string name = entry->d_name;
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".ast") == 0)
+            snapshots.push_back(directory + "/" + name);
+    }
+    closedir(stream);
+    return snapshots;
+}
+
+bool snapshot_test::wait_for_snapshots(const std::string& directory,
+                                       std::size_t count) {
+    for (int i = 0; i < 100; ++i) {
+        if (get_snapshots(directory).size() == count)
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return false;
+}
+
+void snapshot_test::test_snapshots() {
+    auto vim_clang_set_option = reinterpret_cast<char const* (*)(char const*)>(
+        dlsym(m_handle, "vim_clang_set_option"));
+    assert(vim_clang_set_option);
+    auto vim_clang_get_diagnostics =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_diagnostics"));
+    assert(vim_clang_get_diagnostics);
+    auto vim_clang_get_location_information =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_location_information"));
+    assert(vim_clang_get_location_information);
+
+    char directory[] = "/tmp/libclang-vim-test-XXXXXX";
+    CPPUNIT_ASSERT(mkdtemp(directory));
+    const std::string units = std::string(directory) + "/units";
+    const std::string file = std::string(directory) + "/main.cpp";
+    std::ofstream(file) << "int main() { int i = 0; }\n";
+    vim_clang_set_option(
+        ("cache_directory=" + std::string(directory)).c_str());
+
+    // Parsing saves the unit.
+    std::string diagnostics(
+        vim_clang_get_diagnostics((file + ":-Wunused-variable").c_str()));
+    CPPUNIT_ASSERT(diagnostics.find("'severity': 'warning'") !=
+                   std::string::npos);
+    CPPUNIT_ASSERT(wait_for_snapshots(units, 1));
+    std::vector<std::string> snapshots = get_snapshots(units);
+
+    // Push the unit out of memory with other arguments.
+    vim_clang_set_option("memory_budget=0");
+    for (int i = 0; i < 8; ++i) {
+        std::string request = file + ":-DN" + std::to_string(i) + ":1:18";
+        vim_clang_get_location_information(request.c_str());
+    }
+    vim_clang_set_option("memory_budget=");
+    CPPUNIT_ASSERT(wait_for_snapshots(units, 9));
+
+    // Loading the unit again marks the snapshot as used.
+    utimbuf old_times{0, 0};
+    CPPUNIT_ASSERT_EQUAL(0, utime(snapshots[0].c_str(), &old_times));
+    std::string expected_prefix = "{'spell':'i','type':'int',";
+    std::string actual(vim_clang_get_location_information(
+        (file + ":-Wunused-variable:1:18").c_str()));
+    CPPUNIT_ASSERT_EQUAL(
+        0, actual.compare(0, expected_prefix.size(), expected_prefix));
+    struct stat st {};
+    CPPUNIT_ASSERT_EQUAL(0, stat(snapshots[0].c_str(), &st));
+    CPPUNIT_ASSERT(st.st_mtime > 0);
+
+    // Over the size limit, the least recently used snapshots are removed.
+    vim_clang_set_option("snapshot_size_limit=0");
+    vim_clang_get_location_information((file + ":-DN8:1:18").c_str());
+    CPPUNIT_ASSERT(wait_for_snapshots(units, 0));
+
+    vim_clang_set_option("snapshot_size_limit=");
+    vim_clang_set_option("cache_directory=");
+    std::string command = "rm -rf " + std::string(directory);
+    CPPUNIT_ASSERT_EQUAL(0, std::system(command.c_str()));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(snapshot_test);
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
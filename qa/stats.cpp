@@ -0,0 +1,254 @@
+#include <cassert>
+#include <chrono>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cstdio>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+class stats_test : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE(stats_test);
+    CPPUNIT_TEST(test_stats);
+    CPPUNIT_TEST(test_trace);
+    CPPUNIT_TEST(test_record);
+    CPPUNIT_TEST(test_record_file_list);
+    CPPUNIT_TEST_SUITE_END();
+
+    void test_stats();
+    void test_trace();
+    void test_record();
+    void test_record_file_list();
+
+    void* m_handle = nullptr;
+
+  public:
+    stats_test();
+    stats_test(const stats_test&) = delete;
+    stats_test& operator=(const stats_test&) = delete;
+
+    void setUp() override;
+    void tearDown() override;
+};
+
+stats_test::stats_test() = default;
+
+void stats_test::setUp() {
+    m_handle = dlopen("lib/libclang-vim.so", RTLD_NOW);
+    if (!m_handle) {
+        std::stringstream ss;
+        ss << "dlopen() failed: ";
+        ss << dlerror();
+        CPPUNIT_FAIL(ss.str());
+    }
+}
+
+void stats_test::tearDown() {
+    if (m_handle)
+        dlclose(m_handle);
+}
+
+void stats_test::test_stats() {
+    auto vim_clang_stats = reinterpret_cast<char const* (*)(char const*)>(
+        dlsym(m_handle, "vim_clang_stats"));
+    assert(vim_clang_stats);
+    auto vim_clang_reset_stats = reinterpret_cast<char const* (*)(char const*)>(
+        dlsym(m_handle, "vim_clang_reset_stats"));
+    assert(vim_clang_reset_stats);
+    auto vim_clang_tokens = reinterpret_cast<char const* (*)(char const*)>(
+        dlsym(m_handle, "vim_clang_tokens"));
+    assert(vim_clang_tokens);
+
+    CPPUNIT_ASSERT_EQUAL(std::string("{'ok':1}"),
+                         std::string(vim_clang_reset_stats("")));
+    CPPUNIT_ASSERT_EQUAL(
+        std::string("{'timers':{},'counters':{},'hit_rates':{}}"),
+        std::string(vim_clang_stats("")));
+
+    // The second request is answered from the result cache.
+    vim_clang_tokens("qa/data/references.cpp:-std=c++1y");
+    vim_clang_tokens("qa/data/references.cpp:-std=c++1y");
+    std::string stats(vim_clang_stats(""));
+    CPPUNIT_ASSERT(stats.find("'vim_clang_tokens':{'count':2,") !=
+                   std::string::npos);
+    CPPUNIT_ASSERT(stats.find("'tokenizer.parse':{'count':1,") !=
+                   std::string::npos);
+    CPPUNIT_ASSERT(stats.find("'tokenizer.stringize':{'count':1,") !=
+                   std::string::npos);
+    CPPUNIT_ASSERT(stats.find("'result_cache.hits':1,") != std::string::npos);
+    CPPUNIT_ASSERT(stats.find("'result_cache.misses':1,") !=
+                   std::string::npos);
+    CPPUNIT_ASSERT(stats.find("'hit_rates':{'result_cache':50,") !=
+                   std::string::npos);
+}
+
+void stats_test::test_trace() {
+    auto vim_clang_start_tracing =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_start_tracing"));
+    assert(vim_clang_start_tracing);
+    auto vim_clang_stop_tracing =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_stop_tracing"));
+    assert(vim_clang_stop_tracing);
+    auto vim_clang_get_full_name_at =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_full_name_at"));
+    assert(vim_clang_get_full_name_at);
+
+    char directory[] = "/tmp/libclang-vim-trace-XXXXXX";
+    CPPUNIT_ASSERT(mkdtemp(directory));
+    const std::string file = std::string(directory) + "/trace.json";
+
+    CPPUNIT_ASSERT_EQUAL(std::string("{'ok':1}"),
+                         std::string(vim_clang_start_tracing(file.c_str())));
+    CPPUNIT_ASSERT_EQUAL(std::string("{}"),
+                         std::string(vim_clang_start_tracing(file.c_str())));
+    vim_clang_get_full_name_at("qa/data/current-function.cpp:-std=c++1y:37:8");
+    std::string stopped(vim_clang_stop_tracing(""));
+    CPPUNIT_ASSERT(stopped != "{'events':0}");
+
+    std::ifstream stream(file);
+    std::stringstream trace;
+    trace << stream.rdbuf();
+    const std::string contents = trace.str();
+    CPPUNIT_ASSERT_EQUAL(0, contents.compare(0, 2, "[\n"));
+    CPPUNIT_ASSERT(contents.find("{\"name\":\"parse_args\",\"ph\":\"X\",") !=
+                   std::string::npos);
+    CPPUNIT_ASSERT(contents.find("{\"name\":\"vim_clang_get_full_name_at\","
+                                 "\"ph\":\"X\",") != std::string::npos);
+    CPPUNIT_ASSERT_EQUAL(std::string("\n]\n"),
+                         contents.substr(contents.size() - 3));
+
+    // Nothing is written once stopped.
+    vim_clang_get_full_name_at("qa/data/current-function.cpp:-std=c++1y:37:8");
+    CPPUNIT_ASSERT_EQUAL(std::string("{'events':0}"),
+                         std::string(vim_clang_stop_tracing("")));
+
+    std::string command = "rm -rf " + std::string(directory);
+    CPPUNIT_ASSERT_EQUAL(0, std::system(command.c_str()));
+}
+
+void stats_test::test_record() {
+    auto vim_clang_start_recording =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_start_recording"));
+    assert(vim_clang_start_recording);
+    auto vim_clang_stop_recording =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_stop_recording"));
+    assert(vim_clang_stop_recording);
+    auto vim_clang_get_diagnostics =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_diagnostics"));
+    assert(vim_clang_get_diagnostics);
+
+    char directory[] = "/tmp/libclang-vim-record-XXXXXX";
+    CPPUNIT_ASSERT(mkdtemp(directory));
+    const std::string file = std::string(directory) + "/session";
+
+    CPPUNIT_ASSERT_EQUAL(std::string("{'ok':1}"),
+                         std::string(vim_clang_start_recording(file.c_str())));
+    CPPUNIT_ASSERT_EQUAL(std::string("{}"),
+                         std::string(vim_clang_start_recording(file.c_str())));
+    const std::string input = "qa/data/unsaved/diagnostics.cpp#qa/data/unsaved/"
+                              "diagnostics-unsaved.cpp:-std=c++1y";
+    vim_clang_get_diagnostics(input.c_str());
+    CPPUNIT_ASSERT_EQUAL(std::string("{'calls':1}"),
+                         std::string(vim_clang_stop_recording("")));
+
+    // The unsaved buffer is saved before the call.
+    std::ifstream unsaved("qa/data/unsaved/diagnostics-unsaved.cpp");
+    std::stringstream snapshot;
+    snapshot << unsaved.rdbuf();
+    std::ifstream stream(file);
+    std::stringstream session;
+    session << stream.rdbuf();
+    std::stringstream expected;
+    expected << "libclang-vim session\n"
+             << "snapshot " << snapshot.str().size()
+             << " qa/data/unsaved/diagnostics-unsaved.cpp\n"
+             << snapshot.str() << "\n";
+    const std::string contents = session.str();
+    CPPUNIT_ASSERT_EQUAL(0, contents.compare(0, expected.str().size(),
+                                             expected.str()));
+    const std::string call =
+        " vim_clang_get_diagnostics " + std::to_string(input.size()) + "\n" +
+        input + "\n";
+    CPPUNIT_ASSERT_EQUAL(0,
+                         contents.compare(expected.str().size(), 5, "call "));
+    CPPUNIT_ASSERT_EQUAL(call, contents.substr(contents.size() - call.size()));
+
+    // Nothing is written once stopped.
+    vim_clang_get_diagnostics(input.c_str());
+    CPPUNIT_ASSERT_EQUAL(std::string("{'calls':0}"),
+                         std::string(vim_clang_stop_recording("")));
+
+    std::string command = "rm -rf " + std::string(directory);
+    CPPUNIT_ASSERT_EQUAL(0, std::system(command.c_str()));
+}
+
+void stats_test::test_record_file_list() {
+    auto vim_clang_start_recording =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_start_recording"));
+    assert(vim_clang_start_recording);
+    auto vim_clang_stop_recording =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_stop_recording"));
+    assert(vim_clang_stop_recording);
+    auto vim_clang_start_diagnostics_sweep =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_start_diagnostics_sweep"));
+    assert(vim_clang_start_diagnostics_sweep);
+    auto vim_clang_poll_diagnostics_sweep =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_poll_diagnostics_sweep"));
+    assert(vim_clang_poll_diagnostics_sweep);
+
+    char directory[] = "/tmp/libclang-vim-record-XXXXXX";
+    CPPUNIT_ASSERT(mkdtemp(directory));
+    const std::string file = std::string(directory) + "/session";
+
+    CPPUNIT_ASSERT_EQUAL(std::string("{'ok':1}"),
+                         std::string(vim_clang_start_recording(file.c_str())));
+    CPPUNIT_ASSERT_EQUAL(
+        std::string("{'total':2}"),
+        std::string(vim_clang_start_diagnostics_sweep(
+            "qa/data/unsaved/diagnostics.cpp#qa/data/unsaved/"
+            "diagnostics-unsaved.cpp:-std=c++1y\n"
+            "qa/data/unsaved/completion.cpp#qa/data/unsaved/"
+            "completion-unsaved.cpp:-std=c++1y\n")));
+    CPPUNIT_ASSERT_EQUAL(std::string("{'calls':1}"),
+                         std::string(vim_clang_stop_recording("")));
+    for (int i = 0; i < 600; ++i) {
+        int done = 0;
+        int total = 0;
+        if (std::sscanf(vim_clang_poll_diagnostics_sweep(""),
+                        "{'done':%d,'total':%d", &done, &total) == 2 &&
+            done == total)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    // Every file of the list has its unsaved buffer saved.
+    std::ifstream stream(file);
+    std::stringstream session;
+    session << stream.rdbuf();
+    const std::string contents = session.str();
+    CPPUNIT_ASSERT(contents.find(
+                       " qa/data/unsaved/diagnostics-unsaved.cpp\n") !=
+                   std::string::npos);
+    CPPUNIT_ASSERT(contents.find(" qa/data/unsaved/completion-unsaved.cpp\n") !=
+                   std::string::npos);
+
+    std::string command = "rm -rf " + std::string(directory);
+    CPPUNIT_ASSERT_EQUAL(0, std::system(command.c_str()));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(stats_test);
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,114 @@
+#include <cassert>
+#include <chrono>
+#include <cppunit/extensions/HelperMacros.h>
+#include <dlfcn.h>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+
+class sweep_test : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE(sweep_test);
+    CPPUNIT_TEST(test_diagnostics_sweep);
+    CPPUNIT_TEST(test_compile_commands_sweep);
+    CPPUNIT_TEST_SUITE_END();
+
+    void test_diagnostics_sweep();
+    void test_compile_commands_sweep();
+
+    /// Polls the running sweep till it's done, returns the concatenated
+    /// results.
+    std::string wait_for_sweep();
+
+    void* m_handle = nullptr;
+
+  public:
+    sweep_test();
+    sweep_test(const sweep_test&) = delete;
+    sweep_test& operator=(const sweep_test&) = delete;
+
+    void setUp() override;
+    void tearDown() override;
+};
+
+sweep_test::sweep_test() = default;
+
+void sweep_test::setUp() {
+    m_handle = dlopen("lib/libclang-vim.so", RTLD_NOW);
+    if (!m_handle) {
+        std::stringstream ss;
+        ss << "dlopen() failed: ";
+        ss << dlerror();
+        CPPUNIT_FAIL(ss.str());
+    }
+}
+
+void sweep_test::tearDown() {
+    if (m_handle)
+        dlclose(m_handle);
+}
+
+std::string sweep_test::wait_for_sweep() {
+    auto vim_clang_poll_diagnostics_sweep =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_poll_diagnostics_sweep"));
+    assert(vim_clang_poll_diagnostics_sweep);
+
+    std::string results;
+    for (int i = 0; i < 600; ++i) {
+        std::string poll(vim_clang_poll_diagnostics_sweep(""));
+        results += poll;
+        int done = 0;
+        int total = 0;
+        if (std::sscanf(poll.c_str(), "{'done':%d,'total':%d", &done,
+                        &total) != 2)
+            CPPUNIT_FAIL("unexpected poll result: " + poll);
+        if (done == total)
+            return results;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    CPPUNIT_FAIL("sweep did not finish");
+    return results;
+}
+
+void sweep_test::test_diagnostics_sweep() {
+    auto vim_clang_start_diagnostics_sweep =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_start_diagnostics_sweep"));
+    assert(vim_clang_start_diagnostics_sweep);
+
+    std::string actual(vim_clang_start_diagnostics_sweep(
+        "qa/data/diagnostics.cpp:-Wunused-variable\n"
+        "qa/data/auto.cpp:-std=c++1y\n"));
+    CPPUNIT_ASSERT_EQUAL(std::string("{'total':2}"), actual);
+
+    std::string results = wait_for_sweep();
+    std::string expected("{'file':'qa/data/diagnostics.cpp','diagnostics':[{"
+                         "'severity': 'warning', "
+                         "'line':1,'column':18,'offset':17,'file':'qa/data/"
+                         "diagnostics.cpp',}, ]}");
+    CPPUNIT_ASSERT(results.find(expected) != std::string::npos);
+    CPPUNIT_ASSERT(results.find("{'file':'qa/data/auto.cpp'") !=
+                   std::string::npos);
+}
+
+void sweep_test::test_compile_commands_sweep() {
+    auto vim_clang_start_diagnostics_sweep =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_start_diagnostics_sweep"));
+    assert(vim_clang_start_diagnostics_sweep);
+
+    std::string actual(vim_clang_start_diagnostics_sweep(
+        "@" SRC_ROOT "/qa/data/compile-commands"));
+    CPPUNIT_ASSERT_EQUAL(std::string("{'total':1}"), actual);
+
+    // test.cpp only compiles with the -I argument from the database.
+    std::string results = wait_for_sweep();
+    std::string expected("{'file':'" SRC_ROOT "/qa/data/compile-commands/"
+                         "test.cpp','diagnostics':[]}");
+    CPPUNIT_ASSERT(results.find(expected) != std::string::npos);
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(sweep_test);
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
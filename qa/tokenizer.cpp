@@ -8,10 +8,12 @@ class tokenizer_test : public CPPUNIT_NS::TestFixture {
     CPPUNIT_TEST_SUITE(tokenizer_test);
     CPPUNIT_TEST(test_tokens);
     CPPUNIT_TEST(test_unsaved_tokens);
+    CPPUNIT_TEST(test_changed_tokens);
     CPPUNIT_TEST_SUITE_END();
 
     void test_tokens();
     void test_unsaved_tokens();
+    void test_changed_tokens();
 
     void* m_handle = nullptr;
 
@@ -63,6 +65,33 @@ void tokenizer_test::test_unsaved_tokens() {
     CPPUNIT_ASSERT(actual != "[]");
 }
 
+void tokenizer_test::test_changed_tokens() {
+    auto vim_clang_tokens = reinterpret_cast<char const* (*)(char const*)>(
+        dlsym(m_handle, "vim_clang_tokens"));
+    assert(vim_clang_tokens);
+    auto vim_clang_update_unsaved_file =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_update_unsaved_file"));
+    assert(vim_clang_update_unsaved_file);
+    auto vim_clang_discard_unsaved_file =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_discard_unsaved_file"));
+    assert(vim_clang_discard_unsaved_file);
+
+    vim_clang_update_unsaved_file("qa/data/unsaved/tokens.cpp:1\nint a;\n");
+    std::string first(vim_clang_tokens("qa/data/unsaved/tokens.cpp:"));
+    // Same inputs: the cached result is returned.
+    std::string second(vim_clang_tokens("qa/data/unsaved/tokens.cpp:"));
+    CPPUNIT_ASSERT_EQUAL(first, second);
+
+    // Changed inputs: the result is not reused.
+    vim_clang_update_unsaved_file(
+        "qa/data/unsaved/tokens.cpp:2:1:2\nint b;\n");
+    std::string third(vim_clang_tokens("qa/data/unsaved/tokens.cpp:"));
+    CPPUNIT_ASSERT(third.find("'spell':'b'") != std::string::npos);
+    vim_clang_discard_unsaved_file("qa/data/unsaved/tokens.cpp");
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(tokenizer_test);
 
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -1,18 +1,213 @@
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <dlfcn.h>
+#include <fstream>
+#include <map>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
 #include <iostream>
 
+namespace {
+
+typedef char const* (*function_type)(char const*);
+
+/// One entry point call of a recorded session.
+class recorded_call {
+  public:
+    /// Time of the call since the start of the recording.
+    std::chrono::microseconds time;
+    std::string name;
+    std::string input;
+
+    recorded_call();
+};
+
+recorded_call::recorded_call() = default;
+
+/// Reads size bytes and the newline after them.
+bool read_payload(std::istream& stream, std::size_t size,
+                  std::string& payload) {
+    payload.resize(size);
+    stream.read(&payload[0], size);
+    return stream.gcount() == static_cast<std::streamsize>(size) &&
+           stream.get() == '\n';
+}
+
+/// Reads a session written by vim_clang_start_recording(). Snapshots of
+/// unsaved buffers are written into directory, and the calls are changed to
+/// use those instead.
+bool read_session(const std::string& file, const std::string& directory,
+                  std::vector<recorded_call>& calls) {
+    std::ifstream stream(file.c_str(), std::ios::binary);
+    std::string line;
+    if (!std::getline(stream, line) || line != "libclang-vim session")
+        return false;
+
+    // Path -> its latest snapshot. A path may be snapshotted many times, so
+    // the snapshot files are numbered separately.
+    std::map<std::string, std::string> snapshots;
+    std::size_t snapshot_count = 0;
+    while (std::getline(stream, line)) {
+        std::string payload;
+        char name[256];
+        std::size_t size;
+        int path_start = 0;
+        long long time;
+        if (std::sscanf(line.c_str(), "snapshot %zu %n", &size, &path_start) ==
+                1 &&
+            path_start > 0) {
+            if (!read_payload(stream, size, payload))
+                return false;
+            const std::string path =
+                directory + "/" + std::to_string(snapshot_count++);
+            std::ofstream(path.c_str(), std::ios::binary) << payload;
+            snapshots[line.substr(path_start)] = path;
+        } else if (std::sscanf(line.c_str(), "call %lld %255s %zu", &time,
+                               name, &size) == 3) {
+            if (!read_payload(stream, size, payload))
+                return false;
+            // Point "file#path" to the snapshot of path, on every line, as
+            // file lists have one file per line.
+            for (std::size_t line_start = 0; line_start < payload.size();) {
+                auto line_end =
+                    std::min(payload.find('\n', line_start), payload.size());
+                const auto field_end =
+                    std::min(payload.find(':', line_start), line_end);
+                const auto hash = payload.find('#', line_start);
+                if (hash < field_end) {
+                    const std::string path =
+                        payload.substr(hash + 1, field_end - hash - 1);
+                    const auto it = snapshots.find(path);
+                    if (it != snapshots.end()) {
+                        payload.replace(hash + 1, path.size(), it->second);
+                        line_end += it->second.size() - path.size();
+                    }
+                }
+                line_start = line_end + 1;
+            }
+            recorded_call call;
+            call.time = std::chrono::microseconds(time);
+            call.name = name;
+            call.input = payload;
+            calls.push_back(call);
+        } else
+            return false;
+    }
+    return true;
+}
+
+long long get_percentile(std::vector<long long> samples, unsigned percent) {
+    if (samples.empty())
+        return 0;
+    std::sort(samples.begin(), samples.end());
+    const std::size_t rank = (samples.size() * percent + 99) / 100;
+    return samples[std::max<std::size_t>(rank, 1) - 1];
+}
+
+void print_latencies(const std::vector<long long>& samples) {
+    std::cout << "\"calls\":" << samples.size()
+              << ",\"p50_us\":" << get_percentile(samples, 50)
+              << ",\"p95_us\":" << get_percentile(samples, 95)
+              << ",\"p99_us\":" << get_percentile(samples, 99)
+              << ",\"max_us\":" << get_percentile(samples, 100);
+}
+
+/// Replays the calls of session, speed times faster than recorded, or as fast
+/// as possible if speed is 0. Prints the latencies as JSON, one object per
+/// entry point and one for the whole session.
+int replay(void* handle, const std::string& session, double speed) {
+    char directory[] = "/tmp/libclang-vim-replay-XXXXXX";
+    if (!mkdtemp(directory)) {
+        std::cerr << "failed to create a directory for snapshots" << std::endl;
+        return 1;
+    }
+
+    std::vector<recorded_call> calls;
+    const bool read = read_session(session, directory, calls);
+    int ret = 0;
+    if (!read) {
+        std::cerr << "failed to read session: " << session << std::endl;
+        ret = 1;
+    }
+
+    std::map<std::string, std::vector<long long>> latencies;
+    std::vector<long long> all;
+    long long max_lag = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; read && i < calls.size(); ++i) {
+        const recorded_call& call = calls[i];
+        auto function =
+            reinterpret_cast<function_type>(dlsym(handle, call.name.c_str()));
+        if (!function) {
+            std::cerr << "missing entry point: " << call.name << std::endl;
+            ret = 1;
+            break;
+        }
+
+        if (speed > 0) {
+            const auto due = start + std::chrono::duration_cast<
+                                         std::chrono::steady_clock::duration>(
+                                         call.time / speed);
+            std::this_thread::sleep_until(due);
+            // Calls late because of slow previous ones.
+            max_lag = std::max<long long>(
+                max_lag, std::chrono::duration_cast<std::chrono::microseconds>(
+                             std::chrono::steady_clock::now() - due)
+                             .count());
+        }
+        const auto begin = std::chrono::steady_clock::now();
+        function(call.input.c_str());
+        const long long latency =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - begin)
+                .count();
+        latencies[call.name].push_back(latency);
+        all.push_back(latency);
+    }
+    const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    if (read && !ret) {
+        for (const auto& api : latencies) {
+            std::cout << "{\"api\":\"" << api.first << "\",";
+            print_latencies(api.second);
+            std::cout << "}" << std::endl;
+        }
+        std::cout << "{\"speed\":" << speed << ",";
+        print_latencies(all);
+        std::cout << ",\"max_lag_us\":" << max_lag
+                  << ",\"duration_us\":" << duration.count() << "}"
+                  << std::endl;
+    }
+
+    const std::string command = std::string("rm -rf ") + directory;
+    if (std::system(command.c_str()) != 0)
+        return 1;
+    return ret;
+}
+}
+
 /// Can invoke functions from cmdline the same way as Vimscript does it via
-/// libcall(), to help debugging.
+/// libcall(), to help debugging. Can also replay a session recorded with
+/// vim_clang_start_recording() and report its latencies.
 int main(int argc, char** argv) {
     if (argc < 3) {
         std::cerr << "Usage: " << argv[0] << " <name> <input>" << std::endl;
+        std::cerr << "       " << argv[0] << " --replay <session> [<speed>]"
+                  << std::endl;
         std::cerr << std::endl;
         std::cerr << "Example: " << argv[0]
                   << " vim_clang_get_current_function_at "
                      "'qa/data/current-function.cpp:-std=c++1y:13:1'"
                   << std::endl;
+        std::cerr << "Speed is 1 for the recorded pace, 0 for no pauses "
+                     "between the calls."
+                  << std::endl;
         return 1;
     }
     const char* name = argv[1];
@@ -24,8 +219,14 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    auto function =
-        reinterpret_cast<char const* (*)(char const*)>(dlsym(handle, name));
+    if (std::strcmp(name, "--replay") == 0) {
+        const double speed = argc > 3 ? std::atof(argv[3]) : 1;
+        const int ret = replay(handle, input, speed);
+        dlclose(handle);
+        return ret;
+    }
+
+    auto function = reinterpret_cast<function_type>(dlsym(handle, name));
     assert(function);
 
     std::cout << "Output is: '" << function(input) << "'." << std::endl;
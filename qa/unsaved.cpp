@@ -0,0 +1,154 @@
+#include <cassert>
+#include <cppunit/extensions/HelperMacros.h>
+#include <dlfcn.h>
+#include <iostream>
+#include <unistd.h>
+
+class unsaved_test : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE(unsaved_test);
+    CPPUNIT_TEST(test_update_unsaved_file);
+    CPPUNIT_TEST(test_other_unsaved_files);
+    CPPUNIT_TEST(test_location_unsaved_files);
+    CPPUNIT_TEST_SUITE_END();
+
+    void test_update_unsaved_file();
+    void test_other_unsaved_files();
+    void test_location_unsaved_files();
+
+    void* m_handle = nullptr;
+
+  public:
+    unsaved_test();
+    unsaved_test(const unsaved_test&) = delete;
+    unsaved_test& operator=(const unsaved_test&) = delete;
+
+    void setUp() override;
+    void tearDown() override;
+};
+
+unsaved_test::unsaved_test() = default;
+
+void unsaved_test::setUp() {
+    m_handle = dlopen("lib/libclang-vim.so", RTLD_NOW);
+    if (!m_handle) {
+        std::stringstream ss;
+        ss << "dlopen() failed: ";
+        ss << dlerror();
+        CPPUNIT_FAIL(ss.str());
+    }
+}
+
+void unsaved_test::tearDown() {
+    if (m_handle)
+        dlclose(m_handle);
+}
+
+void unsaved_test::test_update_unsaved_file() {
+    auto vim_clang_update_unsaved_file =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_update_unsaved_file"));
+    assert(vim_clang_update_unsaved_file);
+    auto vim_clang_discard_unsaved_file =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_discard_unsaved_file"));
+    assert(vim_clang_discard_unsaved_file);
+    auto vim_clang_get_diagnostics =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_diagnostics"));
+    assert(vim_clang_get_diagnostics);
+
+    // The file only exists in the store, not on disk.
+    std::string actual(vim_clang_update_unsaved_file(
+        "qa/data/unsaved/update.cpp:1\n// Comment.\nint main() { int i = 0; "
+        "}\n"));
+    CPPUNIT_ASSERT_EQUAL(std::string("{'version':1}"), actual);
+    std::string expected("[{'severity': 'warning', "
+                         "'line':2,'column':18,'offset':29,'file':'qa/data/"
+                         "unsaved/update.cpp',}, ]");
+    actual = vim_clang_get_diagnostics(
+        "qa/data/unsaved/update.cpp:-Wunused-variable");
+    CPPUNIT_ASSERT_EQUAL(expected, actual);
+
+    // Replace the 2nd line only, the cached translation unit is reparsed.
+    actual = vim_clang_update_unsaved_file(
+        "qa/data/unsaved/update.cpp:2:2:3\nint main() { return 0; }\n");
+    CPPUNIT_ASSERT_EQUAL(std::string("{'version':2}"), actual);
+    actual = vim_clang_get_diagnostics(
+        "qa/data/unsaved/update.cpp:-Wunused-variable");
+    CPPUNIT_ASSERT_EQUAL(std::string("[]"), actual);
+
+    // Outdated update.
+    actual = vim_clang_update_unsaved_file(
+        "qa/data/unsaved/update.cpp:2:1:2\n\n");
+    CPPUNIT_ASSERT_EQUAL(std::string("{}"), actual);
+
+    actual = vim_clang_discard_unsaved_file("qa/data/unsaved/update.cpp");
+    CPPUNIT_ASSERT_EQUAL(std::string("{'discarded':1}"), actual);
+}
+
+void unsaved_test::test_other_unsaved_files() {
+    auto vim_clang_update_unsaved_file =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_update_unsaved_file"));
+    assert(vim_clang_update_unsaved_file);
+    auto vim_clang_discard_unsaved_file =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_discard_unsaved_file"));
+    assert(vim_clang_discard_unsaved_file);
+    auto vim_clang_get_diagnostics =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_diagnostics"));
+    assert(vim_clang_get_diagnostics);
+
+    // Neither the source nor the header it includes exist on disk.
+    vim_clang_update_unsaved_file(
+        "qa/data/unsaved/registry.cpp:1\n#include \"registry.hpp\"\nint "
+        "main() { return value; }\n");
+    vim_clang_update_unsaved_file(
+        "qa/data/unsaved/registry.hpp:1\nint value = 0;\n");
+    std::string actual(
+        vim_clang_get_diagnostics("qa/data/unsaved/registry.cpp:"));
+    CPPUNIT_ASSERT_EQUAL(std::string("[]"), actual);
+
+    // Without the header, the cached translation unit has to be reparsed.
+    actual = vim_clang_discard_unsaved_file("qa/data/unsaved/registry.hpp");
+    CPPUNIT_ASSERT_EQUAL(std::string("{'discarded':1}"), actual);
+    actual = vim_clang_get_diagnostics("qa/data/unsaved/registry.cpp:");
+    CPPUNIT_ASSERT(actual.find("'severity': 'fatal'") != std::string::npos);
+
+    vim_clang_discard_unsaved_file("qa/data/unsaved/registry.cpp");
+    actual = vim_clang_discard_unsaved_file("qa/data/unsaved/registry.cpp");
+    CPPUNIT_ASSERT_EQUAL(std::string("{}"), actual);
+}
+
+void unsaved_test::test_location_unsaved_files() {
+    auto vim_clang_update_unsaved_file =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_update_unsaved_file"));
+    assert(vim_clang_update_unsaved_file);
+    auto vim_clang_discard_unsaved_file =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_discard_unsaved_file"));
+    assert(vim_clang_discard_unsaved_file);
+    auto vim_clang_get_type_with_deduction_at =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_type_with_deduction_at"));
+    assert(vim_clang_get_type_with_deduction_at);
+
+    // Location based requests see the unsaved header, too.
+    vim_clang_update_unsaved_file(
+        "qa/data/unsaved/location.cpp:1\n#include \"location.hpp\"\nauto "
+        "copy = value;\n");
+    vim_clang_update_unsaved_file(
+        "qa/data/unsaved/location.hpp:1\ndouble value = 0;\n");
+    std::string actual(vim_clang_get_type_with_deduction_at(
+        "qa/data/unsaved/location.cpp::2:6"));
+    CPPUNIT_ASSERT(actual.find("'type':'double'") != std::string::npos);
+
+    vim_clang_discard_unsaved_file("qa/data/unsaved/location.hpp");
+    vim_clang_discard_unsaved_file("qa/data/unsaved/location.cpp");
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(unsaved_test);
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,116 @@
+#include <cassert>
+#include <chrono>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+
+class watch_test : public CPPUNIT_NS::TestFixture {
+    CPPUNIT_TEST_SUITE(watch_test);
+    CPPUNIT_TEST(test_file_watcher);
+    CPPUNIT_TEST_SUITE_END();
+
+    void test_file_watcher();
+
+    /// Polls the watcher till the poll result contains expected.
+    bool wait_for_watcher(const std::string& expected);
+
+    void* m_handle = nullptr;
+
+  public:
+    watch_test();
+    watch_test(const watch_test&) = delete;
+    watch_test& operator=(const watch_test&) = delete;
+
+    void setUp() override;
+    void tearDown() override;
+};
+
+watch_test::watch_test() = default;
+
+void watch_test::setUp() {
+    m_handle = dlopen("lib/libclang-vim.so", RTLD_NOW);
+    if (!m_handle) {
+        std::stringstream ss;
+        ss << "dlopen() failed: ";
+        ss << dlerror();
+        CPPUNIT_FAIL(ss.str());
+    }
+}
+
+void watch_test::tearDown() {
+    if (m_handle)
+        dlclose(m_handle);
+}
+
+bool watch_test::wait_for_watcher(const std::string& expected) {
+    auto vim_clang_poll_watching =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_poll_watching"));
+    assert(vim_clang_poll_watching);
+
+    for (int i = 0; i < 100; ++i) {
+        std::string poll(vim_clang_poll_watching(""));
+        if (poll.find(expected) != std::string::npos)
+            return true;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return false;
+}
+
+void watch_test::test_file_watcher() {
+    auto vim_clang_get_diagnostics =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_get_diagnostics"));
+    assert(vim_clang_get_diagnostics);
+    auto vim_clang_start_watching =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_start_watching"));
+    assert(vim_clang_start_watching);
+    auto vim_clang_stop_watching =
+        reinterpret_cast<char const* (*)(char const*)>(
+            dlsym(m_handle, "vim_clang_stop_watching"));
+    assert(vim_clang_stop_watching);
+
+    char directory[] = "/tmp/libclang-vim-test-XXXXXX";
+    CPPUNIT_ASSERT(mkdtemp(directory));
+    const std::string main_file = std::string(directory) + "/main.cpp";
+    const std::string header = std::string(directory) + "/a.hpp";
+    std::ofstream(main_file) << "#include \"a.hpp\"\n\n"
+                                "int main() { return get_a(); }\n";
+    std::ofstream(header) << "inline int get_a() { return 1; }\n";
+
+    std::string actual(vim_clang_get_diagnostics((main_file + ":").c_str()));
+    CPPUNIT_ASSERT_EQUAL(std::string("[]"), actual);
+
+    actual = vim_clang_start_watching("");
+    CPPUNIT_ASSERT_EQUAL(std::string("{'ok':1}"), actual);
+    actual = vim_clang_start_watching("");
+    CPPUNIT_ASSERT_EQUAL(std::string("{}"), actual);
+
+    // Only the header changes, the cached unit and diagnostics of main.cpp
+    // still get refreshed.
+    std::ofstream(header) << "inline int get_a() { return missing; }\n";
+    CPPUNIT_ASSERT(wait_for_watcher("'reparsed':1"));
+    actual = vim_clang_get_diagnostics((main_file + ":").c_str());
+    CPPUNIT_ASSERT(actual.find("'severity': 'error'") != std::string::npos);
+
+    actual = vim_clang_stop_watching("");
+    CPPUNIT_ASSERT_EQUAL(std::string("{'ok':1}"), actual);
+
+    // Without the watcher, changes are noticed by checking the files again.
+    std::ofstream(header) << "inline int get_a() { return 2; }\n";
+    actual = vim_clang_get_diagnostics((main_file + ":").c_str());
+    CPPUNIT_ASSERT_EQUAL(std::string("[]"), actual);
+
+    std::string command = "rm -rf " + std::string(directory);
+    CPPUNIT_ASSERT_EQUAL(0, std::system(command.c_str()));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(watch_test);
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */